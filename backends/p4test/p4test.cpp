@@ -26,9 +26,11 @@ limitations under the License.
 #include "frontends/p4/evaluator/evaluator.h"
 #include "frontends/p4/frontend.h"
 #include "frontends/p4/toP4/toP4.h"
+#include "ir/hash_cons.h"
 #include "ir/ir.h"
 #include "ir/json_loader.h"
 #include "ir/pass_utils.h"
+#include "lib/arena.h"
 #include "lib/crash.h"
 #include "lib/error.h"
 #include "lib/exceptions.h"
@@ -142,6 +144,10 @@ int main(int argc, char *const argv[]) {
     setup_signals();
 
     AutoCompileContext autoP4TestContext(new P4TestContext);
+    // Only used in builds configured with ENABLE_IR_ARENA: the IR is released in one go
+    // when main returns.
+    Util::Arena irArena;
+    Util::Arena::Scope irArenaScope(irArena);
     auto &options = P4TestContext::get().options();
     options.langVersion = CompilerOptions::FrontendVersion::P4_16;
     options.compilerVersion = cstring(P4TEST_VERSION_STRING);
@@ -220,7 +226,8 @@ int main(int argc, char *const argv[]) {
         }
         if (program) {
             if (!options.dumpJsonFile.empty())
-                JSONGenerator(*openFile(options.dumpJsonFile, true), true).emit(program);
+                JSONGenerator(*openFile(options.dumpJsonFile, true), true, options.binaryIR)
+                    .emit(program);
             if (options.debugJson) {
                 std::stringstream ss1, ss2;
                 JSONGenerator gen1(ss1), gen2(ss2);
@@ -244,6 +251,7 @@ int main(int argc, char *const argv[]) {
         }
     }
 
+    IR::HashConsTableBase::logStats();
     if (Log::verbose()) std::cerr << "Done." << std::endl;
     return ::P4::errorCount() > 0;
 }
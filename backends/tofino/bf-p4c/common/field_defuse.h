@@ -25,6 +25,8 @@
 #include "backends/tofino/bf-p4c/ir/tofino_write_context.h"
 #include "backends/tofino/bf-p4c/phv/phv_fields.h"
 #include "ir/ir.h"
+#include "lib/hash.h"
+#include "lib/hvec_map.h"
 #include "lib/ltbitmatrix.h"
 #include "lib/ordered_set.h"
 #include "lib/symbitmatrix.h"
@@ -96,15 +98,16 @@ class FieldDefUse : public BFN::ControlFlowVisitor, public Inspector, TofinoWrit
     const PhvInfo &phv;
     SymBitMatrix &conflict;
 
-    /// Maps uses to defs and vice versa.
-    ordered_map<locpair, LocPairSet> &uses, &defs;
-    ordered_map<locpair, bool> &ixbar_refs;
+    /// Maps uses to defs and vice versa.  These are only ever added to, so the
+    /// hvec_maps iterate in insertion order just like an ordered_map would.
+    hvec_map<locpair, LocPairSet, Util::Hash> &uses, &defs;
+    hvec_map<locpair, bool, Util::Hash> &ixbar_refs;
 
     /// All uses and all defs for each field.
     ordered_map<int, LocPairSet> &located_uses, &located_defs;
 
     /// Maps each def to the set of defs that it may overwrite.
-    ordered_map<locpair, LocPairSet> &output_deps;
+    hvec_map<locpair, LocPairSet, Util::Hash> &output_deps;
 
     /// All implicit parser zero initialization for each field.
     LocPairSet &parser_zero_inits;
@@ -11,6 +11,7 @@ macro(p4c_obtain_bdwgc)
     option(ENABLE_MULTITHREAD "Use multithreading" OFF)
     find_package(LibGc 7.2.0 REQUIRED)
     check_function_exists (GC_print_stats HAVE_GC_PRINT_STATS)
+    check_function_exists (GC_register_my_thread HAVE_GC_THREADS)
   else()
     # Print out download state while setting up BDWGC.
     set(FETCHCONTENT_QUIET_PREV ${FETCHCONTENT_QUIET})
@@ -27,6 +28,9 @@ macro(p4c_obtain_bdwgc)
     set(enable_large_config ON CACHE BOOL "Optimize for large heap or root set.")
     # Redirect all malloc calls in the program.
     set(enable_redirect_malloc OFF CACHE BOOL "Redirect malloc and friends to GC routines.")
+    # Let worker threads (e.g. PassManager --jobs) register with the collector.
+    set(enable_threads ON CACHE BOOL "Support threads")
+    set(HAVE_GC_THREADS 1)
     # Try to enable thread-local-storage for better performance.
     set(enable_thread_local_alloc ON CACHE BOOL "Turn on thread-local allocation optimization")
     # Other BDWGC options to avoid crashes.
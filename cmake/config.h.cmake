@@ -19,6 +19,12 @@
 /* Define to 1 if you have the pipe2 function. */
 #cmakedefine HAVE_PIPE2 1
 
+/* Define to 1 if the LIBGC library supports registering threads. */
+#cmakedefine HAVE_GC_THREADS 1
+
+/* Define to 1 to allocate IR nodes from per-compilation arenas. */
+#cmakedefine HAVE_IR_ARENA 1
+
 /* Define to 1 if you have the GC_print_stats function. */
 #cmakedefine HAVE_GC_PRINT_STATS 1
 
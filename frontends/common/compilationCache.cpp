@@ -0,0 +1,148 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "frontends/common/compilationCache.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "absl/strings/str_cat.h"
+#include "ir/json_generator.h"
+#include "ir/json_loader.h"
+#include "ir/visitor.h"
+#include "lib/exename.h"
+#include "lib/hash.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+using namespace P4::literals;
+
+namespace {
+
+/// Erase the field @p name (printed as " name=<integer>") from a dump_fields() output.
+void eraseIntField(std::string &fields, std::string_view name) {
+    auto pos = fields.find(absl::StrCat(" ", name, "="));
+    if (pos == std::string::npos) return;
+    auto end = pos + name.size() + 2;
+    if (end < fields.size() && fields[end] == '-') ++end;
+    while (end < fields.size() && isdigit(static_cast<unsigned char>(fields[end]))) ++end;
+    fields.erase(pos, end - pos);
+}
+
+class StructuralHash : public Inspector {
+    Util::Hash hasher;
+    uint64_t hash = 0;
+
+    void mix(uint64_t value) { hash = Util::hash_combine(hash, value); }
+
+    bool preorder(const IR::Node *node) override {
+        std::stringstream dump;
+        node->dump_fields(dump);
+        // Declarations, Type_InfInt, Type_Any and This carry an identity drawn from a
+        // process-global counter, which differs between two parses of the same source.
+        std::string fields = dump.str();
+        eraseIntField(fields, "declid");
+        if (node->is<IR::This>()) eraseIntField(fields, "id");
+        const auto &start = node->srcInfo.getStart();
+        const auto &end = node->srcInfo.getEnd();
+        mix(hasher(node->node_type_name(), fields, start.getLineNumber(),
+                   start.getColumnNumber(), end.getLineNumber(), end.getColumnNumber()));
+        return true;
+    }
+    // Marks the end of the children, so that the shape of the tree contributes.
+    void postorder(const IR::Node *) override { mix(1); }
+
+ public:
+    StructuralHash() {
+        setName("StructuralHash");
+        visitDagOnce = false;
+    }
+    uint64_t result() const { return hash; }
+};
+
+/// Distinguishes builds of the compiler that share a version string.
+uint64_t executableHash() {
+    std::error_code ec;
+    auto exe = getExecutablePath();
+    auto size = std::filesystem::file_size(exe, ec);
+    auto time = std::filesystem::last_write_time(exe, ec).time_since_epoch().count();
+    return Util::Hash{}(exe.string(), uint64_t(size), int64_t(time));
+}
+
+std::filesystem::path cacheFile(const std::filesystem::path &dir, uint64_t key) {
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".json";
+    return dir / name.str();
+}
+
+}  // namespace
+
+uint64_t structuralHash(const IR::Node *node) {
+    StructuralHash hash;
+    node->apply(hash);
+    return hash.result();
+}
+
+uint64_t CompilationCache::key(const IR::P4Program *program, const PassManager &pipeline,
+                               const CompilerOptions &options) {
+    std::stringstream passes;
+    pipeline.listPasses(passes, ","_cs);
+    uint64_t rv = Util::Hash{}(options.compilerVersion, options.getCompileCommand(),
+                               passes.str(), executableHash());
+    for (const auto *decl : program->objects) rv = Util::hash_combine(rv, structuralHash(decl));
+    return rv;
+}
+
+const IR::P4Program *CompilationCache::load(uint64_t key) const {
+    auto file = cacheFile(dir, key);
+    std::ifstream in(file);
+    if (!in) {
+        LOG1("compilation cache miss: " << file);
+        return nullptr;
+    }
+    LOG1("compilation cache hit: " << file);
+    JSONLoader loader(in);
+    const IR::Node *node = nullptr;
+    loader >> node;
+    return node ? node->to<IR::P4Program>() : nullptr;
+}
+
+void CompilationCache::store(uint64_t key, const IR::P4Program *result) const {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    auto file = cacheFile(dir, key);
+    // Write to a private file first, so that concurrent compilations never read a
+    // partial result.
+    auto tmp = file;
+    tmp += "." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp);
+        if (!out) {
+            LOG1("cannot write compilation cache file " << tmp);
+            return;
+        }
+        JSONGenerator(out, true).emit(result);
+    }
+    std::filesystem::rename(tmp, file, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+}
+
+}  // namespace P4
@@ -0,0 +1,62 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef FRONTENDS_COMMON_COMPILATIONCACHE_H_
+#define FRONTENDS_COMMON_COMPILATIONCACHE_H_
+
+#include <cstdint>
+#include <filesystem>
+
+#include "frontends/common/options.h"
+#include "ir/ir.h"
+#include "ir/pass_manager.h"
+
+namespace P4 {
+
+/// A hash of the structure of @p node: the kinds of the nodes, their non-node fields,
+/// their source positions and the shape of the tree.  Node ids do not contribute, so two
+/// parses of the same source hash the same.
+uint64_t structuralHash(const IR::Node *node);
+
+/// An on-disk cache of the results of running a pass pipeline on a program, so that
+/// recompiling an unchanged program can skip the pipeline.  Results are stored as JSON IR
+/// files named after their key, which combines the structural hashes of all top-level
+/// declarations of the input with the pass pipeline, the command line and the compiler
+/// binary.
+///
+/// Only the resulting IR is cached; diagnostics emitted by the pipeline are not
+/// repeated when a cached result is used.
+class CompilationCache {
+    std::filesystem::path dir;
+
+ public:
+    /// Caches in @p dir, which is created if needed.  An empty path disables the cache.
+    explicit CompilationCache(std::filesystem::path dir) : dir(std::move(dir)) {}
+
+    bool enabled() const { return !dir.empty(); }
+
+    /// @return the key for running @p pipeline on @p program, with the command line in
+    /// @p options.
+    static uint64_t key(const IR::P4Program *program, const PassManager &pipeline,
+                        const CompilerOptions &options);
+
+    /// @return the cached result for @p key, or nullptr if there is none.
+    const IR::P4Program *load(uint64_t key) const;
+    /// Save @p result under @p key.  Failing to write the cache is not an error.
+    void store(uint64_t key, const IR::P4Program *result) const;
+};
+
+}  // namespace P4
+
+#endif /* FRONTENDS_COMMON_COMPILATIONCACHE_H_ */
@@ -59,6 +59,23 @@ CompilerOptions::CompilerOptions(std::string_view defaultMessage) : ParserOption
             return true;
         },
         "Dump the compiler IR after the midend as JSON in the specified file.");
+    registerOption(
+        "--binaryIR", nullptr,
+        [this](const char *) {
+            binaryIR = true;
+            return true;
+        },
+        "Write the IR dumped by --toJSON in a compact binary format instead of JSON.\n"
+        "Loading IR from a file accepts both formats.");
+    registerOption(
+        "--cache-dir", "dir",
+        [this](const char *arg) {
+            compilationCacheDir = arg;
+            return true;
+        },
+        "Cache the result of the frontend in the specified directory, and reuse it\n"
+        "when the same program is compiled again with the same options.\n"
+        "Warnings issued by the frontend are not repeated when the cache is used.");
     registerOption(
         "--ndebug", nullptr,
         [this](const char *) {
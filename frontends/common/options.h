@@ -56,6 +56,10 @@ class CompilerOptions : public ParserOptions {
     std::vector<cstring> passesToExcludeBackend;
     // Dump a JSON representation of the IR in the file.
     std::filesystem::path dumpJsonFile;
+    // Write the IR dumped to dumpJsonFile in the binary IR format instead of JSON.
+    bool binaryIR = false;
+    // Directory of the on-disk cache of frontend results; empty if disabled.
+    std::filesystem::path compilationCacheDir;
     // Dump and undump the IR tree.
     bool debugJson = false;
     // if this flag is true, compile program in non-debug mode.
@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "frontends/common/options.h"
 #include "frontends/common/parser_options.h"
+#include "frontends/common/precompiledHeaders.h"
 #include "frontends/p4-14/fromv1.0/converters.h"
 #include "frontends/parsers/parserDriver.h"
 #include "lib/error.h"
@@ -66,16 +67,25 @@ const IR::P4Program *parseP4File(const ParserOptions &options) {
               "compiler context");
 
     const IR::P4Program *result = nullptr;
-    if (options.doNotPreprocess) {
+    if (options.doNotPreprocess && !options.isv1()) {
+        // The file is mapped and parsed in place, which matters for large generated programs.
+        auto buffer = Util::SourceBuffer::open(options.file);
+        if (buffer == nullptr) {
+            ::P4::error(ErrorType::ERR_NOT_FOUND, "%1%: No such file or directory.", options.file);
+            return nullptr;
+        }
+        result = P4ParserDriver::parse(std::move(buffer), options.file.string());
+    } else if (options.doNotPreprocess) {
         auto *file = fopen(options.file.c_str(), "r");
         if (file == nullptr) {
             ::P4::error(ErrorType::ERR_NOT_FOUND, "%1%: No such file or directory.", options.file);
             return nullptr;
         }
-        result = options.isv1() ? parseV1Program<FILE *, C>(file, options.file.string(), 1,
-                                                            options.getDebugHook())
-                                : P4ParserDriver::parse(file, options.file.string());
+        result = parseV1Program<FILE *, C>(file, options.file.string(), 1, options.getDebugHook());
         fclose(file);
+    } else if (options.precompiledHeaders && !options.isv1() && !options.doNotCompile &&
+               !options.makeDependencies) {
+        result = parseWithPrecompiledHeaders(options);
     } else {
         auto preprocessorResult = options.preprocess();
         if (::P4::errorCount() > 0 || !preprocessorResult.has_value()) {
@@ -23,18 +23,27 @@ limitations under the License.
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <iostream>
 #include <memory>
+#include <optional>
 #include <regex>
+#include <sstream>
 #include <unordered_set>
 
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "frontends/common/preprocessor.h"
 #include "frontends/p4/toP4/toP4.h"
+#include "ir/pass_profiler.h"
 #include "lib/exceptions.h"
 #include "lib/exename.h"
 #include "lib/log.h"
 #include "lib/nullstream.h"
+#include "lib/thread_pool.h"
 
 namespace P4 {
 
@@ -117,6 +126,7 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
         "-M", nullptr,
         [this](const char *) {
             preprocessor_options += std::string(" -M");
+            makeDependencies = true;
             doNotCompile = true;
             return true;
         },
@@ -125,6 +135,7 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
         "-MD", nullptr,
         [this](const char *) {
             preprocessor_options += std::string(" -MD");
+            makeDependencies = true;
             return true;
         },
         "Output `make` dependency rule to file as side effect (passed to preprocessor)");
@@ -132,6 +143,7 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
         "-MF", "file",
         [this](const char *arg) {
             preprocessor_options += std::string(" -MF \"") + arg + std::string("\"");
+            makeDependencies = true;
             return true;
         },
         "With -M, specify output file for dependencies (passed to preprocessor)");
@@ -139,6 +151,7 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
         "-MG", nullptr,
         [this](const char *) {
             preprocessor_options += std::string(" -MG");
+            makeDependencies = true;
             return true;
         },
         "with -M, suppress errors for missing headers (passed to preprocessor)");
@@ -146,6 +159,7 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
         "-MP", nullptr,
         [this](const char *) {
             preprocessor_options += std::string(" -MP");
+            makeDependencies = true;
             return true;
         },
         "with -M, add phony target for each dependency (passed to preprocessor)");
@@ -153,6 +167,7 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
         "-MT", "target",
         [this](const char *arg) {
             preprocessor_options += std::string(" -MT \"") + arg + std::string("\"");
+            makeDependencies = true;
             return true;
         },
         "With -M, override target of the output rule (passed to preprocessor)");
@@ -160,6 +175,7 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
         "-MQ", "target",
         [this](const char *arg) {
             preprocessor_options += std::string(" -MQ \"") + arg + std::string("\"");
+            makeDependencies = true;
             return true;
         },
         "Like -Mt, override target but quote special characters (passed to preprocessor)");
@@ -199,6 +215,23 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
             return true;
         },
         "Skip preprocess, assume input file is already preprocessed.");
+    registerOption(
+        "--builtin-cpp", nullptr,
+        [this](const char *) {
+            builtinPreprocessor = true;
+            return true;
+        },
+        "Preprocess with the preprocessor built into the compiler instead of running cpp.\n"
+        "Files it includes are read once per process.  The -M options still use cpp.");
+    registerOption(
+        "--precompiled-headers", nullptr,
+        [this](const char *) {
+            builtinPreprocessor = true;
+            precompiledHeaders = true;
+            return true;
+        },
+        "Parse the standard include files that a P4-16 program starts with once per\n"
+        "process, and reuse their declarations.  Implies --builtin-cpp.");
     registerOption(
         "--disable-annotations", "annotations",
         [this](const char *arg) {
@@ -329,6 +362,29 @@ ParserOptions::ParserOptions(std::string_view defaultMessage) : Util::Options(de
         "When the optimization is enabled, compiler tries to identify the cases,\n"
         "when it can inline the subparser's states only once for multiple\n"
         "invocations of the same subparser instance.");
+    registerOption(
+        "--jobs", "N",
+        [](const char *arg) {
+            char *end = nullptr;
+            auto jobs = strtoul(arg, &end, 10);
+            if (end == arg || *end != '\0') {
+                ::P4::error(ErrorType::ERR_INVALID, "Illegal number of jobs %1%", arg);
+                return false;
+            }
+            Util::WorkStealingPool::setJobs(jobs);
+            return true;
+        },
+        "Run passes that support it on up to N threads, one top-level declaration\n"
+        "at a time (0 = number of hardware threads). The default is 1.");
+    registerOption(
+        "--pass-profile", "file",
+        [](const char *arg) {
+            PassProfiler::start(arg);
+            return true;
+        },
+        "[Compiler debugging] Write the time, memory allocation and number of IR nodes\n"
+        "created by every compiler pass to the specified file, as a Chrome trace\n"
+        "(viewable in chrome://tracing or https://ui.perfetto.dev).");
     registerOption(
         "--doNotEmitIncludes", nullptr,
         [this](const char *) {
@@ -405,7 +461,110 @@ const char *ParserOptions::getIncludePath() const {
     return path.c_str();
 }
 
+/// Closes the in-memory output of the built-in preprocessor.
+static void closeBuffer(FILE *file) {
+    if (file != nullptr) fclose(file);
+}
+
+std::vector<std::filesystem::path> ParserOptions::getIncludeDirs() const {
+    // Targets give their include path as cpp options.
+    std::vector<std::filesystem::path> dirs;
+    for (auto dir : absl::StrSplit(getIncludePath(), " -I", absl::SkipEmpty()))
+        dirs.emplace_back(std::string(dir));
+    return dirs;
+}
+
+/// Splits @p text into words as a POSIX shell would, since cpp gets preprocessor_options
+/// through one.
+static std::vector<std::string> splitShellWords(std::string_view text) {
+    std::vector<std::string> words;
+    std::optional<std::string> word;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (isspace(static_cast<unsigned char>(c))) {
+            if (word) words.push_back(std::move(*word));
+            word.reset();
+            continue;
+        }
+        if (!word) word.emplace();
+        if (c == '\\' && i + 1 < text.size()) {
+            *word += text[++i];
+        } else if (c == '\'') {
+            while (++i < text.size() && text[i] != '\'') *word += text[i];
+        } else if (c == '"') {
+            while (++i < text.size() && text[i] != '"') {
+                if (text[i] == '\\' && i + 1 < text.size() && strchr("\"\\$`", text[i + 1]))
+                    ++i;
+                *word += text[i];
+            }
+        } else {
+            *word += c;
+        }
+    }
+    if (word) words.push_back(std::move(*word));
+    return words;
+}
+
+bool ParserOptions::applyPreprocessorOptions(Preprocessor &preprocessor) const {
+    auto words = splitShellWords(preprocessor_options.string_view());
+    for (size_t i = 0; i < words.size(); ++i) {
+        std::string_view word = words[i];
+        if (word.size() >= 2 && word[0] == '-' && strchr("IDU", word[1])) {
+            std::string arg(word.substr(2));
+            if (arg.empty() && i + 1 < words.size()) arg = words[++i];
+            if (word[1] == 'I')
+                preprocessor.addIncludeDir(arg);
+            else if (word[1] == 'D')
+                preprocessor.define(arg);
+            else
+                preprocessor.undefine(arg);
+        } else if (word == "-MF" || word == "-MT" || word == "-MQ") {
+            ++i;  // the -M options only matter to cpp, which preprocess() uses for them
+        } else if (word.substr(0, 2) != "-M") {
+            ::P4::error(ErrorType::ERR_UNSUPPORTED,
+                        "Preprocessor option %1% is not supported by the built-in preprocessor",
+                        words[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<std::string> ParserOptions::preprocessBuiltin(Preprocessor &preprocessor) const {
+    if (file == "-") {
+        // As with cpp, the standard input is passed through without preprocessing.
+        std::stringstream input;
+        input << std::cin.rdbuf();
+        return input.str();
+    }
+    if (!applyPreprocessorOptions(preprocessor)) return std::nullopt;
+    for (const auto &dir : getIncludeDirs()) preprocessor.addIncludeDir(dir);
+    return preprocessor.processFile(file);
+}
+
+std::optional<ParserOptions::PreprocessorResult> ParserOptions::preprocessBuiltin() const {
+    Preprocessor preprocessor;
+    auto text = preprocessBuiltin(preprocessor);
+    if (!text) return std::nullopt;
+
+    if (doNotCompile) {
+        std::cout << *text;
+        return std::nullopt;
+    }
+    // The lexers read a FILE; this one owns a copy of the text and frees it when closed.
+    FILE *in = fmemopen(nullptr, std::max<size_t>(text->size(), 1), "w+");
+    if (in == nullptr || fwrite(text->data(), 1, text->size(), in) != text->size()) {
+        ::P4::error(ErrorType::ERR_IO, "Cannot buffer the preprocessed program");
+        if (in != nullptr) fclose(in);
+        return std::nullopt;
+    }
+    rewind(in);
+    return ParserOptions::PreprocessorResult(in, &closeBuffer);
+}
+
 std::optional<ParserOptions::PreprocessorResult> ParserOptions::preprocess() const {
+    if (builtinPreprocessor && !makeDependencies) return preprocessBuiltin();
+
     FILE *in = nullptr;
 
     if (file == "-") {
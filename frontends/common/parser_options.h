@@ -21,7 +21,10 @@ limitations under the License.
 
 #include <cstdio>
 #include <filesystem>
+#include <optional>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "ir/configuration.h"
 #include "ir/pass_manager.h"
@@ -31,6 +34,7 @@ limitations under the License.
 
 namespace P4 {
 
+class Preprocessor;
 class ToP4;
 
 /// Standard include paths for .p4 header files. The values are determined by
@@ -78,6 +82,12 @@ class ParserOptions : public Util::Options {
     FrontendVersion langVersion = FrontendVersion::P4_16;
     /// options to pass to preprocessor
     cstring preprocessor_options = cstring::empty;
+    /// if true use the built-in preprocessor instead of running cpp
+    bool builtinPreprocessor = false;
+    /// if true reuse the declarations of the standard include files across compilations
+    bool precompiledHeaders = false;
+    /// if true one of the -M options was given, which only cpp implements
+    bool makeDependencies = false;
     /// file to compile (- for stdin)
     std::filesystem::path file;
     /// if true preprocess only
@@ -98,6 +108,18 @@ class ParserOptions : public Util::Options {
     const char *getIncludePath() const override;
     /// Returns the output of the preprocessor.
     std::optional<ParserOptions::PreprocessorResult> preprocess() const;
+    /// Returns the output of the built-in preprocessor, used by preprocess() with --builtin-cpp.
+    std::optional<ParserOptions::PreprocessorResult> preprocessBuiltin() const;
+    /// Passes the -I, -D and -U options in preprocessor_options, which include those
+    /// added by the target, to @p preprocessor.  Reports an error and returns false
+    /// if preprocessor_options has an option that only cpp implements.
+    bool applyPreprocessorOptions(Preprocessor &preprocessor) const;
+    /// Runs @p preprocessor on the input file, with the include path and macros of
+    /// preprocessor_options.  The standard input is returned unchanged, as with cpp.
+    /// Returns the output, or std::nullopt if errors were reported.
+    std::optional<std::string> preprocessBuiltin(Preprocessor &preprocessor) const;
+    /// Returns the directories of the target specific include path.
+    std::vector<std::filesystem::path> getIncludeDirs() const;
     /// True if we are compiling a P4 v1.0 or v1.1 program
     bool isv1() const;
     /// Get a debug hook function suitable for insertion in the pass managers. The hook is
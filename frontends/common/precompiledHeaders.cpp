@@ -0,0 +1,115 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "precompiledHeaders.h"
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "frontends/common/preprocessor.h"
+#include "frontends/p4/symbol_table.h"
+#include "frontends/parsers/parserDriver.h"
+#include "lib/arena.h"
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+struct Cache {
+    std::mutex lock;
+    std::unordered_map<std::string, const IR::Vector<IR::Node> *> entries;
+
+    static Cache &get() {
+        // Never destroyed, and allocated with the collector so that it keeps the IR alive.
+        static auto *cache = new Cache;
+        return *cache;
+    }
+};
+
+/// @return true if @p file is in @p dir or one of its subdirectories.
+bool isUnder(const std::filesystem::path &file, const std::filesystem::path &dir) {
+    auto relative = file.lexically_normal().lexically_relative(dir.lexically_normal());
+    return !relative.empty() && *relative.begin() != "..";
+}
+
+}  // namespace
+
+const IR::Vector<IR::Node> *PrecompiledHeaders::get(const std::string &text) {
+    auto &cache = Cache::get();
+    {
+        std::lock_guard<std::mutex> guard(cache.lock);
+        auto it = cache.entries.find(text);
+        if (it != cache.entries.end()) {
+            LOG2("Using " << (it->second ? it->second->size() : 0) << " precompiled declarations");
+            return it->second;
+        }
+    }
+
+    // The declarations are shared by later compilations, so they must not be allocated
+    // in the arena of this one.
+    Util::Arena::Suspend persistent;
+    // Programs with errors are not cached, so their errors are reported each time.
+    auto errors = ::P4::errorCount();
+    std::istringstream in(text);
+    const auto *program = P4ParserDriver::parse(in, "<precompiled headers>");
+    if (program == nullptr || ::P4::errorCount() > errors) return nullptr;
+
+    Util::ProgramStructure structure;
+    bool resumable =
+        std::all_of(program->objects.begin(), program->objects.end(),
+                    [&](const IR::Node *node) { return structure.declareParsed(node); });
+    const IR::Vector<IR::Node> *declarations = nullptr;
+    if (resumable)
+        declarations = new IR::Vector<IR::Node>(program->objects);
+    else
+        LOG2("Cannot resume parsing after the standard include files");
+
+    std::lock_guard<std::mutex> guard(cache.lock);
+    return cache.entries.emplace(text, declarations).first->second;
+}
+
+void PrecompiledHeaders::clear() {
+    auto &cache = Cache::get();
+    std::lock_guard<std::mutex> guard(cache.lock);
+    cache.entries.clear();
+}
+
+const IR::P4Program *parseWithPrecompiledHeaders(const ParserOptions &options) {
+    Preprocessor preprocessor;
+    auto dirs = options.getIncludeDirs();
+    preprocessor.separatePrelude([&dirs](const std::filesystem::path &file) {
+        return std::any_of(dirs.begin(), dirs.end(),
+                           [&](const auto &dir) { return isUnder(file, dir); });
+    });
+    auto text = options.preprocessBuiltin(preprocessor);
+    if (!text) return nullptr;
+
+    const auto &prelude = preprocessor.prelude();
+    if (!prelude.empty()) {
+        auto errors = ::P4::errorCount();
+        if (const auto *declarations = PrecompiledHeaders::get(prelude)) {
+            std::istringstream in(*text);
+            return P4ParserDriver::parseWithPrelude(in, options.file.string(), *declarations);
+        }
+        if (::P4::errorCount() > errors) return nullptr;
+    }
+    std::istringstream in(prelude + *text);
+    return P4ParserDriver::parse(in, options.file.string());
+}
+
+}  // namespace P4
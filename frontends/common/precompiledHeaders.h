@@ -0,0 +1,52 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef FRONTENDS_COMMON_PRECOMPILEDHEADERS_H_
+#define FRONTENDS_COMMON_PRECOMPILEDHEADERS_H_
+
+#include <string>
+
+#include "frontends/common/parser_options.h"
+#include "ir/ir.h"
+
+namespace P4 {
+
+/// The parsed declarations of the standard include files (core.p4, the architecture
+/// files) that P4-16 programs start with, kept for the whole process so that each
+/// compilation does not parse them again.  They are keyed by the preprocessed text of
+/// the files, so that macros that change what the files declare give other entries.
+///
+/// The declarations are shared by the programs that include them, which the IR allows
+/// as it is never modified in place.  They are only kept in memory: the JSON IR does
+/// not keep the source positions the frontend needs.  Type checking is not cached, as
+/// its results are specific to each program.
+class PrecompiledHeaders {
+ public:
+    /// @return the top-level declarations of @p text, the preprocessed include files, or
+    /// nullptr if @p text has errors (which are reported) or declarations after which
+    /// parsing cannot be resumed.
+    static const IR::Vector<IR::Node> *get(const std::string &text);
+    /// Forgets all the declarations.
+    static void clear();
+};
+
+/// Preprocesses and parses the P4-16 program named by @p options, with the declarations
+/// of the files it first includes from the target's include path taken from
+/// PrecompiledHeaders.  Used by parseP4File() with --precompiled-headers.
+/// @return the program, or nullptr if errors were reported.
+const IR::P4Program *parseWithPrecompiledHeaders(const ParserOptions &options);
+
+}  // namespace P4
+
+#endif /* FRONTENDS_COMMON_PRECOMPILEDHEADERS_H_ */
@@ -0,0 +1,1054 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "preprocessor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+int Preprocessor::Macro::param(const Token &token) const {
+    if (!functionLike || token.kind != Token::Identifier) return -1;
+    auto it = std::find(params.begin(), params.end(), token.text);
+    return it == params.end() ? -1 : static_cast<int>(it - params.begin());
+}
+
+struct Preprocessor::Source {
+    std::shared_ptr<const std::string> text;
+    std::filesystem::path path;
+    std::string name;  // as shown in line markers and messages
+    size_t pos = 0;
+    unsigned line = 1;        // number of the next physical line
+    unsigned outLine = 1;     // the line the next output line belongs to
+    unsigned lineOfText = 1;  // first line of what is being processed
+    bool inComment = false;   // in a /* comment at the start of the next line
+};
+
+struct Preprocessor::Conditional {
+    bool active;   // this branch is being processed
+    bool taken;    // some branch was (or must not be) taken
+    bool sawElse;  // the #else was seen
+    unsigned line;
+};
+
+namespace {
+
+using Token = Preprocessor::Token;
+using Tokens = Preprocessor::Tokens;
+
+/// The punctuators with more than one character, longest first.  The P4 operators are
+/// included so that expanding macros does not glue their characters to others.
+const char *const multiCharPunct[] = {"...", "<<=", ">>=", "&&&", "|+|", "|-|", "##", "<<", ">>",
+                                      "<=",  ">=",  "==",  "!=",  "&&",  "||",  "->", "++", "--",
+                                      "+=",  "-=",  "*=",  "/=",  "%=",  "&=",  "|=", "^=", "::"};
+
+bool isIdentStart(char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+bool isIdentChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+/// Splits @p text into tokens, calling @p emit(kind, text) for each.  @p inComment says
+/// whether the text starts inside a /* comment, and is updated to say whether it ends
+/// inside one.
+template <class Emit>
+void scan(std::string_view text, bool &inComment, Emit emit) {
+    size_t i = 0;
+    const size_t size = text.size();
+    auto take = [&](Token::Kind kind, size_t end) {
+        emit(kind, text.substr(i, end - i));
+        i = end;
+    };
+    if (inComment) {
+        size_t end = text.find("*/");
+        inComment = end == std::string_view::npos;
+        take(Token::Comment, inComment ? size : end + 2);
+    }
+    while (i < size) {
+        char c = text[i];
+        size_t j = i + 1;
+        if (c == ' ' || c == '\t' || c == '\f' || c == '\v' || c == '\r') {
+            while (j < size && (text[j] == ' ' || text[j] == '\t' || text[j] == '\f' ||
+                                text[j] == '\v' || text[j] == '\r'))
+                ++j;
+            take(Token::Space, j);
+        } else if (c == '/' && j < size && text[j] == '/') {
+            take(Token::Comment, size);
+        } else if (c == '/' && j < size && text[j] == '*') {
+            size_t end = text.find("*/", i + 2);
+            inComment = end == std::string_view::npos;
+            take(Token::Comment, inComment ? size : end + 2);
+        } else if (isIdentStart(c)) {
+            while (j < size && isIdentChar(text[j])) ++j;
+            take(Token::Identifier, j);
+        } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                   (c == '.' && j < size && std::isdigit(static_cast<unsigned char>(text[j])))) {
+            // A preprocessing number, which covers P4 literals such as 8w0x1F.
+            while (j < size) {
+                char d = text[j];
+                if ((d == '+' || d == '-') && std::strchr("eEpP", text[j - 1]))
+                    ++j;
+                else if (isIdentChar(d) || d == '.')
+                    ++j;
+                else
+                    break;
+            }
+            take(Token::Number, j);
+        } else if (c == '"') {
+            while (j < size && text[j] != '"') j += text[j] == '\\' ? 2 : 1;
+            take(Token::String, std::min(j + 1, size));
+        } else {
+            size_t len = 1;
+            for (const char *punct : multiCharPunct) {
+                if (text.compare(i, std::strlen(punct), punct) == 0) {
+                    len = std::strlen(punct);
+                    break;
+                }
+            }
+            take(Token::Punct, i + len);
+        }
+    }
+}
+
+void tokenize(std::string_view text, bool &inComment, Tokens &out) {
+    scan(text, inComment, [&](Token::Kind kind, std::string_view token) {
+        out.emplace_back(kind, std::string(token));
+    });
+}
+
+/// @return true if @p a and @p b must be separated to stay two tokens.
+bool wouldPaste(const Token &a, const Token &b) {
+    auto isWord = [](const Token &t) {
+        return t.kind == Token::Identifier || t.kind == Token::Number;
+    };
+    if (isWord(a) && isWord(b)) return true;
+    if (a.kind != Token::Punct || b.kind != Token::Punct) return false;
+    std::string joined = a.text + b.text.front();
+    if (joined == "//" || joined == "/*") return true;
+    for (const char *punct : multiCharPunct)
+        if (std::string_view(punct).substr(0, joined.size()) == joined) return true;
+    return false;
+}
+
+void append(std::string &out, const std::vector<Token> &tokens) {
+    const Token *prev = nullptr;
+    for (const auto &token : tokens) {
+        if (token.kind == Token::Placemarker) continue;
+        if (prev && (prev->fromMacro || token.fromMacro) && wouldPaste(*prev, token)) out += ' ';
+        out += token.text;
+        prev = &token;
+    }
+}
+
+bool inHideSet(const std::vector<std::string> &hideSet, const std::string &name) {
+    return std::find(hideSet.begin(), hideSet.end(), name) != hideSet.end();
+}
+
+void skipSpaces(const Tokens &tokens, size_t &i) {
+    while (i < tokens.size() && tokens[i].isSpace()) ++i;
+}
+
+/// Removes the spaces and comments at both ends of @p tokens.
+void trim(Tokens &tokens) {
+    while (!tokens.empty() && tokens.front().isSpace()) tokens.pop_front();
+    while (!tokens.empty() && tokens.back().isSpace()) tokens.pop_back();
+}
+
+Token stringify(const Tokens &arg) {
+    std::string text = "\"";
+    bool space = false;
+    for (const auto &token : arg) {
+        if (token.isSpace()) {
+            space = text.size() > 1;
+            continue;
+        }
+        if (space) text += ' ';
+        space = false;
+        if (token.kind == Token::String) {
+            for (char c : token.text) {
+                if (c == '"' || c == '\\') text += '\\';
+                text += c;
+            }
+        } else {
+            text += token.text;
+        }
+    }
+    return Token(Token::String, text + "\"");
+}
+
+/// Evaluates the expression of an #if directive, once macros have been expanded.
+class ExpressionEvaluator {
+    const std::vector<Token> &tokens;
+    size_t pos = 0;
+
+    const Token *peek() const { return pos < tokens.size() ? &tokens[pos] : nullptr; }
+    bool accept(const char *punct) {
+        if (!peek() || !peek()->is(punct)) return false;
+        ++pos;
+        return true;
+    }
+    void expect(const char *punct) {
+        if (!accept(punct)) fail(std::string("expected '") + punct + "'");
+    }
+    [[noreturn]] void fail(const std::string &message) const { throw message; }
+
+    intmax_t number(const std::string &text) {
+        std::string digits = text;
+        while (!digits.empty() && std::strchr("uUlL", digits.back())) digits.pop_back();
+        int base = 10;
+        size_t start = 0;
+        if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+            base = 16;
+            start = 2;
+        } else if (digits.size() > 2 && digits[0] == '0' &&
+                   (digits[1] == 'b' || digits[1] == 'B')) {
+            base = 2;
+            start = 2;
+        } else if (digits.size() > 1 && digits[0] == '0') {
+            base = 8;
+        }
+        char *end = nullptr;
+        uintmax_t value = std::strtoumax(digits.c_str() + start, &end, base);
+        if (start == digits.size() || *end != '\0')
+            fail("invalid integer \"" + text + "\" in #if expression");
+        return static_cast<intmax_t>(value);
+    }
+
+    intmax_t primary() {
+        const Token *token = peek();
+        if (!token) fail("#if expression ends too early");
+        ++pos;
+        if (token->is("(")) {
+            intmax_t value = conditional();
+            expect(")");
+            return value;
+        }
+        if (token->is("!")) return !primary();
+        if (token->is("~")) return ~primary();
+        if (token->is("-")) return -primary();
+        if (token->is("+")) return primary();
+        if (token->kind == Token::Number) return number(token->text);
+        fail("token \"" + token->text + "\" is not valid in #if expressions");
+    }
+
+    /// Binary operators, by precedence from loosest to tightest.
+    intmax_t binary(int level) {
+        static const std::vector<std::vector<const char *>> levels = {
+            {"||"}, {"&&"}, {"|"}, {"^"}, {"&"}, {"==", "!="}, {"<", ">", "<=", ">="},
+            {"<<", ">>"}, {"+", "-"}, {"*", "/", "%"}};
+        if (level == static_cast<int>(levels.size())) return primary();
+        intmax_t left = binary(level + 1);
+        while (const Token *token = peek()) {
+            auto it = std::find_if(levels[level].begin(), levels[level].end(),
+                                   [&](const char *op) { return token->is(op); });
+            if (it == levels[level].end()) break;
+            std::string op = *it;
+            ++pos;
+            intmax_t right = binary(level + 1);
+            if (op == "||") {
+                left = left || right;
+            } else if (op == "&&") {
+                left = left && right;
+            } else if (op == "|") {
+                left |= right;
+            } else if (op == "^") {
+                left ^= right;
+            } else if (op == "&") {
+                left &= right;
+            } else if (op == "==") {
+                left = left == right;
+            } else if (op == "!=") {
+                left = left != right;
+            } else if (op == "<") {
+                left = left < right;
+            } else if (op == ">") {
+                left = left > right;
+            } else if (op == "<=") {
+                left = left <= right;
+            } else if (op == ">=") {
+                left = left >= right;
+            } else if (op == "<<") {
+                left = right < 0 || right >= 64 ? 0 : static_cast<intmax_t>(
+                                                          static_cast<uintmax_t>(left) << right);
+            } else if (op == ">>") {
+                left = right < 0 || right >= 64 ? (left < 0 ? -1 : 0) : left >> right;
+            } else if (op == "+") {
+                left = static_cast<intmax_t>(static_cast<uintmax_t>(left) + right);
+            } else if (op == "-") {
+                left = static_cast<intmax_t>(static_cast<uintmax_t>(left) - right);
+            } else if (op == "*") {
+                left = static_cast<intmax_t>(static_cast<uintmax_t>(left) * right);
+            } else {
+                if (right == 0) fail("division by zero in #if");
+                left = op == "/" ? left / right : left % right;
+            }
+        }
+        return left;
+    }
+
+    intmax_t conditional() {
+        intmax_t cond = binary(0);
+        if (!accept("?")) return cond;
+        intmax_t ifTrue = conditional();
+        expect(":");
+        intmax_t ifFalse = conditional();
+        return cond ? ifTrue : ifFalse;
+    }
+
+ public:
+    explicit ExpressionEvaluator(const std::vector<Token> &tokens) : tokens(tokens) {}
+
+    /// @return the value of the expression; throws a message if it is invalid.
+    intmax_t evaluate() {
+        if (tokens.empty()) fail("#if with no expression");
+        intmax_t value = conditional();
+        if (pos != tokens.size())
+            fail("missing binary operator before token \"" + tokens[pos].text + "\"");
+        return value;
+    }
+};
+
+/// Reads the next line of @p source into @p line, joining lines that end with a
+/// backslash.  @return false at the end of the source.
+template <class Source>
+bool nextLine(Source &source, std::string &line) {
+    const std::string &text = *source.text;
+    if (source.pos >= text.size()) return false;
+    line.clear();
+    source.lineOfText = source.line;
+    while (true) {
+        size_t end = text.find('\n', source.pos);
+        if (end == std::string::npos) end = text.size();
+        std::string_view physical(text.data() + source.pos, end - source.pos);
+        if (!physical.empty() && physical.back() == '\r') physical.remove_suffix(1);
+        source.pos = std::min(end + 1, text.size());
+        ++source.line;
+        if (!physical.empty() && physical.back() == '\\' && source.pos < text.size()) {
+            line.append(physical.substr(0, physical.size() - 1));
+            continue;
+        }
+        line.append(physical);
+        return true;
+    }
+}
+
+bool isDirectiveLine(std::string_view line) {
+    size_t first = line.find_first_not_of(" \t\f\v");
+    return first != std::string_view::npos && line[first] == '#';
+}
+
+/// A cache of the files read by all the preprocessors in the process.  Standard headers
+/// are included by nearly every compilation, so compilers that handle many programs
+/// read them only once.
+class SourceCache {
+    struct Entry {
+        std::filesystem::file_time_type modified;
+        uintmax_t size;
+        std::shared_ptr<const std::string> text;
+    };
+    std::mutex lock;
+    std::unordered_map<std::string, Entry> entries;
+
+ public:
+    static SourceCache &get() {
+        // Never destroyed, so it can be used until the process exits.
+        static auto *cache = new SourceCache;
+        return *cache;
+    }
+
+    std::shared_ptr<const std::string> read(const std::filesystem::path &file) {
+        std::error_code ec;
+        auto modified = std::filesystem::last_write_time(file, ec);
+        if (ec) return nullptr;
+        auto size = std::filesystem::file_size(file, ec);
+        if (ec) return nullptr;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = entries.find(file.native());
+            if (it != entries.end() && it->second.modified == modified &&
+                it->second.size == size) {
+                LOG3("using cached " << file);
+                return it->second.text;
+            }
+        }
+        std::ifstream in(file, std::ios::binary);
+        if (!in) return nullptr;
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        auto text = std::make_shared<const std::string>(contents.str());
+        std::lock_guard<std::mutex> guard(lock);
+        entries[file.native()] = Entry{modified, size, text};
+        return text;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> guard(lock);
+        entries.clear();
+    }
+};
+
+}  // namespace
+
+std::shared_ptr<const std::string> Preprocessor::readSourceFile(const std::filesystem::path &file) {
+    return SourceCache::get().read(file);
+}
+
+void Preprocessor::clearSourceCache() { SourceCache::get().clear(); }
+
+Preprocessor::Preprocessor(std::vector<std::filesystem::path> includeDirs)
+    : includeDirs(std::move(includeDirs)) {}
+
+void Preprocessor::addIncludeDir(std::filesystem::path dir) {
+    includeDirs.push_back(std::move(dir));
+}
+
+void Preprocessor::define(std::string_view definition) {
+    std::string text(definition);
+    auto eq = text.find('=');
+    if (eq == std::string::npos)
+        text += " 1";
+    else
+        text[eq] = ' ';
+    Tokens tokens;
+    bool inComment = false;
+    tokenize(text, inComment, tokens);
+    defineMacro(std::move(tokens));
+}
+
+void Preprocessor::undefine(std::string_view name) {
+    auto it = macros.find(name);
+    if (it != macros.end()) macros.erase(it);
+}
+
+std::optional<std::string> Preprocessor::processFile(const std::filesystem::path &file) {
+    auto text = readSourceFile(file);
+    if (!text) {
+        ::P4::error(ErrorType::ERR_IO, "%1%: cannot read file", file.string());
+        return std::nullopt;
+    }
+    return run(std::move(text), file);
+}
+
+std::optional<std::string> Preprocessor::processString(std::string_view source,
+                                                       const std::filesystem::path &fileName) {
+    return run(std::make_shared<const std::string>(source), fileName);
+}
+
+std::optional<std::string> Preprocessor::run(std::shared_ptr<const std::string> text,
+                                             const std::filesystem::path &file) {
+    output.clear();
+    preludeOutput.clear();
+    preludeOpen = static_cast<bool>(preludeSelect);
+    failed = false;
+    Source source;
+    source.text = std::move(text);
+    source.path = file;
+    source.name = file.string();
+    current = &source;
+    lineMarker(1, source.name);
+    processSource(source);
+    current = nullptr;
+    if (failed) return std::nullopt;
+    return std::move(output);
+}
+
+void Preprocessor::report(bool isError, const std::string &message) {
+    auto line = current ? current->lineOfText : 0;
+    auto file = current ? current->name : std::string("<command line>");
+    if (isError) {
+        failed = true;
+        ::P4::error(ErrorType::ERR_INVALID, "%1%:%2%: %3%", file, line, message);
+    } else {
+        ::P4::warning(ErrorType::WARN_INVALID, "%1%:%2%: %3%", file, line, message);
+    }
+}
+
+void Preprocessor::lineMarker(unsigned line, const std::string &file, const char *flag) {
+    if (!output.empty() && output.back() != '\n') output += '\n';
+    output += "# " + std::to_string(line) + " \"" + file + "\"";
+    if (flag) output += std::string(" ") + flag;
+    output += '\n';
+    current->outLine = line;
+}
+
+void Preprocessor::syncLine(unsigned line) {
+    // Like cpp, use empty lines for short gaps and a line marker for longer ones.
+    unsigned outLine = current->outLine;
+    if (line == outLine) return;
+    if (line > outLine && line - outLine <= 8)
+        output.append(line - outLine, '\n');
+    else
+        lineMarker(line, current->name);
+    current->outLine = line;
+}
+
+void Preprocessor::processSource(Source &source) {
+    std::vector<Conditional> conditionals;
+    std::string line;
+    while (nextLine(source, line)) {
+        bool active = conditionals.empty() || conditionals.back().active;
+        if (!source.inComment && isDirectiveLine(line)) {
+            Tokens tokens;
+            tokenize(line, source.inComment, tokens);
+            // A comment that does not end on the line is part of the directive.
+            std::string rest;
+            unsigned first = source.lineOfText;
+            while (source.inComment && nextLine(source, rest))
+                tokenize(rest, source.inComment, tokens);
+            source.lineOfText = first;
+            directive(source, std::move(tokens), conditionals);
+            continue;
+        }
+        // Most lines have no macros, and are copied without being split into tokens.
+        bool inComment = source.inComment;
+        bool hasMacros = false;
+        bool hasCode = false;
+        scan(line, source.inComment, [&](Token::Kind kind, std::string_view token) {
+            hasMacros |= kind == Token::Identifier &&
+                         (macros.count(token) || token == "__LINE__" || token == "__FILE__");
+            hasCode |= kind != Token::Space && kind != Token::Comment;
+        });
+        if (!active) continue;
+        if (hasCode && depth == 0) preludeOpen = false;
+
+        unsigned first = source.lineOfText;
+        if (!hasMacros) {
+            syncLine(first);
+            output += line;
+            output += '\n';
+            source.outLine = first + 1;
+            continue;
+        }
+        Tokens tokens;
+        tokenize(line, inComment, tokens);
+        // A macro call may continue on the next lines, unless they are directives.
+        std::function<bool()> more = [&]() {
+            if (source.pos >= source.text->size()) return false;
+            auto pos = source.pos;
+            auto lineNumber = source.line;
+            auto lineOfText = source.lineOfText;
+            std::string next;
+            nextLine(source, next);
+            if (!source.inComment && isDirectiveLine(next)) {
+                source.pos = pos;
+                source.line = lineNumber;
+                source.lineOfText = lineOfText;
+                return false;
+            }
+            // The arguments can't end with a // comment any more.
+            if (!tokens.empty() && tokens.back().kind == Token::Comment &&
+                tokens.back().text.compare(0, 2, "//") == 0)
+                tokens.back() = Token(Token::Space, " ");
+            tokens.emplace_back(Token::Space, " ");
+            tokenize(next, source.inComment, tokens);
+            return true;
+        };
+        std::vector<Token> expanded;
+        source.lineOfText = first;
+        expand(tokens, expanded, &more);
+        syncLine(first);
+        append(output, expanded);
+        output += '\n';
+        source.outLine = first + 1;
+    }
+    for (const auto &conditional : conditionals) {
+        source.lineOfText = conditional.line;
+        report(true, "unterminated conditional directive");
+    }
+}
+
+void Preprocessor::directive(Source &source, Tokens tokens,
+                             std::vector<Conditional> &conditionals) {
+    for (auto &token : tokens)
+        if (token.kind == Token::Comment) token = Token(Token::Space, " ");
+    // Drop the '#' and the directive name.
+    trim(tokens);
+    tokens.pop_front();
+    trim(tokens);
+    if (tokens.empty()) return;  // the null directive
+    Token name = tokens.front();
+    tokens.pop_front();
+    trim(tokens);
+
+    bool active = conditionals.empty() || conditionals.back().active;
+    const std::string &kind = name.text;
+    if (kind == "if" || kind == "ifdef" || kind == "ifndef") {
+        Conditional conditional{false, true, false, source.lineOfText};
+        if (active) {
+            bool value = false;
+            if (kind == "if") {
+                value = evaluate(std::move(tokens));
+            } else if (tokens.empty() || tokens.front().kind != Token::Identifier) {
+                report(true, "no macro name given in #" + kind + " directive");
+            } else {
+                value = macros.count(tokens.front().text) != 0;
+                if (kind == "ifndef") value = !value;
+            }
+            conditional.active = conditional.taken = value;
+        }
+        conditionals.push_back(conditional);
+        return;
+    }
+    if (kind == "elif" || kind == "else" || kind == "endif") {
+        if (conditionals.empty()) {
+            report(true, "#" + kind + " without #if");
+            return;
+        }
+        auto &conditional = conditionals.back();
+        if (kind == "endif") {
+            conditionals.pop_back();
+            return;
+        }
+        if (conditional.sawElse) {
+            report(true, "#" + kind + " after #else");
+            return;
+        }
+        if (kind == "else") {
+            conditional.sawElse = true;
+            conditional.active = !conditional.taken;
+            conditional.taken = true;
+        } else if (conditional.taken) {
+            conditional.active = false;
+        } else {
+            conditional.active = conditional.taken = evaluate(std::move(tokens));
+        }
+        return;
+    }
+    if (!active) return;
+
+    if (kind == "define") {
+        defineMacro(std::move(tokens));
+    } else if (kind == "undef") {
+        if (tokens.empty() || tokens.front().kind != Token::Identifier)
+            report(true, "no macro name given in #undef directive");
+        else
+            undefine(tokens.front().text);
+    } else if (kind == "include") {
+        include(source, std::move(tokens));
+    } else if (kind == "line" || name.kind == Token::Number) {
+        // Also accept the line markers that cpp writes.
+        if (name.kind == Token::Number) tokens.push_front(name);
+        std::vector<Token> expanded;
+        expand(tokens, expanded, nullptr);
+        Tokens args(expanded.begin(), expanded.end());
+        trim(args);
+        char *end = nullptr;
+        unsigned long line =
+            args.empty() ? 0 : std::strtoul(args.front().text.c_str(), &end, 10);
+        if (args.empty() || args.front().kind != Token::Number || *end != '\0') {
+            report(true, "#line directive requires a line number");
+            return;
+        }
+        args.pop_front();
+        trim(args);
+        if (!args.empty() && args.front().kind == Token::String) {
+            const auto &file = args.front().text;
+            source.name = file.substr(1, file.size() - 2);
+        }
+        source.line = static_cast<unsigned>(line);
+        lineMarker(source.line, source.name);
+    } else if (kind == "error" || kind == "warning") {
+        std::vector<Token> message(tokens.begin(), tokens.end());
+        std::string text;
+        append(text, message);
+        report(kind == "error", "#" + kind + " " + text);
+    } else if (kind == "pragma") {
+        if (tokens.size() == 1 && tokens.front().text == "once") {
+            std::error_code ec;
+            onceOnly.insert(std::filesystem::weakly_canonical(source.path, ec));
+            return;
+        }
+        // Other pragmas are passed on, as cpp does.
+        if (depth == 0) preludeOpen = false;
+        syncLine(source.lineOfText);
+        std::vector<Token> rest(tokens.begin(), tokens.end());
+        output += "#pragma ";
+        append(output, rest);
+        output += '\n';
+        source.outLine = source.lineOfText + 1;
+    } else {
+        report(true, "invalid preprocessing directive #" + kind);
+    }
+}
+
+void Preprocessor::include(Source &source, Tokens tokens) {
+    if (!tokens.empty() && tokens.front().kind == Token::Identifier) {
+        // #include MACRO
+        std::vector<Token> expanded;
+        expand(tokens, expanded, nullptr);
+        tokens.assign(expanded.begin(), expanded.end());
+        trim(tokens);
+    }
+    std::string file;
+    bool quoted = false;
+    if (!tokens.empty() && tokens.front().kind == Token::String) {
+        const auto &text = tokens.front().text;
+        file = text.substr(1, text.size() - 2);
+        quoted = true;
+    } else if (!tokens.empty() && tokens.front().is("<")) {
+        tokens.pop_front();
+        while (!tokens.empty() && !tokens.front().is(">")) {
+            file += tokens.front().text;
+            tokens.pop_front();
+        }
+        if (tokens.empty()) file.clear();
+    }
+    if (file.empty()) {
+        report(true, "#include expects \"FILENAME\" or <FILENAME>");
+        return;
+    }
+
+    std::vector<std::filesystem::path> candidates;
+    if (std::filesystem::path(file).is_absolute()) {
+        candidates.emplace_back(file);
+    } else {
+        if (quoted) candidates.push_back(source.path.parent_path() / file);
+        for (const auto &dir : includeDirs) candidates.push_back(dir / file);
+    }
+    std::error_code ec;
+    auto found = std::find_if(candidates.begin(), candidates.end(), [&](const auto &path) {
+        return std::filesystem::is_regular_file(path, ec);
+    });
+    if (found == candidates.end()) {
+        report(true, "#include file " + file + " not found");
+        return;
+    }
+    if (onceOnly.count(std::filesystem::weakly_canonical(*found, ec))) return;
+    if (depth >= 200) {
+        report(true, "#include nested too deeply");
+        return;
+    }
+    auto text = readSourceFile(*found);
+    if (!text) {
+        report(true, "cannot read " + found->string());
+        return;
+    }
+    if (std::find(included.begin(), included.end(), *found) == included.end())
+        included.push_back(*found);
+
+    if (depth == 0 && preludeOpen) preludeOpen = preludeSelect(*found);
+    bool inPrelude = depth == 0 && preludeOpen;
+    if (inPrelude) std::swap(output, preludeOutput);
+
+    Source nested;
+    nested.text = std::move(text);
+    nested.path = *found;
+    nested.name = found->string();
+    current = &nested;
+    ++depth;
+    lineMarker(1, nested.name, "1");
+    processSource(nested);
+    --depth;
+    current = &source;
+    if (inPrelude) std::swap(output, preludeOutput);
+    lineMarker(source.line, source.name, "2");
+}
+
+void Preprocessor::defineMacro(Tokens tokens) {
+    for (auto &token : tokens)
+        if (token.kind == Token::Comment) token = Token(Token::Space, " ");
+    trim(tokens);
+    if (tokens.empty() || tokens.front().kind != Token::Identifier ||
+        tokens.front().text == "defined") {
+        report(true, "macro names must be identifiers");
+        return;
+    }
+    std::string name = tokens.front().text;
+    tokens.pop_front();
+
+    Macro macro;
+    if (!tokens.empty() && tokens.front().is("(")) {
+        // Only a parenthesis right after the name starts a parameter list.
+        macro.functionLike = true;
+        tokens.pop_front();
+        size_t i = 0;
+        bool ok = false;
+        while (true) {
+            skipSpaces(tokens, i);
+            if (i >= tokens.size()) break;
+            if (tokens[i].is(")") && macro.params.empty()) {
+                ok = true;
+                ++i;
+                break;
+            }
+            if (tokens[i].is("...")) {
+                macro.variadic = true;
+                macro.params.emplace_back("__VA_ARGS__");
+            } else if (tokens[i].kind == Token::Identifier) {
+                macro.params.push_back(tokens[i].text);
+            } else {
+                break;
+            }
+            ++i;
+            skipSpaces(tokens, i);
+            if (i < tokens.size() && tokens[i].is("...") && !macro.variadic) {
+                macro.variadic = true;  // GNU named variadic parameter
+                ++i;
+                skipSpaces(tokens, i);
+            }
+            if (i >= tokens.size()) break;
+            if (tokens[i].is(")")) {
+                ok = true;
+                ++i;
+                break;
+            }
+            if (!tokens[i].is(",") || macro.variadic) break;
+            ++i;
+        }
+        if (!ok) {
+            report(true, "invalid parameter list in definition of macro " + name);
+            return;
+        }
+        tokens.erase(tokens.begin(), tokens.begin() + i);
+    }
+    trim(tokens);
+    for (auto &token : tokens) {
+        if (token.kind == Token::Space) token.text = " ";
+        if (!macro.body.empty() && token.kind == Token::Space &&
+            macro.body.back().kind == Token::Space)
+            continue;
+        macro.body.push_back(token);
+    }
+
+    auto it = macros.find(name);
+    if (it != macros.end() && !(it->second == macro)) report(false, name + " redefined");
+    macros[name] = std::move(macro);
+}
+
+bool Preprocessor::evaluate(Tokens tokens) {
+    // Replace `defined NAME` and `defined(NAME)` before expanding macros.
+    Tokens replaced;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].kind != Token::Identifier || tokens[i].text != "defined") {
+            replaced.push_back(tokens[i]);
+            continue;
+        }
+        size_t j = i + 1;
+        skipSpaces(tokens, j);
+        bool paren = j < tokens.size() && tokens[j].is("(");
+        if (paren) {
+            ++j;
+            skipSpaces(tokens, j);
+        }
+        if (j >= tokens.size() || tokens[j].kind != Token::Identifier) {
+            report(true, "operator \"defined\" requires an identifier");
+            return false;
+        }
+        replaced.emplace_back(Token::Number, macros.count(tokens[j].text) ? "1" : "0");
+        if (paren) {
+            ++j;
+            skipSpaces(tokens, j);
+            if (j >= tokens.size() || !tokens[j].is(")")) {
+                report(true, "missing ')' after \"defined\"");
+                return false;
+            }
+        }
+        i = j;
+    }
+
+    std::vector<Token> expanded;
+    expand(replaced, expanded, nullptr);
+    std::vector<Token> expression;
+    for (auto &token : expanded) {
+        if (token.isSpace() || token.kind == Token::Placemarker) continue;
+        // Identifiers that are not macros are 0.
+        if (token.kind == Token::Identifier) token = Token(Token::Number, "0");
+        expression.push_back(std::move(token));
+    }
+    try {
+        return ExpressionEvaluator(expression).evaluate() != 0;
+    } catch (const std::string &message) {
+        report(true, message);
+        return false;
+    }
+}
+
+bool Preprocessor::collectArgs(const Macro &macro, Tokens &input, std::vector<Tokens> &args,
+                               std::vector<std::string> &rparenHideSet,
+                               const std::function<bool()> *more) {
+    // Skip to the opening parenthesis, which the caller has found.
+    while (!input.front().is("(")) input.pop_front();
+    input.pop_front();
+    args.emplace_back();
+    int nesting = 0;
+    while (true) {
+        if (input.empty() && !(more && (*more)())) {
+            report(true, "unterminated argument list invoking macro");
+            return false;
+        }
+        Token token = std::move(input.front());
+        input.pop_front();
+        if (token.isSpace()) {
+            if (!args.back().empty() && args.back().back().kind == Token::Space) continue;
+            token = Token(Token::Space, " ");
+        }
+        if (token.is(")") && nesting == 0) {
+            rparenHideSet = token.hideSet;
+            break;
+        }
+        if (token.is("(")) ++nesting;
+        if (token.is(")")) --nesting;
+        if (token.is(",") && nesting == 0 &&
+            !(macro.variadic && args.size() == macro.params.size())) {
+            args.emplace_back();
+            continue;
+        }
+        args.back().push_back(std::move(token));
+    }
+    for (auto &arg : args) trim(arg);
+
+    if (macro.params.empty() && args.size() == 1 && args.front().empty()) args.clear();
+    if (macro.variadic && args.size() + 1 == macro.params.size()) args.emplace_back();
+    if (args.size() != macro.params.size()) {
+        report(true, "macro expects " + std::to_string(macro.params.size()) +
+                         " arguments, but " + std::to_string(args.size()) + " were given");
+        return false;
+    }
+    return true;
+}
+
+Tokens Preprocessor::substitute(const Macro &macro, const std::vector<Tokens> &args,
+                                const std::vector<std::string> &hideSet) {
+    Tokens result;
+    const auto &body = macro.body;
+    auto nextNonSpace = [&](size_t i) {
+        ++i;
+        while (i < body.size() && body[i].kind == Token::Space) ++i;
+        return i;
+    };
+    for (size_t i = 0; i < body.size(); ++i) {
+        const Token &token = body[i];
+        size_t next = nextNonSpace(i);
+        if (token.is("#") && macro.functionLike && next < body.size() &&
+            macro.param(body[next]) >= 0) {
+            result.push_back(stringify(args[macro.param(body[next])]));
+            i = next;
+        } else if (token.is("##") && next < body.size()) {
+            while (!result.empty() && result.back().kind == Token::Space) result.pop_back();
+            Tokens right;
+            int param = macro.param(body[next]);
+            if (param < 0)
+                right.push_back(body[next]);
+            else
+                right = args[param];
+            i = next;
+            if (right.empty()) continue;
+            if (result.empty() || result.back().kind == Token::Placemarker) {
+                if (!result.empty()) result.pop_back();
+                result.insert(result.end(), right.begin(), right.end());
+                continue;
+            }
+            std::string pasted = result.back().text + right.front().text;
+            result.pop_back();
+            bool inComment = false;
+            tokenize(pasted, inComment, result);
+            result.insert(result.end(), right.begin() + 1, right.end());
+        } else if (int param = macro.param(token); param >= 0) {
+            const Tokens &arg = args[param];
+            if (next < body.size() && body[next].is("##")) {
+                // Operands of ## are not expanded.
+                if (arg.empty())
+                    result.emplace_back(Token::Placemarker, "");
+                else
+                    result.insert(result.end(), arg.begin(), arg.end());
+            } else {
+                Tokens copy = arg;
+                std::vector<Token> expanded;
+                expand(copy, expanded, nullptr);
+                result.insert(result.end(), expanded.begin(), expanded.end());
+            }
+        } else {
+            result.push_back(token);
+        }
+    }
+    Tokens out;
+    for (auto &token : result) {
+        if (token.kind == Token::Placemarker) continue;
+        for (const auto &name : hideSet)
+            if (!inHideSet(token.hideSet, name)) token.hideSet.push_back(name);
+        token.fromMacro = true;
+        out.push_back(std::move(token));
+    }
+    return out;
+}
+
+void Preprocessor::expand(Tokens &input, std::vector<Token> &out,
+                          const std::function<bool()> *more) {
+    while (!input.empty()) {
+        Token token = std::move(input.front());
+        input.pop_front();
+        if (token.kind != Token::Identifier) {
+            out.push_back(std::move(token));
+            continue;
+        }
+        auto it = macros.find(token.text);
+        if (it == macros.end()) {
+            if (token.text == "__LINE__") {
+                out.emplace_back(Token::Number, std::to_string(current ? current->lineOfText : 0));
+            } else if (token.text == "__FILE__") {
+                out.emplace_back(Token::String,
+                                 "\"" + (current ? current->name : std::string()) + "\"");
+            } else {
+                out.push_back(std::move(token));
+                continue;
+            }
+            out.back().fromMacro = true;
+            continue;
+        }
+        if (inHideSet(token.hideSet, token.text)) {
+            out.push_back(std::move(token));
+            continue;
+        }
+        const Macro &macro = it->second;
+        std::vector<std::string> hideSet = token.hideSet;
+        Tokens expansion;
+        if (!macro.functionLike) {
+            hideSet.push_back(token.text);
+            expansion = substitute(macro, {}, hideSet);
+        } else {
+            // The name only invokes the macro if a parenthesis follows.
+            size_t i = 0;
+            skipSpaces(input, i);
+            while (i == input.size() && more && (*more)()) skipSpaces(input, i);
+            if (i == input.size() || !input[i].is("(")) {
+                out.push_back(std::move(token));
+                continue;
+            }
+            std::vector<Tokens> args;
+            std::vector<std::string> rparenHideSet;
+            if (!collectArgs(macro, input, args, rparenHideSet, more)) continue;
+            // The expansion is hidden from the macros hiding both the name and the ')'.
+            hideSet.erase(std::remove_if(hideSet.begin(), hideSet.end(),
+                                         [&](const std::string &name) {
+                                             return !inHideSet(rparenHideSet, name);
+                                         }),
+                          hideSet.end());
+            hideSet.push_back(token.text);
+            expansion = substitute(macro, args, hideSet);
+        }
+        // Rescan the expansion together with the rest of the input.
+        input.insert(input.begin(), std::make_move_iterator(expansion.begin()),
+                     std::make_move_iterator(expansion.end()));
+    }
+}
+
+}  // namespace P4
@@ -0,0 +1,148 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef FRONTENDS_COMMON_PREPROCESSOR_H_
+#define FRONTENDS_COMMON_PREPROCESSOR_H_
+
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace P4 {
+
+/// A C preprocessor that runs inside the compiler instead of in an external `cpp`
+/// process.  It implements what P4 programs use: #include, object-like and function-like
+/// macros (with the # and ## operators and variadic arguments), #undef, the conditional
+/// directives, #line, #error, #warning and #pragma once, and the __FILE__ and __LINE__
+/// macros.  Like `cpp -C -undef -nostdinc`, it keeps comments, predefines nothing else,
+/// and only searches the include directories it is given.  Its output has the same line
+/// markers as the output of `cpp`, so the lexers can map positions back to the sources.
+///
+/// Each Preprocessor handles one compilation; the files it reads are cached for the
+/// whole process (see readSourceFile()).
+class Preprocessor {
+ public:
+    explicit Preprocessor(std::vector<std::filesystem::path> includeDirs = {});
+
+    /// Adds a directory to search for included files, after the ones already added.
+    void addIncludeDir(std::filesystem::path dir);
+    /// Defines a macro as the -D option does: @p definition is `NAME`, which defines
+    /// NAME as 1, or `NAME=body`, where NAME may be followed by a parameter list.
+    void define(std::string_view definition);
+    /// Removes the definition of macro @p name, as the -U option does.
+    void undefine(std::string_view name);
+
+    /// Preprocesses @p file.
+    /// @return the output, or std::nullopt if errors were reported.
+    std::optional<std::string> processFile(const std::filesystem::path &file);
+    /// Preprocesses @p source, using @p fileName as its name in line markers and
+    /// to find files included with "".
+    std::optional<std::string> processString(std::string_view source,
+                                             const std::filesystem::path &fileName);
+
+    /// @return the files that were included, in the order they were first read.
+    const std::vector<std::filesystem::path> &includedFiles() const { return included; }
+
+    /// Makes the next process*() calls put the files included at the start of the main
+    /// file for which @p select returns true in a separate output, the prelude.  The
+    /// prelude ends with the first other text of the main file: its code, a pragma, or
+    /// an include of a file that is not selected.  The declarations it contains come
+    /// before the rest of the output, which can then be parsed on its own after them.
+    void separatePrelude(std::function<bool(const std::filesystem::path &)> select) {
+        preludeSelect = std::move(select);
+    }
+    /// @return the prelude of the last file processed; empty if there was none.
+    const std::string &prelude() const { return preludeOutput; }
+
+    /// @return the contents of @p file, or nullptr if it cannot be read.  The contents are
+    /// cached for the whole process, and read again if the file is modified.
+    static std::shared_ptr<const std::string> readSourceFile(const std::filesystem::path &file);
+    /// Empties the cache used by readSourceFile().
+    static void clearSourceCache();
+
+    /// A preprocessing token.
+    struct Token {
+        enum Kind { Identifier, Number, String, Punct, Space, Comment, Placemarker };
+        Kind kind;
+        std::string text;
+        /// Macros that must not be expanded from this token, as it came from their expansion.
+        std::vector<std::string> hideSet;
+        bool fromMacro = false;
+
+        Token(Kind kind, std::string text) : kind(kind), text(std::move(text)) {}
+        bool is(const char *punct) const { return kind == Punct && text == punct; }
+        bool isSpace() const { return kind == Space || kind == Comment; }
+        bool operator==(const Token &other) const {
+            return kind == other.kind && text == other.text;
+        }
+    };
+    using Tokens = std::deque<Token>;
+
+ private:
+    struct Macro {
+        bool functionLike = false;
+        bool variadic = false;
+        std::vector<std::string> params;  // ends with __VA_ARGS__ if variadic
+        std::vector<Token> body;          // whitespace collapsed, without leading and trailing
+
+        bool operator==(const Macro &other) const {
+            return functionLike == other.functionLike && variadic == other.variadic &&
+                   params == other.params && body == other.body;
+        }
+        /// @return the index of the parameter @p token names, or -1.
+        int param(const Token &token) const;
+    };
+    struct Source;
+    struct Conditional;
+
+    std::vector<std::filesystem::path> includeDirs;
+    std::map<std::string, Macro, std::less<>> macros;
+    /// Files that contained `#pragma once`.
+    std::set<std::filesystem::path> onceOnly;
+    std::vector<std::filesystem::path> included;
+    std::string output;
+    std::function<bool(const std::filesystem::path &)> preludeSelect;
+    std::string preludeOutput;
+    bool preludeOpen = false;
+    Source *current = nullptr;
+    unsigned depth = 0;
+    bool failed = false;
+
+    std::optional<std::string> run(std::shared_ptr<const std::string> text,
+                                   const std::filesystem::path &file);
+    void processSource(Source &source);
+    void directive(Source &source, Tokens tokens, std::vector<Conditional> &conditionals);
+    void include(Source &source, Tokens tokens);
+    void defineMacro(Tokens tokens);
+    bool evaluate(Tokens tokens);
+    void expand(Tokens &input, std::vector<Token> &out, const std::function<bool()> *more);
+    Tokens substitute(const Macro &macro, const std::vector<Tokens> &args,
+                      const std::vector<std::string> &hideSet);
+    bool collectArgs(const Macro &macro, Tokens &input, std::vector<Tokens> &args,
+                     std::vector<std::string> &rparenHideSet, const std::function<bool()> *more);
+    void lineMarker(unsigned line, const std::string &file, const char *flag = nullptr);
+    void syncLine(unsigned line);
+    void report(bool isError, const std::string &message);
+};
+
+}  // namespace P4
+
+#endif /* FRONTENDS_COMMON_PREPROCESSOR_H_ */
@@ -0,0 +1,150 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "programMap.h"
+
+#include "ir/visitor.h"
+
+namespace P4 {
+
+namespace {
+
+/// Adds the names a top-level object declares to @p names.
+/// @return false if we don't know which names it declares.
+bool declaredNames(const IR::Node *node, absl::flat_hash_set<cstring, Util::Hash> &names) {
+    if (const auto *matchKind = node->to<IR::Declaration_MatchKind>()) {
+        // match_kind members are referred to without qualification
+        for (const auto *member : matchKind->members) names.insert(member->name.name);
+        return true;
+    }
+    if (const auto *decl = node->to<IR::IDeclaration>()) {
+        names.insert(decl->getName().name);
+        return true;
+    }
+    return false;
+}
+
+class CollectReferences : public Inspector {
+    std::vector<cstring> &names;
+    absl::flat_hash_set<cstring, Util::Hash> seen;
+
+    bool preorder(const IR::Path *path) override {
+        if (seen.insert(path->name.name).second) names.push_back(path->name.name);
+        return false;
+    }
+
+ public:
+    explicit CollectReferences(std::vector<cstring> &names) : names(names) {
+        setName("CollectReferences");
+    }
+};
+
+/// Collects all nodes below the visited ones, except those in @p skip.
+class CollectNodes : public Inspector {
+    ProgramMap::NodeSet &nodes;
+    const ProgramMap::NodeSet *skip;
+
+    bool preorder(const IR::Node *node) override {
+        if (skip && skip->count(node)) return false;
+        return nodes.insert(node).second;
+    }
+
+ public:
+    explicit CollectNodes(ProgramMap::NodeSet &nodes, const ProgramMap::NodeSet *skip = nullptr)
+        : nodes(nodes), skip(skip) {
+        setName("CollectNodes");
+    }
+};
+
+}  // namespace
+
+const std::vector<cstring> &ProgramMap::referencesOf(const IR::Node *declaration) {
+    auto [it, inserted] = references.try_emplace(declaration);
+    if (inserted) {
+        CollectReferences collect(it->second);
+        declaration->apply(collect);
+    }
+    return it->second;
+}
+
+std::optional<ProgramMap::Changes> ProgramMap::changesSince(const IR::P4Program *newProgram) {
+    // The program is only recorded once the map is complete.
+    const IR::P4Program *oldProgram = program;
+    if (oldProgram == nullptr || oldProgram == fake || newProgram == nullptr) return std::nullopt;
+
+    absl::flat_hash_map<const IR::Node *, size_t, Util::Hash> oldIndex;
+    for (size_t i = 0; i < oldProgram->objects.size(); ++i)
+        oldIndex.emplace(oldProgram->objects[i], i);
+
+    // Names whose meaning may have changed: those declared by objects that were
+    // added or removed, and then by objects that refer to such names.
+    absl::flat_hash_set<cstring, Util::Hash> changedNames;
+    const auto &objects = newProgram->objects;
+    std::vector<bool> keep(objects.size(), false);
+    NodeSet inNewProgram;
+    std::optional<size_t> lastIndex;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        inNewProgram.insert(objects[i]);
+        auto it = oldIndex.find(objects[i]);
+        if (it == oldIndex.end()) {
+            if (!declaredNames(objects[i], changedNames)) return std::nullopt;
+            continue;
+        }
+        // Declarations that moved may see different declarations before them.
+        if (lastIndex && it->second <= *lastIndex) {
+            LOG2(mapKind << ": declarations were reordered");
+            return std::nullopt;
+        }
+        lastIndex = it->second;
+        keep[i] = true;
+    }
+    for (const auto *object : oldProgram->objects)
+        if (!inNewProgram.count(object) && !declaredNames(object, changedNames))
+            return std::nullopt;
+
+    for (bool progress = true; progress;) {
+        progress = false;
+        for (size_t i = 0; i < objects.size(); ++i) {
+            if (!keep[i]) continue;
+            for (auto name : referencesOf(objects[i])) {
+                if (!changedNames.count(name)) continue;
+                if (!declaredNames(objects[i], changedNames)) return std::nullopt;
+                keep[i] = false;
+                progress = true;
+                break;
+            }
+        }
+    }
+
+    Changes changes;
+    NodeSet retained;
+    CollectNodes collectRetained(retained);
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (!keep[i]) continue;
+        changes.unchanged.insert(objects[i]);
+        objects[i]->apply(collectRetained);
+    }
+    CollectNodes collectStale(changes.stale, &retained);
+    for (size_t i = 0; i < objects.size(); ++i)
+        if (!keep[i]) objects[i]->apply(collectStale);
+    for (const auto *object : oldProgram->objects) object->apply(collectStale);
+
+    // Only cache references for declarations that can still be seen again.
+    absl::erase_if(references, [&](const auto &entry) { return !inNewProgram.count(entry.first); });
+    LOG2(mapKind << ": " << changes.unchanged.size() << " of " << objects.size()
+                 << " declarations unchanged");
+    return changes;
+}
+
+}  // namespace P4
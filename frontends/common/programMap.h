@@ -17,6 +17,11 @@ limitations under the License.
 #ifndef FRONTENDS_COMMON_PROGRAMMAP_H_
 #define FRONTENDS_COMMON_PROGRAMMAP_H_
 
+#include <optional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "ir/ir.h"
 #include "lib/log.h"
 
@@ -26,6 +31,9 @@ namespace P4 {
 // A map is computed on a certain P4Program.
 // If the program has not changed, the map is up-to-date.
 class ProgramMap : public IHasDbPrint {
+ public:
+    using NodeSet = absl::flat_hash_set<const IR::Node *, Util::Hash>;
+
  protected:
     const IR::P4Program *fake = new IR::P4Program();
     const IR::P4Program *program = nullptr;
@@ -33,6 +41,28 @@ class ProgramMap : public IHasDbPrint {
     explicit ProgramMap(std::string_view kind) : mapKind(kind) {}
     virtual ~ProgramMap() {}
 
+    /// How a new program differs from the one the map was computed for.
+    struct Changes {
+        /// Top-level objects of the new program whose entries are still valid:
+        /// they are the same nodes as before, and do not refer, directly or
+        /// transitively, to a top-level declaration that was added, removed or replaced.
+        NodeSet unchanged;
+        /// Nodes below all other top-level objects, in either program, that are
+        /// not shared with an unchanged one; their entries must be recomputed.
+        NodeSet stale;
+    };
+    /// Compare @p newProgram with the program the map was computed for.
+    /// @return std::nullopt if the map must be recomputed from scratch: it is not
+    /// complete, the unchanged declarations were reordered, or a changed object
+    /// declares names that we cannot tell.
+    std::optional<Changes> changesSince(const IR::P4Program *newProgram);
+
+ private:
+    // Names referenced by each top-level declaration seen by changesSince();
+    // declarations are immutable, so this survives across programs.
+    absl::flat_hash_map<const IR::Node *, std::vector<cstring>, Util::Hash> references;
+    const std::vector<cstring> &referencesOf(const IR::Node *declaration);
+
  public:
     // Check if map is up-to-date for the specified node; return true if it is
     bool checkMap(const IR::Node *node) const {
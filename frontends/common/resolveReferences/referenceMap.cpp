@@ -39,6 +39,31 @@ void ReferenceMap::clear() {
     ProgramMap::clear();
 }
 
+ProgramMap::NodeSet ReferenceMap::retainUnchanged(const IR::Node *node) {
+    std::optional<Changes> changes;
+    if (const auto *newProgram = node->to<IR::P4Program>()) changes = changesSince(newProgram);
+    if (!changes) {
+        clear();
+        return {};
+    }
+    for (const auto *stale : changes->stale) {
+        if (const auto *path = stale->to<IR::Path>())
+            pathToDeclaration.erase(path);
+        else if (const auto *pointer = stale->to<IR::This>())
+            thisToDeclaration.erase(pointer);
+    }
+    // Names stay used: that only makes newName() more conservative.
+    used.clear();
+    for (const auto &[_, decl] : pathToDeclaration) used.insert(decl);
+    ProgramMap::clear();
+    return std::move(changes->unchanged);
+}
+
+bool ReferenceMap::sameResolution(const ReferenceMap &other) const {
+    return pathToDeclaration == other.pathToDeclaration &&
+           thisToDeclaration == other.thisToDeclaration && used == other.used;
+}
+
 void ReferenceMap::setDeclaration(const IR::Path *path, const IR::IDeclaration *decl) {
     CHECK_NULL(path);
     CHECK_NULL(decl);
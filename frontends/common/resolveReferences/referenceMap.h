@@ -112,6 +112,16 @@ class ReferenceMap final : public ProgramMap, public NameGenerator, public Decla
     /// Clear the reference map
     void clear();
 
+    /// Prepare the map for resolving @p node, which replaces the program the map was
+    /// computed for: only the resolutions below the declarations that changed are
+    /// forgotten (see ProgramMap::changesSince).  Clears the map if @p node is not a
+    /// program or the map cannot be patched.
+    /// @return the top-level declarations whose paths are all still resolved.
+    NodeSet retainUnchanged(const IR::Node *node);
+
+    /// @returns @true if both maps resolve the same paths to the same declarations.
+    bool sameResolution(const ReferenceMap &other) const;
+
     /// @returns @true if this map is for a P4_14 program
     bool isV1() const { return isv1; }
 
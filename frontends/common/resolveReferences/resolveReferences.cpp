@@ -379,12 +379,41 @@ void ResolveReferences::checkShadowing(const IR::INamespace *ns) const {
 
 Visitor::profile_t ResolveReferences::init_apply(const IR::Node *node) {
     anyOrder = refMap->isV1();
+    unchanged.clear();
     // Check shadowing even if the program map is up-to-date.
-    if (!refMap->checkMap(node) || checkShadow) refMap->clear();
+    if (checkShadow)
+        refMap->clear();
+    else if (!refMap->checkMap(node))
+        unchanged = refMap->retainUnchanged(node);
     return Inspector::init_apply(node);
 }
 
-void ResolveReferences::end_apply(const IR::Node *node) { refMap->updateMap(node); }
+void ResolveReferences::end_apply(const IR::Node *node) {
+    refMap->updateMap(node);
+#ifndef NDEBUG
+    // Check the patched map against one built from scratch.
+    if (!unchanged.empty() && ::P4::errorCount() == 0) {
+        ReferenceMap full;
+        full.setIsV1(refMap->isV1());
+        ResolveReferences resolve(&full);
+        resolve.setCalledBy(this);
+        node->apply(resolve);
+        BUG_CHECK(refMap->sameResolution(full),
+                  "Incrementally updated reference map differs from a full rebuild");
+    }
+#endif
+}
+
+const IR::Node *ResolveReferences::apply_visitor(const IR::Node *node, const char *name) {
+    // Skip the top-level declarations that are still resolved.  P4Program visits its
+    // objects inline and the child's context is not pushed yet, so the innermost
+    // context (getChildContext, not getContext) is the program itself.
+    if (node && unchanged.count(node)) {
+        const auto *ctxt = getChildContext();
+        if (ctxt && ctxt->node->is<IR::P4Program>()) return node;
+    }
+    return Inspector::apply_visitor(node, name);
+}
 
 // Visitor methods
 
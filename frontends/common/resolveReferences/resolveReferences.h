@@ -128,6 +128,10 @@ class ResolveReferences : public Inspector, private ResolutionContext {
     /// If @true, then warn if one declaration shadows another.
     bool checkShadow;
 
+    /// Top-level declarations whose paths are still resolved in the refMap
+    /// from an earlier version of the program; they are not visited again.
+    ProgramMap::NodeSet unchanged;
+
  private:
     /// Resolve @p path; if @p isType is `true` then resolution will
     /// only return type nodes.
@@ -138,6 +142,7 @@ class ResolveReferences : public Inspector, private ResolutionContext {
 
     Visitor::profile_t init_apply(const IR::Node *node) override;
     void end_apply(const IR::Node *node) override;
+    const IR::Node *apply_visitor(const IR::Node *node, const char *name = nullptr) override;
 
     bool preorder(const IR::Type_Name *type) override;
     bool preorder(const IR::PathExpression *path) override;
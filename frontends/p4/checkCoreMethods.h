@@ -35,6 +35,7 @@ class DoCheckCoreMethods : public Inspector, public ResolutionContext {
     explicit DoCheckCoreMethods(TypeMap *typeMap) : typeMap(typeMap) {
         CHECK_NULL(typeMap);
         setName("DoCheckCoreMethods");
+        visitOnlySubtreesContaining<IR::MethodCallExpression>();
     }
 
     void postorder(const IR::MethodCallExpression *expr) override;
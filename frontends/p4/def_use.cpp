@@ -40,6 +40,12 @@ T *StorageFactory::construct(const IR::Type *type, cstring name) const {
     return storageLocations.emplace_back(new T(type, name)).get()->template to<T>();
 }
 
+BaseLocation *StorageFactory::constructBase(const IR::Type *type, cstring name) const {
+    auto *result = construct<BaseLocation>(type, name);
+    result->index = baseLocations++;
+    return result;
+}
+
 StorageLocation *StorageFactory::create(const IR::Type *type, cstring name) const {
     if (type->is<IR::Type_Bits>() || type->is<IR::Type_Boolean>() || type->is<IR::Type_Varbits>() ||
         type->is<IR::Type_Enum>() || type->is<IR::Type_SerEnum>() || type->is<IR::Type_Error>() ||
@@ -48,7 +54,7 @@ StorageLocation *StorageFactory::create(const IR::Type *type, cstring name) cons
         type->is<IR::Type_Var>() ||
         // Also for newtype
         type->is<IR::Type_Newtype>())
-        return construct<BaseLocation>(type, name);
+        return constructBase(type, name);
 
     if (auto bl = type->to<IR::Type_BaseList>()) {
         // A tuple with no fields is treated like a base location.
@@ -59,7 +65,7 @@ StorageLocation *StorageFactory::create(const IR::Type *type, cstring name) cons
         // assignments do something: they intialize the value
         // (although it's not clear what an uninitialized value of
         // type empty tuple could be).
-        if (bl->getSize() == 0) return construct<BaseLocation>(type, name);
+        if (bl->getSize() == 0) return constructBase(type, name);
 
         // Tuple and List
         auto *result = construct<TupleLocation>(type, name);
@@ -76,7 +82,7 @@ StorageLocation *StorageFactory::create(const IR::Type *type, cstring name) cons
     if (auto st = type->to<IR::Type_StructLike>()) {
         if (st->is<IR::Type_Struct>() && st->fields.size() == 0)
             // See the comment above about empty tuples
-            return construct<BaseLocation>(type, name);
+            return constructBase(type, name);
         auto *result = construct<StructLocation>(type, name);
 
         // For header unions we will model all of the valid fields
@@ -180,6 +186,8 @@ const LocationSet *LocationSet::join(const LocationSet *other) const {
     if (other == LocationSet::empty) return this;
     auto result = new LocationSet(locations);
     for (auto e : other->locations) result->add(e);
+    if (canonicalBits && other->canonicalBits)
+        result->canonicalBits = *canonicalBits | *other->canonicalBits;
     return result;
 }
 
@@ -258,11 +266,17 @@ void LocationSet::addCanonical(const StorageLocation *location) {
     }
 }
 
-bool LocationSet::overlaps(const LocationSet *other) const {
-    for (auto s : locations) {
-        if (other->locations.find(s) != other->locations.end()) return true;
+const bitvec &LocationSet::canonicalIndices() const {
+    if (!canonicalBits) {
+        canonicalBits.emplace();
+        for (const auto *location : canonical())
+            canonicalBits->setbit(location->to<BaseLocation>()->getIndex());
     }
-    return false;
+    return *canonicalBits;
+}
+
+bool LocationSet::overlaps(const LocationSet *other) const {
+    return canonicalIndices().intersects(other->canonicalIndices());
 }
 
 bool LocationSet::operator==(const LocationSet &other) const {
@@ -293,43 +307,32 @@ bool ProgramPoint::operator==(const ProgramPoint &other) const {
 std::size_t ProgramPoint::hash() const { return Util::hash_range(stack.begin(), stack.end()); }
 
 void ProgramPoints::add(const ProgramPoints *from) {
-    points.insert(from->points.begin(), from->points.end());
+    checkNumbering(from);
+    if (numbering == nullptr) numbering = from->numbering;
+    points |= from->points;
 }
 
 const ProgramPoints *ProgramPoints::merge(const ProgramPoints *with) const {
-    auto *result = new ProgramPoints(points);
-    result->points.insert(with->points.begin(), with->points.end());
+    checkNumbering(with);
+    if (this == with || points.contains(with->points)) return this;
+    if (with->points.contains(points)) return with;
+    auto *result = new ProgramPoints(*this);
+    result->add(with);
     return result;
 }
 
-bool ProgramPoints::operator==(const ProgramPoints &other) const {
-    if (points.size() != other.points.size()) return false;
-    for (auto p : points)
-        if (other.points.find(p) == other.points.end()) return false;
-    return true;
-}
-
 Definitions *Definitions::joinDefinitions(const Definitions *other) const {
-    auto result = new Definitions();
+    auto result = new Definitions(*this);
+    result->unreachable = unreachable && other->unreachable;
     for (auto d : other->definitions) {
-        auto loc = d.first;
-        auto defs = d.second;
-        auto current = ::P4::get(definitions, loc);
-        if (current != nullptr) {
-            auto merged = current->merge(defs);
-            result->definitions.emplace(loc, merged);
-        } else {
-            result->definitions.emplace(loc, defs);
-        }
-    }
-    for (auto d : definitions) {
-        auto loc = d.first;
-        auto defs = d.second;
-        auto current = ::P4::get(other->definitions, loc);
-        if (current == nullptr) result->definitions.emplace(loc, defs);
-        // otherwise have have already done it in the loop above
+        // hvec_map::emplace overwrites the value of an existing key, so look it up first.
+        auto it = result->definitions.find(d.first);
+        if (it == result->definitions.end())
+            result->definitions.emplace(d.first, d.second);
+        else if (it->second != d.second)
+            // Most locations are not written on either side, and share their points.
+            it->second = it->second->merge(d.second);
     }
-    if (unreachable && other->unreachable) result->setUnreachable();
     return result;
 }
 
@@ -352,17 +355,23 @@ void Definitions::removeLocation(const StorageLocation *location) {
 }
 
 const ProgramPoints *Definitions::getPoints(const LocationSet &locations) const {
-    ProgramPoints *result = new ProgramPoints();
+    const ProgramPoints *result = nullptr;
+    ProgramPoints *merged = nullptr;
     for (const auto *sl : locations.canonical()) {
         const auto *points = getPoints(sl->to<BaseLocation>());
-        result->add(points);
+        if (result == nullptr) {
+            result = points;
+        } else if (points != result) {
+            if (merged == nullptr) result = merged = new ProgramPoints(*result);
+            merged->add(points);
+        }
     }
-    return result;
+    return result ? result : new ProgramPoints();
 }
 
-Definitions *Definitions::writes(ProgramPoint point, const LocationSet &locations) const {
+Definitions *Definitions::writes(const ProgramPoints *points,
+                                 const LocationSet &locations) const {
     auto result = new Definitions(*this);
-    auto points = new ProgramPoints(point);
     for (auto l : locations.canonical()) result->setDefinition(l->to<BaseLocation>(), points);
     return result;
 }
@@ -372,7 +381,7 @@ bool Definitions::operator==(const Definitions &other) const {
     for (auto d : definitions) {
         auto od = ::P4::get(other.definitions, d.first);
         if (od == nullptr) return false;
-        if (!d.second->operator==(*od)) return false;
+        if (od != d.second && !d.second->operator==(*od)) return false;
     }
     return true;
 }
@@ -391,8 +400,8 @@ void ComputeWriteSet::enterScope(const IR::ParameterList *parameters,
     if (!clear) defs = currentDefinitions;
     if (defs == nullptr) defs = new Definitions();
 
-    auto startPoints = new ProgramPoints(entryPoint);
-    auto uninit = new ProgramPoints(ProgramPoint::beforeStart);
+    auto startPoints = allDefinitions->pointsOf(entryPoint);
+    auto uninit = allDefinitions->pointsOf(ProgramPoint::beforeStart);
 
     if (parameters != nullptr) {
         for (auto p : parameters->parameters) {
@@ -866,7 +875,7 @@ bool ComputeWriteSet::preorder(const IR::IfStatement *statement) {
     visit(statement->condition);
     auto cond = getWrites(statement->condition);
     // defs are the definitions after evaluating the condition
-    auto defs = currentDefinitions->writes(getProgramPoint(), *cond);
+    auto defs = currentDefinitions->writes(currentPoints(), *cond);
     (void)setDefinitions(defs, statement->condition, false);
     visit(statement->ifTrue);
     auto result = currentDefinitions;
@@ -893,7 +902,7 @@ bool ComputeWriteSet::preorder(const IR::ForStatement *statement) {
         visit(statement->condition, "condition");
         auto cond = getWrites(statement->condition);
         // exitDefs are the definitions after evaluating the condition
-        exitDefs = currentDefinitions->writes(getProgramPoint(), *cond);
+        exitDefs = currentDefinitions->writes(currentPoints(), *cond);
         (void)setDefinitions(exitDefs, statement->condition, true);
         visit(statement->body, "body");
         currentDefinitions = currentDefinitions->joinDefinitions(continueDefinitions);
@@ -925,7 +934,7 @@ bool ComputeWriteSet::preorder(const IR::ForInStatement *statement) {
         visit(statement->ref, "ref");
         lhs = false;
         auto cond = getWrites(statement->ref);
-        auto defs = currentDefinitions->writes(getProgramPoint(), *cond);
+        auto defs = currentDefinitions->writes(currentPoints(), *cond);
         (void)setDefinitions(defs, statement->ref, true);
         visit(statement->body, "body");
         currentDefinitions = currentDefinitions->joinDefinitions(continueDefinitions);
@@ -992,7 +1001,7 @@ bool ComputeWriteSet::preorder(const IR::BaseAssignmentStatement *statement) {
     auto l = getWrites(statement->left);
     auto r = getWrites(statement->right);
     locs = l->join(r);
-    auto defs = currentDefinitions->writes(getProgramPoint(), *locs);
+    auto defs = currentDefinitions->writes(currentPoints(), *locs);
     return setDefinitions(defs);
 }
 
@@ -1001,7 +1010,7 @@ bool ComputeWriteSet::preorder(const IR::SwitchStatement *statement) {
     if (currentDefinitions->isUnreachable()) return setDefinitions(currentDefinitions);
     visit(statement->expression);
     auto locs = getWrites(statement->expression);
-    auto defs = currentDefinitions->writes(getProgramPoint(statement->expression), *locs);
+    auto defs = currentDefinitions->writes(currentPoints(statement->expression), *locs);
     (void)setDefinitions(defs, statement->expression, false);
     auto save = currentDefinitions;
     auto result = new Definitions();
@@ -1126,7 +1135,7 @@ bool ComputeWriteSet::preorder(const IR::MethodCallStatement *statement) {
     lhs = false;
     visit(statement->methodCall);
     auto locs = getWrites(statement->methodCall);
-    auto defs = currentDefinitions->writes(getProgramPoint(), *locs);
+    auto defs = currentDefinitions->writes(currentPoints(), *locs);
     return setDefinitions(defs, statement, true);  // overwrite
 }
 
@@ -17,16 +17,19 @@ limitations under the License.
 #ifndef FRONTENDS_P4_DEF_USE_H_
 #define FRONTENDS_P4_DEF_USE_H_
 
-#include "absl/container/flat_hash_set.h"
+#include <optional>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/container/node_hash_set.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "ir/ir.h"
 #include "lib/alloc_trace.h"
+#include "lib/bitvec.h"
 #include "lib/flat_map.h"
 #include "lib/hash.h"
 #include "lib/hvec_map.h"
-#include "lib/ordered_set.h"
+#include "lib/hvec_set.h"
 #include "typeMap.h"
 
 namespace P4 {
@@ -98,6 +101,11 @@ class StorageLocation : public IHasDbPrint, public ICastable {
 /** Represents a storage location with a simple type or a tuple type.
     It could be either a scalar variable, or a field of a struct, etc. */
 class BaseLocation : public StorageLocation {
+    /// Numbers the base locations created by a StorageFactory densely, so that sets of
+    /// them can be represented as bit vectors.
+    unsigned index = 0;
+    friend class StorageFactory;
+
  public:
     BaseLocation(const IR::Type *type, cstring name) : StorageLocation(type, name) {
         if (auto tt = type->to<IR::Type_Tuple>())
@@ -116,6 +124,7 @@ class BaseLocation : public StorageLocation {
     void addValidBits(LocationSet *) const override {}
     void addLastIndexField(LocationSet *) const override {}
     void removeHeaders(LocationSet *result) const override;
+    unsigned getIndex() const { return index; }
 
     DECLARE_TYPEINFO(BaseLocation, StorageLocation);
 };
@@ -235,9 +244,11 @@ class ArrayLocation : public IndexedLocation {
 class StorageFactory {
     // FIXME: Allocate StorageLocations from an arena, not global allocator
     mutable std::vector<std::unique_ptr<StorageLocation>> storageLocations;
+    mutable unsigned baseLocations = 0;
 
     template <class T>
     T *construct(const IR::Type *type, cstring name) const;
+    BaseLocation *constructBase(const IR::Type *type, cstring name) const;
 
     static constexpr std::string_view indexFieldName = "$last_index";
 
@@ -250,8 +261,12 @@ class StorageFactory {
 /// A set of locations that may be read or written by a computation.
 /// In general this is a conservative approximation of the actual location set.
 class LocationSet : public IHasDbPrint {
-    using LocationsStorage = ordered_set<const StorageLocation *>;
+    // Insertion ordered, so iteration is deterministic; the vector of entries is
+    // much cheaper to build and walk than the list and tree of an ordered_set.
+    using LocationsStorage = hvec_set<const StorageLocation *>;
     LocationsStorage locations;
+    /// The indices of the base locations of the canonical set; computed when needed.
+    mutable std::optional<bitvec> canonicalBits;
 
     class canonical_iterator {
         absl::InlinedVector<const StorageLocation *, 8> workList;
@@ -312,7 +327,7 @@ class LocationSet : public IHasDbPrint {
 
  public:
     LocationSet() = default;
-    explicit LocationSet(const ordered_set<const StorageLocation *> &other) : locations(other) {}
+    explicit LocationSet(const LocationsStorage &other) : locations(other) {}
     explicit LocationSet(const StorageLocation *location) {
         CHECK_NULL(location);
         locations.emplace(location);
@@ -327,7 +342,7 @@ class LocationSet : public IHasDbPrint {
 
     void add(const StorageLocation *location) {
         CHECK_NULL(location);
-        locations.emplace(location);
+        if (locations.emplace(location).second) canonicalBits.reset();
     }
     const LocationSet *join(const LocationSet *other) const;
     /// @returns this location set expressed only in terms of BaseLocation;
@@ -339,6 +354,9 @@ class LocationSet : public IHasDbPrint {
     auto canon_begin() const { return canonical_iterator(locations); }
     auto canon_end() const { return canonical_iterator(); }
     auto canonical() const { return Util::iterator_range(canon_begin(), canon_end()); }
+    /// @returns the indices (see BaseLocation::getIndex) of the base locations in the
+    /// canonical form of this set.
+    const bitvec &canonicalIndices() const;
 
     void dbprint(std::ostream &out) const override {
         if (locations.empty()) out << "LocationSet::empty";
@@ -347,7 +365,8 @@ class LocationSet : public IHasDbPrint {
             out << " ";
         }
     }
-    // only defined for canonical representations
+    /// True if the two sets share a base location; only meaningful for sets of
+    /// locations created by the same StorageFactory.
     bool overlaps(const LocationSet *other) const;
     bool operator==(const LocationSet &other) const;
     bool isEmpty() const { return locations.empty(); }
@@ -472,28 +491,89 @@ struct Hasher<P4::loc_t> {
 }  // namespace P4::Util
 
 namespace P4 {
+/// Numbers the program points seen by an analysis, so that sets of them can be
+/// represented as bit vectors.  ProgramPoint::beforeStart is always number 0.
+class ProgramPointNumbering {
+    std::vector<ProgramPoint> points;
+    absl::flat_hash_map<ProgramPoint, unsigned, Util::Hash> numbers;
+
+ public:
+    ProgramPointNumbering() { number(ProgramPoint::beforeStart); }
+    ProgramPointNumbering(const ProgramPointNumbering &) = delete;
+
+    unsigned number(const ProgramPoint &point) {
+        auto [it, inserted] = numbers.emplace(point, points.size());
+        if (inserted) points.push_back(point);
+        return it->second;
+    }
+    const ProgramPoint &point(unsigned number) const { return points.at(number); }
+    size_t size() const { return points.size(); }
+};
+
+/// A set of program points, stored as a bit vector of their numbers.  Sets can only
+/// be combined with sets that use the same ProgramPointNumbering; the empty set
+/// adopts the numbering of the first set added to it.
 class ProgramPoints : public IHasDbPrint {
-    typedef absl::flat_hash_set<ProgramPoint, Util::Hash> Points;
-    Points points;
-    explicit ProgramPoints(const Points &points) : points(points) {}
+    const ProgramPointNumbering *numbering = nullptr;
+    bitvec points;
+
+    void checkNumbering(const ProgramPoints *other) const {
+        BUG_CHECK(numbering == other->numbering || numbering == nullptr ||
+                      other->numbering == nullptr,
+                  "combining program points of different analyses");
+    }
 
  public:
+    class const_iterator {
+        const ProgramPointNumbering *numbering;
+        bitvec::const_bitref bit;
+
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ProgramPoint;
+        using difference_type = ptrdiff_t;
+        using pointer = const ProgramPoint *;
+        using reference = const ProgramPoint &;
+
+        const_iterator(const ProgramPointNumbering *numbering, bitvec::const_bitref bit)
+            : numbering(numbering), bit(bit) {}
+        const_iterator &operator++() {
+            ++bit;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto copy = *this;
+            ++bit;
+            return copy;
+        }
+        bool operator==(const const_iterator &i) const { return bit == i.bit; }
+        bool operator!=(const const_iterator &i) const { return bit != i.bit; }
+        reference operator*() const { return numbering->point(*bit); }
+        pointer operator->() const { return &numbering->point(*bit); }
+    };
+
     ProgramPoints() = default;
-    explicit ProgramPoints(ProgramPoint point) { points.emplace(point); }
+    ProgramPoints(ProgramPointNumbering *numbering, const ProgramPoint &point)
+        : numbering(numbering) {
+        CHECK_NULL(numbering);
+        points.setbit(numbering->number(point));
+    }
     void add(const ProgramPoints *from);
+    /// @returns the union of the two sets; one of them if it contains the other.
     const ProgramPoints *merge(const ProgramPoints *with) const;
-    bool operator==(const ProgramPoints &other) const;
+    bool operator==(const ProgramPoints &other) const {
+        checkNumbering(&other);
+        return points == other.points;
+    }
     void dbprint(std::ostream &out) const override {
         out << "{";
-        for (auto p : points) out << p << " ";
+        for (const auto &p : *this) out << p << " ";
         out << "}";
     }
-    size_t size() const { return points.size(); }
-    bool containsBeforeStart() const {
-        return points.find(ProgramPoint::beforeStart) != points.end();
-    }
-    Points::const_iterator begin() const { return points.cbegin(); }
-    Points::const_iterator end() const { return points.cend(); }
+    size_t size() const { return points.popcount(); }
+    bool containsBeforeStart() const { return points.getbit(0); }
+    const_iterator begin() const { return const_iterator(numbering, points.begin()); }
+    const_iterator end() const { return const_iterator(numbering, points.end()); }
 };
 
 /// List of definers for each base storage (at a specific program point).
@@ -510,7 +590,7 @@ class Definitions : public IHasDbPrint {
         : definitions(other.definitions), unreachable(other.unreachable) {}
     Definitions *joinDefinitions(const Definitions *other) const;
     /// Point writes the specified LocationSet.
-    Definitions *writes(ProgramPoint point, const LocationSet &locations) const;
+    Definitions *writes(const ProgramPoints *points, const LocationSet &locations) const;
     void setDefintion(const BaseLocation *loc, const ProgramPoints *point) {
         CHECK_NULL(loc);
         CHECK_NULL(point);
@@ -558,10 +638,16 @@ class AllDefinitions : public IHasDbPrint {
     /// ProgramPoint.
     hvec_map<ProgramPoint, Definitions *> atPoint;
     StorageMap storageMap;
+    ProgramPointNumbering numbering;
 
  public:
     AllDefinitions(ReferenceMap *refMap, TypeMap *typeMap) : storageMap(refMap, typeMap) {}
 
+    /// @returns the set that only contains @p point.
+    const ProgramPoints *pointsOf(const ProgramPoint &point) {
+        return new ProgramPoints(&numbering, point);
+    }
+
     Definitions *getDefinitions(ProgramPoint point, bool emptyIfNotFound = false) {
         auto it = atPoint.find(point);
         if (it == atPoint.end()) {
@@ -726,6 +812,10 @@ class ComputeWriteSet : public Inspector, public IHasDbPrint {
     Definitions *getDefinitionsAfter(const IR::ParserState *state);
     bool setDefinitions(Definitions *defs, const IR::Node *who = nullptr, bool overwrite = false);
     ProgramPoint getProgramPoint(const IR::Node *node = nullptr) const;
+    /// @returns the set that only contains getProgramPoint(@p node).
+    const ProgramPoints *currentPoints(const IR::Node *node = nullptr) const {
+        return allDefinitions->pointsOf(getProgramPoint(node));
+    }
     // Get writes of a node that is a direct child of the currently being visited node.
     const LocationSet *getWrites(const IR::Expression *expression) {
         const loc_t &exprLoc = *getLoc(expression, getChildContext());
@@ -19,6 +19,7 @@ limitations under the License.
 #include <iostream>
 
 #include "../common/options.h"
+#include "frontends/common/compilationCache.h"
 #include "frontends/common/resolveReferences/resolveReferences.h"
 #include "frontends/p4/typeChecking/bindVariables.h"
 #include "frontends/p4/typeMap.h"
@@ -289,7 +290,17 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
     passes.setName("FrontEnd");
     passes.setStopOnError(true);
     passes.addDebugHooks(hooks, true);
+
+    // The pretty printer runs as part of the pipeline, so it disables the cache.
+    CompilationCache cache(options.prettyPrintFile.empty() ? options.compilationCacheDir
+                                                           : std::filesystem::path());
+    uint64_t cacheKey = 0;
+    if (cache.enabled()) {
+        cacheKey = CompilationCache::key(program, passes, options);
+        if (const auto *cached = cache.load(cacheKey)) return cached;
+    }
     const IR::P4Program *result = program->apply(passes);
+    if (cache.enabled() && result && errorCount() == 0) cache.store(cacheKey, result);
     return result;
 }
 
@@ -33,6 +33,8 @@ class Reassociation final : public Transform {
         visitDagOnce = true;
         setName("Reassociation");
     }
+    Reassociation *clone() const override { return new Reassociation(*this); }
+    bool perDeclarationSafe() const override { return true; }
     using Transform::postorder;
 
     const IR::Node *reassociate(IR::Operation_Binary *root);
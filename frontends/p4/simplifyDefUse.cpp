@@ -25,6 +25,8 @@ limitations under the License.
 #include "frontends/p4/tableApply.h"
 #include "frontends/p4/ternaryBool.h"
 #include "lib/hash.h"
+#include "lib/hvec_map.h"
+#include "lib/ordered_set.h"
 
 namespace P4 {
 
@@ -554,7 +556,7 @@ class FindUninitialized : public Inspector {
 
         (void)parser->apply(pcg, getChildContext());
         ordered_set<const IR::ParserState *> toRun;  // worklist
-        ordered_map<const IR::ParserState *, HeaderDefinitions *> inputHeaderDefs;
+        hvec_map<const IR::ParserState *, HeaderDefinitions *> inputHeaderDefs;
 
         toRun.emplace(startState);
         inputHeaderDefs.emplace(startState, headerDefs);
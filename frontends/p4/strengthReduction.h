@@ -83,6 +83,9 @@ class DoStrengthReduction final : public Transform {
         DoStrengthReduction();
     }
 
+    DoStrengthReduction *clone() const override { return new DoStrengthReduction(*this); }
+    bool perDeclarationSafe() const override { return true; }
+
     using Transform::postorder;
 
     const IR::Node *postorder(IR::Cmpl *expr) override;
@@ -272,6 +272,66 @@ void ProgramStructure::declareParameters(const IR::IndexedVector<IR::Parameter>
     for (auto param : *params) declareObject(param->name, param->type->toString());
 }
 
+bool ProgramStructure::declareParsed(const IR::Node *node) {
+    // This mirrors the actions of the grammar rules for top-level declarations.
+    auto declareContainer = [this](const IR::ID &name, bool allowDuplicates, bool alwaysTemplate,
+                                   const IR::TypeParameters *typeParameters,
+                                   const IR::ParameterList *parameters) {
+        pushContainerType(name, allowDuplicates);
+        if (alwaysTemplate || !typeParameters->empty()) markAsTemplate(name);
+        declareTypes(&typeParameters->parameters);
+        if (parameters) declareParameters(&parameters->parameters);
+        pop();
+    };
+    auto declareFunction = [this](const IR::ID &name, const IR::Type_Method *type) {
+        declareObject(name, type->returnType->toString());
+        if (!type->typeParameters->empty()) markAsTemplate(name);
+    };
+
+    if (const auto *structLike = node->to<IR::Type_StructLike>()) {
+        declareContainer(structLike->name, true, true, structLike->typeParameters, nullptr);
+    } else if (node->is<IR::Type_Enum>() || node->is<IR::Type_SerEnum>() ||
+               node->is<IR::Type_Typedef>() || node->is<IR::Type_Newtype>()) {
+        declareType(node->to<IR::Type_Declaration>()->name);
+    } else if (const auto *parserType = node->to<IR::Type_Parser>()) {
+        declareContainer(parserType->name, true, false, parserType->typeParameters,
+                         parserType->applyParams);
+    } else if (const auto *controlType = node->to<IR::Type_Control>()) {
+        declareContainer(controlType->name, true, false, controlType->typeParameters,
+                         controlType->applyParams);
+    } else if (const auto *package = node->to<IR::Type_Package>()) {
+        declareContainer(package->name, false, false, package->typeParameters,
+                         package->constructorParams);
+    } else if (const auto *parser = node->to<IR::P4Parser>()) {
+        declareContainer(parser->name, true, false, parser->type->typeParameters,
+                         parser->type->applyParams);
+    } else if (const auto *control = node->to<IR::P4Control>()) {
+        declareContainer(control->name, true, false, control->type->typeParameters,
+                         control->type->applyParams);
+    } else if (const auto *externType = node->to<IR::Type_Extern>()) {
+        pushContainerType(externType->name, true);
+        if (!externType->typeParameters->empty()) markAsTemplate(externType->name);
+        declareTypes(&externType->typeParameters->parameters);
+        for (const auto *method : externType->methods) {
+            // constructors do not declare anything
+            if (method->type->returnType != nullptr) declareFunction(method->name, method->type);
+        }
+        pop();
+    } else if (const auto *method = node->to<IR::Method>()) {
+        declareFunction(method->name, method->type);
+    } else if (const auto *function = node->to<IR::Function>()) {
+        declareFunction(function->name, function->type);
+    } else if (const auto *instance = node->to<IR::Declaration_Instance>()) {
+        declareObject(instance->name, instance->type->toString());
+    } else if (const auto *constant = node->to<IR::Declaration_Constant>()) {
+        declareObject(constant->name, constant->type->toString());
+    } else if (!node->is<IR::P4Action>() && !node->is<IR::Type_Error>() &&
+               !node->is<IR::Declaration_MatchKind>()) {
+        return false;
+    }
+    return true;
+}
+
 void ProgramStructure::endParse() {
     BUG_CHECK(currentNamespace == rootNamespace,
               "Namespace stack is not empty at the end of parsing");
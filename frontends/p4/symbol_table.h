@@ -75,6 +75,10 @@ class ProgramStructure final {
     // Declares these types in the current scope
     void declareTypes(const IR::IndexedVector<IR::Type_Var> *typeVars);
     void declareParameters(const IR::IndexedVector<IR::Parameter> *params);
+    // Declares the symbols that parsing the top-level declaration @p node would have
+    // declared; used to continue parsing after declarations parsed before.  Returns
+    // false if @p node is not a declaration whose symbols we know.
+    bool declareParsed(const IR::Node *node);
     SymbolKind lookupIdentifier(cstring identifier);
 
     void startAbsolutePath();
@@ -29,6 +29,8 @@ namespace P4 {
 // This pass only clears the typeMap if the program has changed
 // or the 'force' flag is set.
 // This is needed if the types of some objects in the program change.
+// Without 'force', only the types of the declarations that changed
+// are forgotten; see TypeMap::retainUnchanged.
 class ClearTypeMap : public Inspector {
     TypeMap *typeMap;
     bool force;
@@ -43,7 +45,10 @@ class ClearTypeMap : public Inspector {
         // because the program is saved only *after* typechecking,
         // so if the program changes during type-checking, the
         // typeMap may not be complete.
-        if (force || !typeMap->checkMap(program)) typeMap->clear();
+        if (force)
+            typeMap->clear();
+        else if (!typeMap->checkMap(program))
+            typeMap->retainUnchanged(program);
         return false;  // prune()
     }
 };
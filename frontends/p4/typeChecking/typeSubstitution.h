@@ -67,6 +67,17 @@ class TypeSubstitution : public IHasDbPrint {
         }
     }
 
+    /// Remove the bindings of the keys for which @p pred returns true.
+    template <class Pred>
+    void removeBindings(Pred pred) {
+        for (auto it = binding.begin(); it != binding.end();) {
+            if (pred(it->first))
+                it = binding.erase(it);
+            else
+                ++it;
+        }
+    }
+
     void clear() { binding.clear(); }
 };
 
@@ -90,6 +90,44 @@ void TypeMap::clear() {
     ProgramMap::clear();
 }
 
+void TypeMap::retainUnchanged(const IR::P4Program *newProgram) {
+    auto changes = changesSince(newProgram);
+    if (!changes) {
+        clear();
+        return;
+    }
+    // Type variables bound while typing the stale nodes: those in the stale subtrees,
+    // and those the stale nodes were typed with.  Type checking the stale nodes again
+    // binds them again, so their bindings have to go as well.
+    absl::flat_hash_set<const IR::Node *, Util::Hash> staleVariables;
+    for (const auto *node : changes->stale) {
+        if (node->is<IR::ITypeVar>()) staleVariables.insert(node);
+        if (auto it = typeMap.find(node); it != typeMap.end()) {
+            if (it->second->is<IR::ITypeVar>()) staleVariables.insert(it->second);
+            typeMap.erase(it);
+        }
+        if (const auto *expression = node->to<IR::Expression>()) {
+            leftValues.erase(expression);
+            constants.erase(expression);
+        }
+    }
+    if (!staleVariables.empty()) {
+        // A variable that also types a retained node must keep its binding, and would
+        // then be bound twice; recompute everything instead.
+        for (const auto &[node, type] : typeMap) {
+            if (staleVariables.count(type)) {
+                LOG2("TypeMap: type variable " << dbp(type) << " is still in use");
+                clear();
+                return;
+            }
+        }
+        allTypeVariables.removeBindings([&staleVariables](const IR::ITypeVar *var) {
+            return staleVariables.count(var->getNode()) != 0;
+        });
+    }
+    ProgramMap::clear();
+}
+
 void TypeMap::checkPrecondition(const IR::Node *element, const IR::Type *type) const {
     CHECK_NULL(element);
     CHECK_NULL(type);
@@ -75,6 +75,11 @@ class TypeMap final : public ProgramMap {
     const IR::Type *getTypeType(const IR::Node *element, bool notNull) const;
     void dbprint(std::ostream &out) const override;
     void clear();
+    /// Prepare the map for type-checking @p newProgram, which replaces the program the
+    /// map was computed for.  Only the types below the declarations that changed are
+    /// forgotten (see ProgramMap::changesSince), so TypeInference only has to type the
+    /// parts of the program that changed.
+    void retainUnchanged(const IR::P4Program *newProgram);
     bool isLeftValue(const IR::Expression *expression) const {
         return leftValues.count(expression) > 0;
     }
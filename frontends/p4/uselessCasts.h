@@ -34,6 +34,8 @@ class RemoveUselessCasts : public Transform {
         CHECK_NULL(typeMap);
         setName("RemoveUselessCasts");
     }
+    RemoveUselessCasts *clone() const override { return new RemoveUselessCasts(*this); }
+    bool perDeclarationSafe() const override { return true; }
     const IR::Node *postorder(IR::Cast *cast) override;
 };
 
@@ -1,6 +1,11 @@
 #ifndef FRONTENDS_P4_LEXER_INTERNAL_H_
 #define FRONTENDS_P4_LEXER_INTERNAL_H_
 
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
 #include "frontends/parsers/p4/abstractP4Lexer.hpp"
 #include "frontends/parsers/p4/p4parser.hpp"
 #include "lib/source_file.h"
@@ -13,11 +18,24 @@ class P4Lexer : public AbstractP4Lexer, public p4FlexLexer {
  public:
     explicit P4Lexer(std::istream& input)
         : p4FlexLexer(&input), needStartToken(true) { }
+    /// Scans @p text, which must outlive the lexer, without going through a stream.
+    explicit P4Lexer(std::string_view text)
+        : needStartToken(true), text(text) { }
 
     virtual Token yylex(P4::P4ParserDriver& driver) override;
 
+ protected:
+    int LexerInput(char* buf, int maxSize) override {
+        if (!text) return p4FlexLexer::LexerInput(buf, maxSize);
+        size_t size = std::min(text->size(), static_cast<size_t>(maxSize));
+        memcpy(buf, text->data(), size);
+        text->remove_prefix(size);
+        return static_cast<int>(size);
+    }
+
  private:
     bool needStartToken;
+    std::optional<std::string_view> text;  // the text left to scan, if not reading a stream
     int yylex() override { return p4FlexLexer::yylex(); }
 };
 
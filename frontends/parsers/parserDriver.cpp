@@ -92,7 +92,7 @@ void AbstractParserDriver::onReadLineNumber(const char *text) {
 }
 
 void AbstractParserDriver::onReadComment(const char *text, bool lineComment) {
-    sources->addComment(yylloc, lineComment, cstring(text));
+    if (keepComments) sources->addComment(yylloc, lineComment, cstring(text));
 }
 
 void AbstractParserDriver::onReadFileName(const char *text) {
@@ -153,10 +153,44 @@ bool P4ParserDriver::parse(AbstractP4Lexer &lexer, std::string_view sourceFile,
     return parse(inputStream.get(), sourceFile, sourceLine);
 }
 
+/* static */ const IR::P4Program *P4ParserDriver::parse(
+    std::shared_ptr<const Util::SourceBuffer> buffer, std::string_view sourceFile,
+    unsigned sourceLine /* = 1 */) {
+    LOG1("Parsing P4-16 program " << sourceFile << " in place");
+
+    P4ParserDriver driver;
+    P4Lexer lexer(buffer->text());
+    driver.sources = new Util::InputSources(std::move(buffer));
+    if (!driver.parse(lexer, sourceFile, sourceLine)) return nullptr;
+    return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes);
+}
+
+/* static */ const IR::P4Program *P4ParserDriver::parseWithPrelude(
+    std::istream &in, std::string_view sourceFile, const IR::Vector<IR::Node> &prelude) {
+    LOG1("Parsing P4-16 program " << sourceFile << " after " << prelude.size()
+                                  << " parsed declarations");
+
+    P4ParserDriver driver;
+    for (const auto *node : prelude) {
+        bool known = driver.structure->declareParsed(node);
+        BUG_CHECK(known, "%1%: cannot resume parsing after this declaration", node);
+        if (const auto *error = node->to<IR::Type_Error>()) {
+            // Later error declarations are merged into this one, so it needs its own copy.
+            driver.allErrors = error->clone();
+            node = driver.allErrors;
+        }
+        driver.nodes->push_back(node);
+    }
+    P4Lexer lexer(in);
+    if (!driver.parse(lexer, sourceFile)) return nullptr;
+    return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes);
+}
+
 /* static */ std::pair<const IR::P4Program *, const Util::InputSources *>
 P4ParserDriver::parseProgramSources(std::istream &in, std::string_view sourceFile,
                                     unsigned sourceLine /* = 1 */) {
     P4ParserDriver driver;
+    driver.keepComments = true;
     P4Lexer lexer(in);
     if (!driver.parse(lexer, sourceFile, sourceLine)) {
         return {nullptr, nullptr};
@@ -19,6 +19,7 @@ limitations under the License.
 
 #include <cstdio>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -83,6 +84,10 @@ class AbstractParserDriver {
     /// Scratch storage for the lexer to remember its previous state.
     int saveState = -1;
 
+    /// If true, the comments the lexer reads are added to the input sources.  Only the
+    /// tools that print the program back need them, so they are dropped by default.
+    bool keepComments = false;
+
  private:
     /// The line number from the most recent #line directive.
     int lineDirectiveLine = 0;
@@ -114,10 +119,22 @@ class P4ParserDriver final : public AbstractParserDriver {
                                       unsigned sourceLine = 1);
     static const IR::P4Program *parse(FILE *in, std::string_view sourceFile,
                                       unsigned sourceLine = 1);
+    /// Parses the text of @p buffer in place: the InputSources of the program refer to
+    /// the buffer, and keep it alive, rather than holding a copy of each line.
+    static const IR::P4Program *parse(std::shared_ptr<const Util::SourceBuffer> buffer,
+                                      std::string_view sourceFile, unsigned sourceLine = 1);
+
+    /// Parses a P4-16 program made of the top-level declarations in @p prelude, which
+    /// were parsed before (normally from the standard include files), followed by the
+    /// text read from @p in.  The declarations are shared, not copied; every node in
+    /// @p prelude must be accepted by Util::ProgramStructure::declareParsed().
+    static const IR::P4Program *parseWithPrelude(std::istream &in, std::string_view sourceFile,
+                                                 const IR::Vector<IR::Node> &prelude);
 
     /// Parses the input and returns a pair with the P4Program and InputSources.
     /// Use this when both the parsed P4Program and InputSources are required,
     /// as opposed to the `parse` method, which only returns the P4Program.
+    /// The InputSources keep the comments of the program.
     static std::pair<const IR::P4Program *, const Util::InputSources *> parseProgramSources(
         std::istream &in, std::string_view sourceFile, unsigned sourceLine = 1);
 
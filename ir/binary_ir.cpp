@@ -0,0 +1,212 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ir/binary_ir.h"
+
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "lib/cstring.h"
+
+namespace P4 {
+
+BinaryIRWriter::BinaryIRWriter(std::ostream &out) : out(out) {
+    buffer.append(BinaryIR::magic);
+    varint(BinaryIR::version);
+}
+
+void BinaryIRWriter::varint(uint64_t v) {
+    while (v >= 0x80) {
+        buffer.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    buffer.push_back(static_cast<char>(v));
+}
+
+void BinaryIRWriter::integer(int64_t v) {
+    tag(BinaryIR::Tag::Int);
+    varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+void BinaryIRWriter::number(const big_int &v) {
+    if (v >= std::numeric_limits<int64_t>::min() && v <= std::numeric_limits<int64_t>::max()) {
+        integer(static_cast<int64_t>(v));
+        return;
+    }
+    std::stringstream digits;
+    digits << v;
+    auto text = digits.str();
+    tag(BinaryIR::Tag::Number);
+    varint(text.size());
+    buffer.append(text);
+}
+
+void BinaryIRWriter::string(std::string_view v) {
+    auto [it, inserted] = strings.try_emplace(v, strings.size());
+    if (!inserted) {
+        tag(BinaryIR::Tag::StringRef);
+        varint(it->second);
+        return;
+    }
+    tag(BinaryIR::Tag::String);
+    varint(v.size());
+    buffer.append(v);
+}
+
+void BinaryIRWriter::flush() {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+namespace BinaryIR {
+
+namespace {
+
+class Reader {
+    std::string_view data;
+    size_t pos = 0;
+    bool failed = false;
+    std::vector<std::string_view> strings;
+    // cstrings for the strings used as object keys, created on first use.
+    std::vector<cstring> keys;
+
+    bool varint(uint64_t &v) {
+        v = 0;
+        for (unsigned shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+            auto byte = static_cast<uint8_t>(data[pos++]);
+            v |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return !(failed = true);
+    }
+
+    bool bytes(std::string_view &v) {
+        uint64_t size;
+        if (!varint(size) || size > data.size() - pos) return !(failed = true);
+        v = data.substr(pos, size);
+        pos += size;
+        return true;
+    }
+
+    /// Decode a string token whose tag is @p t.  @return the string table index.
+    bool string(Tag t, uint64_t &index) {
+        if (t == Tag::String) {
+            std::string_view v;
+            if (!bytes(v)) return false;
+            index = strings.size();
+            strings.push_back(v);
+            return true;
+        }
+        if (t != Tag::StringRef || !varint(index) || index >= strings.size())
+            return !(failed = true);
+        return true;
+    }
+
+    cstring key(uint64_t index) {
+        if (keys.size() <= index) keys.resize(strings.size());
+        if (keys[index].isNull()) keys[index] = cstring(strings[index]);
+        return keys[index];
+    }
+
+ public:
+    explicit Reader(std::string_view data) : data(data) {}
+
+    bool header() {
+        uint64_t v;
+        if (data.substr(0, magic.size()) != magic) return false;
+        pos = magic.size();
+        return varint(v) && v == version;
+    }
+
+    /// @return the next value, or nullptr at an End tag or on error.
+    std::unique_ptr<JsonData> value() {
+        if (failed || pos >= data.size()) {
+            failed = true;
+            return nullptr;
+        }
+        auto t = static_cast<Tag>(data[pos++]);
+        switch (t) {
+            case Tag::Null:
+                return std::make_unique<JsonNull>();
+            case Tag::False:
+                return std::make_unique<JsonBoolean>(false);
+            case Tag::True:
+                return std::make_unique<JsonBoolean>(true);
+            case Tag::Int: {
+                uint64_t v;
+                if (!varint(v)) return nullptr;
+                auto decoded = static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+                return std::make_unique<JsonNumber>(big_int(decoded));
+            }
+            case Tag::Number: {
+                std::string_view digits;
+                if (!bytes(digits)) return nullptr;
+                return std::make_unique<JsonNumber>(big_int(std::string(digits)));
+            }
+            case Tag::String:
+            case Tag::StringRef: {
+                uint64_t index;
+                if (!string(t, index)) return nullptr;
+                return std::make_unique<JsonString>(strings[index]);
+            }
+            case Tag::Vector: {
+                auto vec = std::make_unique<JsonVector>();
+                while (auto elem = value()) vec->push_back(std::move(elem));
+                if (failed) return nullptr;
+                return vec;
+            }
+            case Tag::Object: {
+                auto obj = std::make_unique<JsonObject>();
+                while (pos < data.size() && static_cast<Tag>(data[pos]) != Tag::End) {
+                    uint64_t index;
+                    if (!string(static_cast<Tag>(data[pos++]), index)) return nullptr;
+                    auto elem = value();
+                    if (!elem) return nullptr;
+                    obj->emplace(key(index), std::move(elem));
+                }
+                if (pos++ >= data.size()) failed = true;
+                if (failed) return nullptr;
+                return obj;
+            }
+            case Tag::End:
+                return nullptr;
+        }
+        failed = true;
+        return nullptr;
+    }
+};
+
+}  // namespace
+
+bool isBinary(std::istream &in) {
+    return in.peek() == static_cast<unsigned char>(magic.front());
+}
+
+std::unique_ptr<JsonData> read(std::string_view data) {
+    Reader reader(data);
+    if (!reader.header()) return nullptr;
+    return reader.value();
+}
+
+std::unique_ptr<JsonData> read(std::istream &in) {
+    std::string data(std::istreambuf_iterator<char>(in), {});
+    return read(data);
+}
+
+}  // namespace BinaryIR
+
+}  // namespace P4
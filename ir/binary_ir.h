@@ -0,0 +1,106 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IR_BINARY_IR_H_
+#define IR_BINARY_IR_H_
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/container/flat_hash_map.h"
+#include "ir/json_parser.h"
+#include "lib/big_int_util.h"
+
+namespace P4 {
+
+/// Compact binary encoding of the trees written by JSONGenerator.
+///
+/// A file starts with a magic number and the format version, followed by a single value
+/// encoded as a stream of tokens.  Each token is a tag byte, followed by:
+///  - Int: a zigzag-encoded varint;
+///  - Number: the decimal digits of an integer that does not fit 64 bits;
+///  - String: the length and bytes of a string, which is also appended to the string table;
+///  - StringRef: the index of a string in the string table;
+///  - Vector/Object: their elements (objects alternate keys and values), up to an End tag.
+/// Strings are interned, so every field name and repeated value (node types, names) is
+/// stored once.  Shared nodes are written once and referred to by their id, exactly like in
+/// JSON.  The encoding is position independent, so it can be decoded straight from a
+/// memory-mapped file.
+namespace BinaryIR {
+
+/// The bytes every binary IR file starts with; the first one can never start a JSON text.
+inline constexpr std::string_view magic = "\x89P4IR\r\n\x1a";
+/// Bumped whenever the encoding changes incompatibly.
+inline constexpr uint32_t version = 1;
+
+enum class Tag : uint8_t {
+    Null,
+    False,
+    True,
+    Int,
+    Number,
+    String,
+    StringRef,
+    Vector,
+    Object,
+    End,
+};
+
+/// @return true if @p in is positioned at the start of a binary IR file.
+bool isBinary(std::istream &in);
+
+/// Decode the value in @p data, which must contain a complete binary IR file.
+/// @return nullptr if the data is malformed or of another version.
+std::unique_ptr<JsonData> read(std::string_view data);
+/// Read and decode the rest of @p in.
+std::unique_ptr<JsonData> read(std::istream &in);
+
+}  // namespace BinaryIR
+
+/// Writes the token stream of a binary IR file; used by JSONGenerator.
+class BinaryIRWriter {
+    std::ostream &out;
+    std::string buffer;
+    absl::flat_hash_map<std::string, uint32_t> strings;
+
+    void tag(BinaryIR::Tag t) { buffer.push_back(static_cast<char>(t)); }
+    void varint(uint64_t v);
+
+ public:
+    explicit BinaryIRWriter(std::ostream &out);
+    ~BinaryIRWriter() { flush(); }
+
+    void null() { tag(BinaryIR::Tag::Null); }
+    void boolean(bool v) { tag(v ? BinaryIR::Tag::True : BinaryIR::Tag::False); }
+    void integer(int64_t v);
+    void number(const big_int &v);
+    void string(std::string_view v);
+    void beginVector() { tag(BinaryIR::Tag::Vector); }
+    void beginObject() { tag(BinaryIR::Tag::Object); }
+    void end() { tag(BinaryIR::Tag::End); }
+
+    /// Write the buffered tokens to the stream.
+    void flush();
+    /// Flush if enough tokens have been buffered.
+    void maybeFlush() {
+        if (buffer.size() >= 1 << 16) flush();
+    }
+};
+
+}  // namespace P4
+
+#endif /* IR_BINARY_IR_H_ */
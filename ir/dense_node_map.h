@@ -0,0 +1,152 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IR_DENSE_NODE_MAP_H_
+#define IR_DENSE_NODE_MAP_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "ir/node.h"
+#include "lib/hash.h"
+
+namespace P4::IR {
+
+/// A map from nodes to small values, indexed by Node::id rather than hashed, used by
+/// the visitors to track the nodes they have seen.  The values live in pages of
+/// consecutive ids that are only allocated when used, and clear() only resets the
+/// entries that were used, so a map can be reused by the next visitor without
+/// allocating or rehashing anything.  clear() frees the pages that were not used since
+/// the previous clear(), so a reused map holds on to the ids of the last program it saw
+/// rather than to every id it was ever given.
+///
+/// Node ids are not always unique: assigning a node copies its id, and so may loading
+/// an IR dump.  A node whose id is negative or whose slot is held by another node is
+/// kept in a hash map instead.
+///
+/// The keys are hidden from the garbage collector, so the map does not keep the nodes
+/// alive; values that hold pointers do, until clear() is called.
+template <class V>
+class DenseNodeMap {
+    static constexpr size_t pageBits = 12;
+    static constexpr size_t pageSize = size_t(1) << pageBits;
+
+    struct Slot {
+        uintptr_t hiddenNode = 0;  // 0 if the slot is empty
+        V value{};
+    };
+    using Page = std::array<Slot, pageSize>;
+
+    std::vector<std::unique_ptr<Page>> pages;
+    size_t pageCount = 0;   // allocated pages
+    std::vector<int> used;  // ids of the occupied slots
+    absl::flat_hash_map<const Node *, V, Util::Hash> overflow;
+
+    static uintptr_t hide(const Node *n) { return ~reinterpret_cast<uintptr_t>(n); }
+
+    Slot *find_slot(int id) const {
+        if (id < 0) return nullptr;
+        size_t page = static_cast<size_t>(id) >> pageBits;
+        if (page >= pages.size() || !pages[page]) return nullptr;
+        return &(*pages[page])[id & (pageSize - 1)];
+    }
+    Slot *make_slot(int id) {
+        if (id < 0) return nullptr;
+        size_t page = static_cast<size_t>(id) >> pageBits;
+        if (page >= pages.size()) pages.resize(page + 1);
+        if (!pages[page]) {
+            pages[page] = std::make_unique<Page>();
+            ++pageCount;
+        }
+        return &(*pages[page])[id & (pageSize - 1)];
+    }
+
+ public:
+    DenseNodeMap() = default;
+    DenseNodeMap(const DenseNodeMap &) = delete;
+
+    /// Insert @p n with value @p init unless it is already present.
+    /// @return the value for @p n and whether it was inserted.
+    std::pair<V *, bool> emplace(const Node *n, const V &init) {
+        if (Slot *slot = make_slot(n->id)) {
+            if (slot->hiddenNode == hide(n)) return {&slot->value, false};
+            if (slot->hiddenNode == 0 && (overflow.empty() || !overflow.count(n))) {
+                slot->hiddenNode = hide(n);
+                slot->value = init;
+                used.push_back(n->id);
+                return {&slot->value, true};
+            }
+        }
+        auto [it, inserted] = overflow.emplace(n, init);
+        return {&it->second, inserted};
+    }
+
+    /// @return the value for @p n, or nullptr if it is not in the map (or is nullptr).
+    V *find(const Node *n) {
+        if (n == nullptr) return nullptr;
+        Slot *slot = find_slot(n->id);
+        if (slot && slot->hiddenNode == hide(n)) return &slot->value;
+        if (overflow.empty()) return nullptr;
+        auto it = overflow.find(n);
+        return it == overflow.end() ? nullptr : &it->second;
+    }
+    const V *find(const Node *n) const { return const_cast<DenseNodeMap *>(this)->find(n); }
+    bool contains(const Node *n) const { return find(n) != nullptr; }
+    size_t size() const { return used.size() + overflow.size(); }
+    bool empty() const { return size() == 0; }
+    /// @return the memory held by the pages.
+    size_t memoryUsed() const { return pageCount * sizeof(Page); }
+
+    /// Remove the entries whose value satisfies @p pred.
+    template <class Pred>
+    void erase_if(Pred pred) {
+        size_t kept = 0;
+        for (int id : used) {
+            Slot *slot = find_slot(id);
+            if (pred(slot->value))
+                *slot = Slot();
+            else
+                used[kept++] = id;
+        }
+        used.resize(kept);
+        absl::erase_if(overflow, [&](auto &entry) { return pred(entry.second); });
+    }
+
+    /// Remove all entries, keeping the pages that held some of them.
+    void clear() {
+        std::vector<bool> live(pages.size());
+        for (int id : used) {
+            *find_slot(id) = Slot();
+            live[static_cast<size_t>(id) >> pageBits] = true;
+        }
+        for (size_t page = 0; page < pages.size(); ++page) {
+            if (pages[page] && !live[page]) {
+                pages[page].reset();
+                --pageCount;
+            }
+        }
+        while (!pages.empty() && !pages.back()) pages.pop_back();
+        used.clear();
+        overflow.clear();
+    }
+};
+
+}  // namespace P4::IR
+
+#endif /* IR_DENSE_NODE_MAP_H_ */
@@ -16,7 +16,7 @@ limitations under the License.
 
 #include <ostream>
 
-#include "absl/container/flat_hash_map.h"
+#include "ir/hash_cons.h"
 #include "ir/id.h"
 #include "ir/indexed_vector.h"
 #include "ir/ir.h"
@@ -86,6 +86,15 @@ void IR::Constant::handleOverflow(bool noWarning) {
     }
 
     int width = tb->size;
+    // Nearly all constants fit their type; check those without big_int temporaries.
+    if (width > 0 && width < 64) {
+        if (auto v = Util::toInt64(value)) {
+            int64_t max = (int64_t(1) << (tb->isSigned ? width - 1 : width)) - 1;
+            int64_t min = tb->isSigned ? -max - 1 : 0;
+            if (*v >= min && *v <= max) return;
+        }
+    }
+
     big_int one = 1;
     big_int mask = Util::mask(width);
 
@@ -156,14 +165,17 @@ const IR::Constant *IR::Constant::get(const IR::Type *t, big_int v, Util::Source
     }
     // Constants are interned. Keys in the intern map are pairs of types and values.
     using key_t = std::tuple<int, RTTI::TypeId, bool, big_int>;
-    static absl::flat_hash_map<key_t, const Constant *, Util::Hash> CONSTANTS;
-
-    auto *&result = CONSTANTS[{tb->width_bits(), t->typeId(), tb->isSigned, v}];
-    if (result == nullptr) {
-        result = new Constant(si, tb, v);
+    static HashConsTable<Constant, key_t> constants("Constant");
+    // Out-of-range values are wrapped by the constructor, so they may end up equal to the
+    // constant of another key and must not be canonical.
+    int width = tb->width_bits();
+    bool inRange = false;
+    if (width > 0) {
+        big_int limit = big_int(1) << (tb->isSigned ? width - 1 : width);
+        inRange = tb->isSigned ? v >= -limit && v < limit : v >= 0 && v < limit;
     }
-
-    return result;
+    return constants.get(
+        {width, t->typeId(), tb->isSigned, v}, [&] { return new Constant(si, tb, v); }, inRange);
 }
 
 const IR::BoolLiteral *IR::BoolLiteral::get(bool value, const Util::SourceInfo &si) {
@@ -183,15 +195,12 @@ const IR::StringLiteral *IR::StringLiteral::get(cstring value, const IR::Type *t
     if (si.isValid()) {
         return new IR::StringLiteral(si, t, value);
     }
-    // String literals are interned.
+    // String literals are interned.  They are only canonical if their type is: two literals
+    // with distinct but equivalent types are still equiv.
     using key_t = std::pair<cstring, const IR::Type *>;
-    static absl::flat_hash_map<key_t, const IR::StringLiteral *, Util::Hash> STRINGS;
-
-    auto *&result = STRINGS[{value, t}];
-    if (result == nullptr) {
-        result = new IR::StringLiteral(si, t, value);
-    }
-    return result;
+    static HashConsTable<StringLiteral, key_t> strings("StringLiteral");
+    return strings.get(
+        {value, t}, [&] { return new IR::StringLiteral(si, t, value); }, t->isCanonical());
 }
 
 }  // namespace P4
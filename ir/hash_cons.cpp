@@ -0,0 +1,58 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ir/hash_cons.h"
+
+#include "lib/log.h"
+#include "lib/n4.h"
+
+namespace P4::IR {
+
+namespace {
+
+std::mutex registryLock;
+
+std::vector<HashConsTableBase *> &registry() {
+    static auto *tables = new std::vector<HashConsTableBase *>;
+    return *tables;
+}
+
+}  // namespace
+
+HashConsTableBase::HashConsTableBase(const char *kind) : kind(kind) {
+    std::lock_guard<std::mutex> guard(registryLock);
+    registry().push_back(this);
+}
+
+std::vector<HashConsTableBase::Stats> HashConsTableBase::allStats() {
+    std::vector<Stats> rv;
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (auto *table : registry())
+        rv.push_back({table->kind, table->requests.load(), table->unique.load()});
+    return rv;
+}
+
+void HashConsTableBase::logStats() {
+    if (!LOGGING(1)) return;
+    size_t requests = 0, unique = 0;
+    for (const auto &stats : allStats()) {
+        LOG1(stats.kind << ": " << n4(stats.requests) << " requests, " << n4(stats.unique)
+                        << " nodes");
+        requests += stats.requests;
+        unique += stats.unique;
+    }
+    LOG1("hash-consing saved " << n4(requests - unique) << " of " << n4(requests) << " nodes");
+}
+
+}  // namespace P4::IR
@@ -0,0 +1,107 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IR_HASH_CONS_H_
+#define IR_HASH_CONS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "ir/node.h"
+#include "lib/arena.h"
+#include "lib/hash.h"
+
+namespace P4::IR {
+
+/// Common part of all hash-consing tables: statistics and the canonical marking.
+class HashConsTableBase {
+ public:
+    struct Stats {
+        const char *kind;
+        size_t requests;  // calls to the factory
+        size_t unique;    // nodes actually created
+    };
+    /// @return the statistics of every table used so far.
+    static std::vector<Stats> allStats();
+    /// Log (at level 1 of this file) how many nodes the tables saved.
+    static void logStats();
+
+    /// Create the only instance of a node class without fields, such as Type_Boolean.
+    /// Meant to initialize a function-local static, which makes it thread-safe.
+    template <class Make>
+    static auto *makeSingleton(Make make) {
+        Util::Arena::Suspend persistent;
+        auto *node = make();
+        markCanonical(node);
+        return node;
+    }
+
+ protected:
+    explicit HashConsTableBase(const char *kind);
+    static void markCanonical(Node *node) { node->canonical = true; }
+
+    const char *kind;
+    std::atomic<size_t> requests = 0;
+    std::atomic<size_t> unique = 0;
+};
+
+/// Hash-consing of immutable leaf nodes: hands out a single shared node per key, so
+/// that callers asking for the same value get the same pointer.  This backs the opt-in
+/// `get` factories (Constant::get, Type_Bits::get, ...); nodes created with `new` are
+/// never shared.
+///
+/// Nodes created by the table are marked canonical (unless the caller says otherwise),
+/// and equiv between two distinct canonical nodes fails without looking at them, so the
+/// key must cover everything equiv compares.  Shared nodes must not carry source
+/// information, and they outlive the compilation that created them.  The table may be
+/// used from several threads.
+template <class T, class Key>
+class HashConsTable : public HashConsTableBase {
+    std::shared_mutex lock;
+    absl::flat_hash_map<Key, const T *, Util::Hash> nodes;
+
+ public:
+    explicit HashConsTable(const char *kind) : HashConsTableBase(kind) {}
+
+    /// @return the node for @p key, calling @p make to create it the first time.
+    /// @p canonical must be false if nodes with different keys may still be equiv
+    /// (e.g. because the key holds a pointer to a non-canonical child).
+    template <class Make>
+    const T *get(const Key &key, Make make, bool canonical = true) {
+        requests.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            auto it = nodes.find(key);
+            if (it != nodes.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> guard(lock);
+        auto &result = nodes[key];
+        if (!result) {
+            Util::Arena::Suspend persistent;
+            T *node = make();
+            if (canonical) markCanonical(node);
+            result = node;
+            unique.fetch_add(1, std::memory_order_relaxed);
+        }
+        return result;
+    }
+};
+
+}  // namespace P4::IR
+
+#endif /* IR_HASH_CONS_H_ */
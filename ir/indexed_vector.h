@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "ir/declaration.h"
 #include "ir/vector.h"
+#include "lib/cow_ptr.h"
 #include "lib/enumerator.h"
 #include "lib/error.h"
 #include "lib/map.h"
@@ -38,7 +39,8 @@ namespace P4::IR {
  */
 template <class T>
 class IndexedVector : public Vector<T> {
-    string_map<const IDeclaration *> declarations;
+    // Shared by the copies, like the elements.
+    cow_ptr<string_map<const IDeclaration *>> declarations;
     bool invalid = false;  // set when an error occurs; then we don't
                            // expect the validity check to succeed.
 
@@ -46,7 +48,7 @@ class IndexedVector : public Vector<T> {
         if (a == nullptr || !a->template is<IDeclaration>()) return;
         auto decl = a->template to<IDeclaration>();
         auto name = decl->getName().name;
-        auto [it, inserted] = declarations.emplace(name, decl);
+        auto [it, inserted] = declarations.mutate().emplace(name, decl);
         if (!inserted) {
             invalid = true;
             ::P4::error(ErrorType::ERR_DUPLICATE, "%1%: Duplicates declaration %2%", a, it->second);
@@ -57,9 +59,10 @@ class IndexedVector : public Vector<T> {
         auto decl = a->template to<IDeclaration>();
         if (decl == nullptr) return;
         cstring name = decl->getName().name;
-        auto it = declarations.find(name);
-        if (it == declarations.end()) BUG("%1% does not exist", a);
-        declarations.erase(it);
+        auto &map = declarations.mutate();
+        auto it = map.find(name);
+        if (it == map.end()) BUG("%1% does not exist", a);
+        map.erase(it);
     }
 
  public:
@@ -87,7 +90,7 @@ class IndexedVector : public Vector<T> {
 
     void clear() {
         IR::Vector<T>::clear();
-        declarations.clear();
+        declarations = {};
     }
     // TODO: Although this is not a const_iterator, it should NOT
     // be used to modify the vector directly.  I don't know
@@ -96,29 +99,29 @@ class IndexedVector : public Vector<T> {
     using const_iterator = typename Vector<T>::const_iterator;
 
     const IDeclaration *getDeclaration(cstring name) const {
-        auto it = declarations.find(name);
-        if (it == declarations.end()) return nullptr;
+        auto it = declarations->find(name);
+        if (it == declarations->end()) return nullptr;
         return it->second;
     }
     const IDeclaration *getDeclaration(std::string_view name) const {
-        auto it = declarations.find(name);
-        if (it == declarations.end()) return nullptr;
+        auto it = declarations->find(name);
+        if (it == declarations->end()) return nullptr;
         return it->second;
     }
     template <class U>
     const U *getDeclaration(cstring name) const {
-        auto it = declarations.find(name);
-        if (it == declarations.end()) return nullptr;
+        auto it = declarations->find(name);
+        if (it == declarations->end()) return nullptr;
         return it->second->template to<U>();
     }
     template <class U>
     const U *getDeclaration(std::string_view name) const {
-        auto it = declarations.find(name);
-        if (it == declarations.end()) return nullptr;
+        auto it = declarations->find(name);
+        if (it == declarations->end()) return nullptr;
         return it->second->template to<U>();
     }
     Util::Enumerator<const IDeclaration *> *getDeclarations() const {
-        return Util::enumerate(Values(declarations));
+        return Util::enumerate(Values(*declarations));
     }
     iterator erase(iterator from, iterator to) {
         for (auto it = from; it != to; ++it) {
@@ -226,8 +229,8 @@ class IndexedVector : public Vector<T> {
         for (auto el : *this) {
             auto decl = el->template to<IR::IDeclaration>();
             if (!decl) continue;
-            auto it = declarations.find(decl->getName());
-            BUG_CHECK(it != declarations.end() && it->second->getNode() == el->getNode(),
+            auto it = declarations->find(decl->getName());
+            BUG_CHECK(it != declarations->end() && it->second->getNode() == el->getNode(),
                       "invalid element %1%", el);
         }
     }
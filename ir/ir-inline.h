@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef IR_IR_INLINE_H_
 #define IR_IR_INLINE_H_
 
+#include <utility>
+
 #include "ir/id.h"
 #include "ir/indexed_vector.h"
 #include "ir/json_generator.h"
@@ -81,28 +83,31 @@ IRNODE_ALL_TEMPLATES(DEFINE_APPLY_FUNCTIONS, inline)
 
 template <class T>
 void IR::Vector<T>::visit_children(Visitor &v, const char *name) {
-    for (auto i = vec.begin(); i != vec.end();) {
-        const IR::Node *n = v.apply_visitor(*i, name);
-        if (!n && *i) {
-            i = erase(i);
+    // Only write to the elements when the visitor changes one, so that a clone that ends
+    // up unchanged keeps sharing them with the original.
+    for (size_t idx = 0; idx < size();) {
+        const T *el = std::as_const(*this)[idx];
+        const IR::Node *n = v.apply_visitor(el, name);
+        if (!n && el) {
+            erase(begin() + idx);
             continue;
         }
         CHECK_NULL(n);
-        if (n == *i) {
-            i++;
+        if (n == el) {
+            idx++;
             continue;
         }
         if (auto l = n->to<Vector<T>>()) {
-            i = erase(i);
-            i = insert(i, l->vec.begin(), l->vec.end());
-            i += l->vec.size();
+            auto i = erase(begin() + idx);
+            insert(i, l->vec->begin(), l->vec->end());
+            idx += l->vec->size();
             continue;
         }
         if (const auto *v = n->to<VectorBase>()) {
             if (v->empty()) {
-                i = erase(i);
+                erase(begin() + idx);
             } else {
-                i = insert(i, v->size() - 1, nullptr);
+                auto i = insert(begin() + idx, v->size() - 1, nullptr);
                 for (const auto *el : *v) {
                     CHECK_NULL(el);
                     if (auto e = el->template to<T>()) {
@@ -112,11 +117,12 @@ void IR::Vector<T>::visit_children(Visitor &v, const char *name) {
                             T::static_type_name());
                     }
                 }
+                idx += v->size();
             }
             continue;
         }
         if (auto e = n->to<T>()) {
-            *i++ = e;
+            (*this)[idx++] = e;
             continue;
         }
         BUG("visitor returned invalid type %s for Vector<%s>", n->node_type_name(),
@@ -125,7 +131,7 @@ void IR::Vector<T>::visit_children(Visitor &v, const char *name) {
 }
 template <class T>
 void IR::Vector<T>::visit_children(Visitor &v, const char *name) const {
-    for (auto &a : vec) v.visit(a, name);
+    for (auto &a : *vec) v.visit(a, name);
 }
 template <class T>
 void IR::Vector<T>::parallel_visit_children(Visitor &v, const char *) {
@@ -141,7 +147,7 @@ void IR::Vector<T>::toJSON(JSONGenerator &json) const {
     Node::toJSON(json);
     json.emit_tag("vec");
     auto state = json.begin_vector();
-    for (auto &k : vec) json.emit(k);
+    for (auto &k : *vec) json.emit(k);
     json.end_vector(state);
 }
 
@@ -150,25 +156,27 @@ std::ostream &operator<<(std::ostream &out, const IR::Vector<IR::Annotation> &v)
 
 template <class T>
 void IR::IndexedVector<T>::visit_children(Visitor &v, const char *name) {
-    for (auto i = begin(); i != end();) {
-        auto n = v.apply_visitor(*i, name);
-        if (!n && *i) {
-            i = erase(i);
+    // As for Vector, only write when the visitor changes an element.
+    for (size_t idx = 0; idx < this->size();) {
+        const T *el = std::as_const(*this)[idx];
+        auto n = v.apply_visitor(el, name);
+        if (!n && el) {
+            erase(begin() + idx);
             continue;
         }
         CHECK_NULL(n);
-        if (n == *i) {
-            i++;
+        if (n == el) {
+            idx++;
             continue;
         }
         if (auto l = n->template to<Vector<T>>()) {
-            i = erase(i);
-            i = insert(i, l->begin(), l->end());
-            i += l->Vector<T>::size();
+            auto i = erase(begin() + idx);
+            insert(i, l->begin(), l->end());
+            idx += l->Vector<T>::size();
             continue;
         }
         if (auto e = n->template to<T>()) {
-            i = replace(i, e);
+            replace(begin() + idx++, e);
             continue;
         }
         BUG("visitor returned invalid type %s for IndexedVector<%s>", n->node_type_name(),
@@ -184,7 +192,7 @@ void IR::IndexedVector<T>::toJSON(JSONGenerator &json) const {
     Vector<T>::toJSON(json);
     json.emit_tag("declarations");
     auto state = json.begin_object();
-    for (auto &k : declarations) json.emit(k.first, k.second);
+    for (auto &k : *declarations) json.emit(k.first, k.second);
     json.end_object(state);
 }
 IRNODE_DEFINE_APPLY_OVERLOAD(IndexedVector, template <class T>, <T>)
@@ -17,12 +17,16 @@ limitations under the License.
 #ifndef IR_JSON_GENERATOR_H_
 #define IR_JSON_GENERATOR_H_
 
+#include <limits>
+#include <memory>
 #include <optional>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <unordered_set>
 #include <variant>
 
+#include "ir/binary_ir.h"
 #include "ir/node.h"
 #include "lib/bitvec.h"
 #include "lib/cstring.h"
@@ -40,6 +44,8 @@ class JSONGenerator {
     std::unordered_set<int> node_refs;
     std::ostream &out;
     bool dumpSourceInfo;
+    // Set when writing the binary encoding (ir/binary_ir.h) instead of JSON text.
+    std::unique_ptr<BinaryIRWriter> binary;
 
     template <typename T>
     class has_toJSON {
@@ -90,29 +96,41 @@ class JSONGenerator {
     };
 
  public:
-    explicit JSONGenerator(std::ostream &out, bool dumpSourceInfo = false)
-        : out(out), dumpSourceInfo(dumpSourceInfo) {}
+    /// If @p binary is set, the output uses the compact binary encoding of ir/binary_ir.h
+    /// rather than JSON text.  JSONLoader reads both.
+    explicit JSONGenerator(std::ostream &out, bool dumpSourceInfo = false, bool binary = false)
+        : out(out),
+          dumpSourceInfo(dumpSourceInfo),
+          binary(binary ? std::make_unique<BinaryIRWriter>(out) : nullptr) {}
 
     state_restore_t begin_vector() {
         if (output_state == OBJ_START) output_state = OBJ_END;
         BUG_CHECK(output_state != VEC_START, "invalid json output state in begin_vector");
         state_restore_t rv(*this, VECTOR);
         output_state = VEC_START;
-        out << '[';
-        ++indent;
+        if (binary) {
+            binary->beginVector();
+        } else {
+            out << '[';
+            ++indent;
+        }
         return rv;
     }
 
     void end_vector(state_restore_t &prev) {
         BUG_CHECK(prev.kind == VECTOR, "invalid previous state in end_vector");
         prev.kind = NONE;
-        --indent;
-        if (output_state == VEC_MID)
-            out << std::endl << indent;
-        else if (output_state != VEC_START)
+        if (output_state != VEC_MID && output_state != VEC_START)
             BUG("invalid json output state in end_vector");
-        out << ']';
+        if (binary) {
+            binary->end();
+        } else {
+            --indent;
+            if (output_state == VEC_MID) out << std::endl << indent;
+            out << ']';
+        }
         if ((output_state = prev.prev_state) == OBJ_AFTERTAG) output_state = OBJ_MID;
+        if (binary && output_state == TOP) binary->flush();
     }
 
     state_restore_t begin_object() {
@@ -128,10 +146,18 @@ class JSONGenerator {
         prev.kind = NONE;
         switch (output_state) {
             case OBJ_START:
-                out << "{}";
+                if (binary) {
+                    binary->beginObject();
+                    binary->end();
+                } else {
+                    out << "{}";
+                }
                 break;
             case OBJ_MID:
-                out << std::endl << --indent << '}';
+                if (binary)
+                    binary->end();
+                else
+                    out << std::endl << --indent << '}';
                 break;
             case OBJ_END:
                 break;
@@ -143,16 +169,17 @@ class JSONGenerator {
                 break;
         }
         if ((output_state = prev.prev_state) == OBJ_AFTERTAG) output_state = OBJ_MID;
+        if (binary && output_state == TOP) binary->flush();
     }
 
     template <typename T>
     void emit(const T &val) {
         switch (output_state) {
             case VEC_MID:
-                out << ',';
+                if (!binary) out << ',';
                 /* fall through */
             case VEC_START:
-                out << std::endl << indent;
+                if (!binary) out << std::endl << indent;
                 output_state = VEC_MID;
                 break;
             case OBJ_AFTERTAG:
@@ -168,16 +195,23 @@ class JSONGenerator {
                 BUG("invalid json output state for emit(obj)");
         }
         generate(val);
-        if (output_state == TOP) out << std::endl;
+        if (output_state != TOP) return;
+        if (binary)
+            binary->flush();
+        else
+            out << std::endl;
     }
 
     void emit_tag(std::string_view tag) {
         switch (output_state) {
             case OBJ_START:
-                out << '{' << std::endl << ++indent;
+                if (binary)
+                    binary->beginObject();
+                else
+                    out << '{' << std::endl << ++indent;
                 break;
             case OBJ_MID:
-                out << ',' << std::endl << indent;
+                if (!binary) out << ',' << std::endl << indent;
                 break;
             case TOP:
             case VEC_START:
@@ -186,7 +220,12 @@ class JSONGenerator {
             case OBJ_END:
                 BUG("invalid json output state for emit_tag");
         }
-        out << '\"' << cstring(tag).escapeJson() << "\" : ";
+        if (binary) {
+            binary->string(tag);
+            binary->maybeFlush();
+        } else {
+            out << '\"' << cstring(tag).escapeJson() << "\" : ";
+        }
         output_state = OBJ_AFTERTAG;
     }
 
@@ -278,19 +317,57 @@ class JSONGenerator {
         end_object(t);
     }
 
-    void generate(bool v) { out << (v ? "true" : "false"); }
+    // Values that JSON writes as strings of their printed form.
+    template <typename T>
+    void generate_printed(const T &v) {
+        if (binary) {
+            std::stringstream tmp;
+            tmp << v;
+            binary->string(tmp.str());
+        } else {
+            out << "\"" << v << "\"";
+        }
+    }
+
+    void generate(bool v) {
+        if (binary)
+            binary->boolean(v);
+        else
+            out << (v ? "true" : "false");
+    }
     template <typename T>
     std::enable_if_t<std::is_integral_v<T>> generate(T v) {
-        out << std::to_string(v);
+        if (!binary) {
+            out << std::to_string(v);
+        } else if constexpr (std::is_signed_v<T> || sizeof(T) < sizeof(int64_t)) {
+            binary->integer(static_cast<int64_t>(v));
+        } else if (v <= static_cast<T>(std::numeric_limits<int64_t>::max())) {
+            binary->integer(static_cast<int64_t>(v));
+        } else {
+            binary->number(big_int(v));
+        }
+    }
+    void generate(double v) {
+        if (binary)
+            binary->string(std::to_string(v));
+        else
+            out << std::to_string(v);
     }
-    void generate(double v) { out << std::to_string(v); }
     template <typename T>
     std::enable_if_t<std::is_same_v<T, big_int>> generate(const T &v) {
-        out << v;
+        if (binary)
+            binary->number(v);
+        else
+            out << v;
     }
 
     void generate(cstring v) {
-        if (v) {
+        if (binary) {
+            if (v)
+                binary->string(v.string_view());
+            else
+                binary->null();
+        } else if (v) {
             out << "\"" << v.escapeJson() << "\"";
         } else {
             out << "null";
@@ -298,10 +375,10 @@ class JSONGenerator {
     }
     template <typename T>
     std::enable_if_t<std::is_same_v<T, LTBitMatrix> || std::is_enum_v<T>> generate(T v) {
-        out << "\"" << v << "\"";
+        generate_printed(v);
     }
 
-    void generate(const bitvec &v) { out << "\"" << v << "\""; }
+    void generate(const bitvec &v) { generate_printed(v); }
 
     void generate(const match_t &v) {
         auto t = begin_object();
@@ -336,6 +413,8 @@ class JSONGenerator {
         T v) {
         if (v)
             generate(*v);
+        else if (binary)
+            binary->null();
         else
             out << "null";
     }
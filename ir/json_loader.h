@@ -26,6 +26,7 @@ limitations under the License.
 #include <variant>
 
 #include "ir.h"
+#include "ir/binary_ir.h"
 #include "json_parser.h"
 #include "lib/bitvec.h"
 #include "lib/cstring.h"
@@ -64,7 +65,10 @@ class JSONLoader {
  public:
     explicit JSONLoader(std::istream &in)
         : node_refs(*(new std::unordered_map<int, IR::Node *>())) {
-        in >> json_root;
+        if (BinaryIR::isBinary(in))
+            json_root = BinaryIR::read(in);
+        else
+            in >> json_root;
         json = json_root.get();
     }
 
@@ -424,7 +428,7 @@ class JSONLoader {
 
 template <class T>
 IR::Vector<T>::Vector(JSONLoader &json) : VectorBase(json) {
-    json.load("vec", vec);
+    json.load("vec", vec.mutate());
 }
 template <class T>
 IR::Vector<T> *IR::Vector<T>::fromJSON(JSONLoader &json) {
@@ -432,7 +436,7 @@ IR::Vector<T> *IR::Vector<T>::fromJSON(JSONLoader &json) {
 }
 template <class T>
 IR::IndexedVector<T>::IndexedVector(JSONLoader &json) : Vector<T>(json) {
-    json.load("declarations", declarations);
+    json.load("declarations", declarations.mutate());
 }
 template <class T>
 IR::IndexedVector<T> *IR::IndexedVector<T>::fromJSON(JSONLoader &json) {
@@ -19,7 +19,10 @@ limitations under the License.
 
 #include "node.h"
 
+#include "config.h"
+
 #include <ostream>
+#include <vector>
 // use in combination with "raise" below
 // #include <csignal>
 
@@ -27,6 +30,7 @@ limitations under the License.
 #include "ir/ir.h"
 #include "ir/json_generator.h"
 #include "ir/json_loader.h"
+#include "lib/arena.h"
 #include "lib/indent.h"
 #include "lib/json.h"
 #include "lib/log.h"
@@ -37,6 +41,48 @@ void IR::Node::traceVisit(const char *visitor) const {
     LOG3("Visiting " << visitor << " " << id << ":" << node_type_name());
 }
 
+#if HAVE_IR_ARENA
+namespace {
+
+/// Every node allocated from an arena is preceded by the record used to destroy it when
+/// the arena is released.  The record is only filled in once the node is constructed.
+constexpr size_t arenaHeaderSize =
+    (sizeof(Util::Arena::Cleanup) + Util::Arena::alignment - 1) & ~(Util::Arena::alignment - 1);
+
+struct PendingNode {
+    Util::Arena *arena;
+    char *start, *end;
+};
+
+/// Nodes allocated but not constructed yet.  This is a stack, as constructor arguments
+/// may allocate nodes of their own between the allocation and the construction of a node.
+thread_local std::vector<PendingNode> pendingNodes;
+
+Util::Arena::Cleanup *arenaHeader(void *p) {
+    return reinterpret_cast<Util::Arena::Cleanup *>(static_cast<char *>(p) - arenaHeaderSize);
+}
+
+void destroyNode(void *node) { static_cast<IR::Node *>(node)->~Node(); }
+
+/// Called from the Node constructors: if @p node lives in memory just handed out by an
+/// arena, have the arena destroy it on release.  Nodes elsewhere (on the heap, on the
+/// stack or in static storage) are not pending and are left alone.
+void adoptByArena(const IR::Node *node) {
+    const char *addr = reinterpret_cast<const char *>(node);
+    for (auto it = pendingNodes.rbegin(); it != pendingNodes.rend(); ++it) {
+        if (addr < it->start || addr >= it->end) continue;
+        auto *header = arenaHeader(it->start);
+        header->fn = destroyNode;
+        header->obj = const_cast<IR::Node *>(node);
+        it->arena->atRelease(header);
+        pendingNodes.erase(std::next(it).base());
+        return;
+    }
+}
+
+}  // namespace
+#endif /* HAVE_IR_ARENA */
+
 void IR::Node::traceCreation() const {
     /*
       You can use this to trigger a breakpoint in the debugger when a
@@ -45,9 +91,44 @@ void IR::Node::traceCreation() const {
         raise(SIGINT);
     */
     LOG5("Created node " << id);
+#if HAVE_IR_ARENA
+    adoptByArena(this);
+#endif
+}
+
+void *IR::Node::operator new(size_t size) {
+#if HAVE_IR_ARENA
+    if (auto *arena = Util::Arena::current()) {
+        auto *mem = static_cast<char *>(arena->allocate(arenaHeaderSize + size));
+        new (mem) Util::Arena::Cleanup{nullptr, nullptr, nullptr};
+        pendingNodes.push_back({arena, mem + arenaHeaderSize, mem + arenaHeaderSize + size});
+        return mem + arenaHeaderSize;
+    }
+#endif
+    return ::operator new(size);
+}
+
+void IR::Node::operator delete(void *p) {
+#if HAVE_IR_ARENA
+    if (auto *arena = Util::Arena::current()) {
+        if (arena->contains(p)) {
+            // Either the node was deleted explicitly, or its constructor threw.  In both
+            // cases it must not be destroyed again; the memory goes with the arena.
+            arenaHeader(p)->fn = nullptr;
+            for (auto it = pendingNodes.begin(); it != pendingNodes.end(); ++it) {
+                if (it->start == p) {
+                    pendingNodes.erase(it);
+                    break;
+                }
+            }
+            return;
+        }
+    }
+#endif
+    ::operator delete(p);
 }
 
-int IR::Node::currentId = 0;
+std::atomic<int> IR::Node::currentId = 0;
 
 void IR::Node::toJSON(JSONGenerator &json) const {
     json.emit("Node_ID", id);
@@ -57,10 +138,11 @@ void IR::Node::toJSON(JSONGenerator &json) const {
 IR::Node::Node(JSONLoader &json) : id(-1) {
     json.load("Node_ID", id);
     if (id < 0)
-        id = currentId++;
+        id = nextId();
     else if (id >= currentId)
         currentId = id + 1;
     clone_id = id;
+    traceCreation();
 }
 
 // Abbreviated debug print
@@ -113,7 +195,7 @@ Util::JsonObject *IR::Node::sourceInfoJsonObj() const {
     unsigned lineNumber, columnNumber;
     cstring fName = prepareSourceInfoForJSON(si, &lineNumber, &columnNumber);
     if (fName == nullptr) {
-        if (si.line == -1) {
+        if (si.line() == -1) {
             // -1 is default value for objects when SourceInfo
             // was not read from jsonFile using "--fromJSON" flag
             return nullptr;
@@ -121,10 +203,10 @@ Util::JsonObject *IR::Node::sourceInfoJsonObj() const {
             // Added source_info for jsonObject when "--fromJSON" flag is used
             // which parameters are saved in srcInfo fileds(filename, line, column and srcBrief)
             auto json1 = new Util::JsonObject();
-            json1->emplace("filename", srcInfo.filename);
-            json1->emplace("line", srcInfo.line);
-            json1->emplace("column", srcInfo.column);
-            json1->emplace("source_fragment", srcInfo.srcBrief);
+            json1->emplace("filename", srcInfo.filename());
+            json1->emplace("line", srcInfo.line());
+            json1->emplace("column", srcInfo.column());
+            json1->emplace("source_fragment", srcInfo.srcBrief());
             return json1;
         }
     } else {
@@ -156,10 +238,13 @@ void IR::Node::sourceInfoToJSON(JSONGenerator &json) const {
 
 void IR::Node::sourceInfoFromJSON(JSONLoader &json) {
     if (auto si = JSONLoader(json, "Source_Info")) {
-        si.load("filename", srcInfo.filename);
-        si.load("line", srcInfo.line);
-        si.load("column", srcInfo.column);
-        si.load("source_fragment", srcInfo.srcBrief);
+        cstring filename = cstring::empty, srcBrief = cstring::empty;
+        int line = -1, column = -1;
+        si.load("filename", filename);
+        si.load("line", line);
+        si.load("column", column);
+        si.load("source_fragment", srcBrief);
+        srcInfo = Util::SourceInfo(filename, line, column, srcBrief);
     }
 }
 
@@ -17,6 +17,7 @@ limitations under the License.
 #ifndef IR_NODE_H_
 #define IR_NODE_H_
 
+#include <atomic>
 #include <iosfwd>
 
 #include "ir-tree-macros.h"
@@ -34,6 +35,7 @@ class Modifier;
 class Transform;
 class JSONGenerator;
 class JSONLoader;
+class PassProfiler;
 }  // namespace P4
 
 namespace P4::Util {
@@ -105,16 +107,28 @@ class Node : public virtual INode {
     virtual const Node *apply_visitor_postorder(Transform &v);
     virtual void apply_visitor_revisit(Transform &v, const Node *n) const;
     virtual void apply_visitor_loop_revisit(Transform &v) const;
-    Node &operator=(const Node &) = default;
-    Node &operator=(Node &&) = default;
+    // Assignment does not make a node canonical; see isCanonical.
+    Node &operator=(const Node &other) {
+        srcInfo = other.srcInfo;
+        id = other.id;
+        clone_id = other.clone_id;
+        return *this;
+    }
+    Node &operator=(Node &&other) { return *this = static_cast<const Node &>(other); }
 
  protected:
-    static int currentId;
+    // atomic so that nodes can be created on PassManager worker threads
+    static std::atomic<int> currentId;
+    static int nextId() { return currentId.fetch_add(1, std::memory_order_relaxed); }
     void traceVisit(const char *visitor) const;
+    /// Set on the shared nodes handed out by a HashConsTable.  Not copied by clone().
+    bool canonical = false;
+    friend class HashConsTableBase;
     friend class ::P4::Visitor;
     friend class ::P4::Inspector;
     friend class ::P4::Modifier;
     friend class ::P4::Transform;
+    friend class ::P4::PassProfiler;
     cstring prepareSourceInfoForJSON(Util::SourceInfo &si, unsigned *lineNumber,
                                      unsigned *columnNumber) const;
 
@@ -123,14 +137,19 @@ class Node : public virtual INode {
     int id;        // unique id for each node
     int clone_id;  // unique id this node was cloned from (recursively)
     void traceCreation() const;
-    Node() : id(currentId++), clone_id(id) { traceCreation(); }
-    explicit Node(Util::SourceInfo si) : srcInfo(si), id(currentId++), clone_id(id) {
+    Node() : id(nextId()), clone_id(id) { traceCreation(); }
+    explicit Node(Util::SourceInfo si) : srcInfo(si), id(nextId()), clone_id(id) {
         traceCreation();
     }
-    Node(const Node &other) : srcInfo(other.srcInfo), id(currentId++), clone_id(other.clone_id) {
+    Node(const Node &other) : srcInfo(other.srcInfo), id(nextId()), clone_id(other.clone_id) {
         traceCreation();
     }
     virtual ~Node() {}
+    /// In builds configured with ENABLE_IR_ARENA, nodes are allocated from the current
+    /// Util::Arena (if any) and destroyed when it is released; otherwise they come from
+    /// the regular (usually garbage collected) heap.
+    static void *operator new(size_t size);
+    static void operator delete(void *p);
     const Node *apply(Visitor &v, const Visitor_Context *ctxt = nullptr) const;
     const Node *apply(Visitor &&v, const Visitor_Context *ctxt = nullptr) const {
         return apply(v, ctxt);
@@ -144,6 +163,19 @@ class Node : public virtual INode {
     cstring node_type_name() const override { return "Node"_cs; }
     static cstring static_type_name() { return "Node"_cs; }
     virtual int num_children() { return 0; }
+    /// True for nodes shared through hash-consing (see ir/hash_cons.h).  Two distinct
+    /// canonical nodes are never equiv.
+    bool isCanonical() const { return canonical; }
+    /// The bit that stands for nodes of type @p typeId in kindSummary().  Several types
+    /// share each bit.
+    static constexpr uint64_t kindBit(RTTI::TypeId typeId) {
+        return uint64_t(1) << ((typeId ^ (typeId >> RTTI::kDiscriminatorBits)) % 64);
+    }
+    /// The kindBit() of the types of all the nodes in the subtree rooted at this node, as
+    /// visited by visit_children.  If the bit of a type is clear, the subtree does not contain
+    /// a node of that type.  Walks the whole subtree; an Inspector that skips subtrees
+    /// computes the summaries once per apply instead.
+    uint64_t kindSummary() const;
     explicit Node(JSONLoader &json);
     cstring toString() const override { return node_type_name(); }
     void toJSON(JSONGenerator &json) const override;
@@ -18,22 +18,96 @@ limitations under the License.
 
 #include <cstddef>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/cleanup/cleanup.h"
 #include "ir/dump.h"
+#include "ir/ir.h"
 #include "ir/node.h"
+#include "ir/pass_profiler.h"
 #include "ir/visitor.h"
 #include "lib/error.h"
 #include "lib/gc.h"
 #include "lib/indent.h"
 #include "lib/log.h"
 #include "lib/n4.h"
+#include "lib/thread_pool.h"
 
 namespace P4 {
 
+namespace {
+
+/// Apply @p v to each top-level declaration of @p program: clones of it on the threads
+/// of @p pool if there is one, @p v itself otherwise.  Declarations that @p fixpoints says
+/// @p v leaves unchanged are skipped.  The results are put back in declaration order, so
+/// the resulting program does not depend on how the work was scheduled.
+const IR::Node *applyPerDeclaration(Util::WorkStealingPool *pool, Visitor &v,
+                                    const IR::P4Program *program,
+                                    const Visitor::Context *parent,
+                                    DeclarationFixpoints *fixpoints) {
+    const auto &objects = program->objects;
+    std::vector<const IR::Node *> results(objects.size());
+    absl::flat_hash_set<const IR::Node *> *unchanged =
+        fixpoints ? &fixpoints->unchanged[&v] : nullptr;
+    std::vector<size_t> todo;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (unchanged && unchanged->count(objects.at(i)))
+            results[i] = objects.at(i);
+        else
+            todo.push_back(i);
+    }
+
+    auto applyTo = [&](Visitor &visitor, size_t i) {
+        // Make the program visible through findContext, as in a whole-program run.
+        Visitor::Context ctxt;
+        ctxt.parent = parent;
+        ctxt.node = ctxt.original = program;
+        ctxt.child_name = "objects";
+        ctxt.child_index = i;
+        ctxt.depth = parent ? parent->depth + 1 : 1;
+        results[i] = objects.at(i)->apply(visitor, &ctxt);
+    };
+    if (pool) {
+        pool->parallelFor(todo.size(), [&](size_t t) {
+            auto *clone = v.clone();
+            clone->unshare_split_link();
+            applyTo(*clone, todo[t]);
+        });
+    } else {
+        for (auto i : todo) applyTo(v, i);
+    }
+
+    if (fixpoints) {
+        fixpoints->visited += todo.size();
+        fixpoints->skipped += objects.size() - todo.size();
+        for (auto i : todo)
+            if (results[i] == objects.at(i)) unchanged->insert(objects.at(i));
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < results.size(); ++i) changed |= results[i] != objects.at(i);
+    if (!changed) return program;
+
+    auto *rv = program->clone();
+    rv->objects.clear();
+    for (const auto *result : results) {
+        if (!result) continue;
+        if (const auto *vec = result->to<IR::VectorBase>()) {
+            for (const auto *el : *vec) rv->objects.push_back(el);
+        } else {
+            rv->objects.push_back(result);
+        }
+    }
+    return rv;
+}
+
+}  // namespace
+
 void PassManager::removePasses(const std::vector<cstring> &exclude) {
     for (auto it : exclude) {
         bool excluded = false;
@@ -68,6 +142,10 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
         ~indent_nesting() { --indent; }
     } nest_log_indent(log_indent);
 
+    // Nested pass managers are profiled as a pass of their parent.
+    std::optional<PassProfiler::Scope> profile;
+    if (!PassProfiler::inPass()) profile.emplace(name(), program);
+
     early_exit_flag = false;
     unsigned initial_error_count = ::P4::errorCount();
     BUG_CHECK(running, "not calling apply properly");
@@ -81,7 +159,9 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
         try {
             try {
                 LOG1(log_indent << name() << " invoking " << v->name());
-                program = program->apply(**it, getChildContext());
+                PassProfiler::Scope passProfile(v->name(), program);
+                program = applyPass(*v, program);
+                passProfile.finish(program);
                 if (LOGGING(3)) {
                     size_t maxmem, mem = gc_mem_inuse(&maxmem);  // triggers gc
                     LOG3(log_indent << "heap after " << v->name() << ": in use " << n4(mem)
@@ -118,9 +198,30 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
         it++;
     }
     running = false;
+    if (profile) profile->finish(program);
     return program;
 }
 
+void PassManager::setFixpoints(DeclarationFixpoints *f) {
+    fixpoints = f;
+    for (auto *pass : passes)
+        if (auto *child = dynamic_cast<PassManager *>(pass)) child->setFixpoints(f);
+}
+
+const IR::Node *PassManager::applyPass(Visitor &v, const IR::Node *program) {
+    if (v.perDeclarationSafe()) {
+        auto *pool = Util::WorkStealingPool::get();
+        if (pool || fixpoints) {
+            if (const auto *p4program = program->to<IR::P4Program>()) {
+                if (pool)
+                    LOG2("running " << v.name() << " on " << pool->concurrency() << " threads");
+                return applyPerDeclaration(pool, v, p4program, getChildContext(), fixpoints);
+            }
+        }
+    }
+    return program->apply(v, getChildContext());
+}
+
 bool PassManager::backtrack(trigger &trig) {
     for (Visitor *v : passes)
         if (auto *bt = dynamic_cast<Backtrack *>(v))
@@ -150,16 +251,27 @@ const IR::Node *PassRepeated::apply_visitor(const IR::Node *program, const char
     bool done = false;
     unsigned iterations = 0;
     unsigned initial_error_count = ::P4::errorCount();
+    DeclarationFixpoints declFixpoints;
+    auto *enclosing = fixpoints;
+    setFixpoints(&declFixpoints);
+    // Also restored when a pass backtracks or throws, so no pass is left pointing at
+    // declFixpoints.
+    absl::Cleanup restore = [this, enclosing] { setFixpoints(enclosing); };
     while (!done) {
         LOG5("PassRepeated state is:\n" << dumpToString(program));
         running = true;
         auto newprogram = PassManager::apply_visitor(program, name);
         if (program == newprogram || newprogram == nullptr) done = true;
-        if (stop_on_error && ::P4::errorCount() > initial_error_count) return program;
+        if (stop_on_error && ::P4::errorCount() > initial_error_count) break;
         iterations++;
         if (repeats != 0 && iterations > repeats) done = true;
         program = newprogram;
     }
+    stats.iterations += iterations;
+    stats.declarationsVisited += declFixpoints.visited;
+    stats.declarationsSkipped += declFixpoints.skipped;
+    LOG1(this->name() << " converged after " << iterations << " iterations; declarations visited "
+                      << declFixpoints.visited << ", skipped " << declFixpoints.skipped);
     return program;
 }
 
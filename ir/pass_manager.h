@@ -23,6 +23,8 @@ limitations under the License.
 #include <type_traits>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "ir/node.h"
 #include "ir/visitor.h"
 #include "lib/cstring.h"
@@ -37,6 +39,15 @@ typedef std::function<void(const char *manager, unsigned seqNo, const char *pass
                            const IR::Node *node)>
     DebugHook;
 
+/// What a PassRepeated remembers from one iteration to the next: for each
+/// perDeclarationSafe pass, the top-level declarations it returned unchanged.  Applying the
+/// pass to one of those again would not change it either, so it is skipped.
+struct DeclarationFixpoints {
+    absl::flat_hash_map<const Visitor *, absl::flat_hash_set<const IR::Node *>> unchanged;
+    size_t visited = 0;  // declarations passes were applied to
+    size_t skipped = 0;  // declarations passes were known to leave unchanged
+};
+
 class PassManager : virtual public Visitor, virtual public Backtrack {
     bool early_exit_flag = false;
     mutable int never_backtracks_cache = -1;
@@ -49,6 +60,13 @@ class PassManager : virtual public Visitor, virtual public Backtrack {
     bool running = false;
     unsigned seqNo = 0;
     void runDebugHooks(const char *visitorName, const IR::Node *node);
+    /// Set by an enclosing PassRepeated (possibly this one) while it runs.
+    DeclarationFixpoints *fixpoints = nullptr;
+    void setFixpoints(DeclarationFixpoints *f);
+    /// Apply a single pass to the program.  Passes that are perDeclarationSafe are run
+    /// over the declarations of a P4Program on the shared WorkStealingPool, if there is one,
+    /// and skip the declarations recorded in fixpoints.
+    const IR::Node *applyPass(Visitor &v, const IR::Node *program);
     profile_t init_apply(const IR::Node *root) override {
         running = true;
         return Visitor::init_apply(root);
@@ -144,6 +162,19 @@ class OnBacktrack : virtual public Visitor, virtual public Backtrack {
 // Repeat a pass until convergence (or up to a fixed number of repeats)
 class PassRepeated : virtual public PassManager {
     unsigned repeats;  // 0 = until convergence
+
+ public:
+    /// Work done by all runs so far.  After the first iteration of a run, passes that are
+    /// perDeclarationSafe only revisit the top-level declarations that changed.
+    struct Stats {
+        unsigned iterations = 0;
+        size_t declarationsVisited = 0;
+        size_t declarationsSkipped = 0;
+    };
+
+ private:
+    Stats stats;
+
  public:
     PassRepeated() : repeats(0) {}
     explicit PassRepeated(const std::initializer_list<VisitorRef> &init, unsigned repeats = 0)
@@ -156,6 +187,7 @@ class PassRepeated : virtual public PassManager {
         return this;
     }
     PassRepeated *clone() const override { return new PassRepeated(*this); }
+    const Stats &getStats() const { return stats; }
 };
 
 class PassRepeatUntil : virtual public PassManager {
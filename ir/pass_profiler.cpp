@@ -0,0 +1,168 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ir/pass_profiler.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <ostream>
+
+#include "ir/visitor.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+std::unique_ptr<PassProfiler> &activeProfiler() {
+    static std::unique_ptr<PassProfiler> profiler;
+    return profiler;
+}
+
+thread_local int passDepth = 0;
+
+/// Small ids for the threads running passes, in the order they first ran one.
+int threadIndex() {
+    static std::atomic<int> threads = 0;
+    thread_local int index = threads.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+class CountNodes : public Inspector {
+    int firstNewId;
+
+    bool preorder(const IR::Node *node) override {
+        ++total;
+        if (node->id >= firstNewId) ++created;
+        return true;
+    }
+
+ public:
+    size_t total = 0;
+    size_t created = 0;
+    explicit CountNodes(int firstNewId) : firstNewId(firstNewId) { setName("CountNodes"); }
+};
+
+// The result of the last count on this thread, which is usually the root of the next pass.
+thread_local const IR::Node *lastCounted = nullptr;
+thread_local size_t lastCount = 0;
+
+}  // namespace
+
+void PassProfiler::start(std::filesystem::path file) {
+    activeProfiler() = std::make_unique<PassProfiler>(std::move(file));
+}
+
+void PassProfiler::stop() { activeProfiler().reset(); }
+
+PassProfiler *PassProfiler::get() { return activeProfiler().get(); }
+
+PassProfiler::PassProfiler(std::filesystem::path file)
+    : file(std::move(file)), epoch(std::chrono::steady_clock::now()) {
+    gc_stats();  // starts timing collections
+}
+
+PassProfiler::~PassProfiler() {
+    if (file.empty()) return;
+    std::ofstream out(file);
+    if (!out) {
+        std::cerr << "Cannot write pass profile to " << file << std::endl;
+        return;
+    }
+    write(out);
+}
+
+std::vector<PassProfiler::Event> PassProfiler::events() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return recorded;
+}
+
+void PassProfiler::record(const Event &event) {
+    std::lock_guard<std::mutex> guard(lock);
+    recorded.push_back(event);
+}
+
+void PassProfiler::write(std::ostream &out) const {
+    std::lock_guard<std::mutex> guard(lock);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    const char *sep = "\n";
+    for (const auto &e : recorded) {
+        out << sep << "{\"name\": \"" << e.name.escapeJson()
+            << "\", \"cat\": \"pass\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.thread
+            << ", \"ts\": " << e.startUs << ", \"dur\": " << e.durationUs
+            << ", \"args\": {\"bytesAllocated\": " << e.bytesAllocated
+            << ", \"collections\": " << e.collections << ", \"collectionMs\": " << e.collectionMs
+            << ", \"nodesBefore\": " << e.nodesBefore << ", \"nodesAfter\": " << e.nodesAfter
+            << ", \"nodesNew\": " << e.nodesNew << "}}";
+        sep = ",\n";
+    }
+    out << "\n]}" << std::endl;
+}
+
+bool PassProfiler::inPass() { return passDepth > 0; }
+
+int PassProfiler::currentNodeId() { return IR::Node::currentId.load(std::memory_order_relaxed); }
+
+PassProfiler::Scope::Scope(const char *name, const IR::Node *root) : profiler(get()) {
+    if (!profiler) return;
+    ++passDepth;
+    event.name = cstring(name);
+    event.thread = threadIndex();
+    if (root && root == lastCounted) {
+        event.nodesBefore = lastCount;
+    } else if (root) {
+        CountNodes count(0);
+        root->apply(count);
+        event.nodesBefore = count.total;
+    }
+    // Counting is not part of the pass.
+    firstNewId = currentNodeId();
+    gcStart = gc_stats();
+    start = std::chrono::steady_clock::now();
+}
+
+void PassProfiler::Scope::finish(const IR::Node *result) {
+    if (!profiler) return;
+    auto end = std::chrono::steady_clock::now();
+    auto gcEnd = gc_stats();
+    using std::chrono::microseconds;
+    event.startUs = std::chrono::duration_cast<microseconds>(start - profiler->epoch).count();
+    event.durationUs =
+        std::chrono::duration_cast<microseconds>(end - profiler->epoch).count() - event.startUs;
+    event.bytesAllocated = gcEnd.bytes_allocated - gcStart.bytes_allocated;
+    event.collections = gcEnd.collections - gcStart.collections;
+    event.collectionMs = gcEnd.collection_ms - gcStart.collection_ms;
+    if (result) {
+        CountNodes count(firstNewId);
+        result->apply(count);
+        event.nodesAfter = count.total;
+        event.nodesNew = count.created;
+        lastCounted = result;
+        lastCount = count.total;
+    }
+    LOG2("profiled " << event.name << ": " << event.durationUs << "us, " << event.nodesNew
+                     << " new nodes");
+    profiler->record(event);
+    profiler = nullptr;
+    --passDepth;
+}
+
+PassProfiler::Scope::~Scope() {
+    // Leaving without finish() means the pass threw; record what it took anyway.
+    if (profiler) finish(nullptr);
+}
+
+}  // namespace P4
@@ -0,0 +1,97 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IR_PASS_PROFILER_H_
+#define IR_PASS_PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+
+#include "ir/node.h"
+#include "lib/cstring.h"
+#include "lib/gc.h"
+
+namespace P4 {
+
+/// Records, for every pass run by a PassManager, its wall time, the memory it allocated,
+/// the garbage collections it triggered and how many IR nodes it created.  Enabled with
+/// --pass-profile; the profile is written in the Chrome trace event format, so it can be
+/// loaded in chrome://tracing or Perfetto, where nested passes show up nested.
+class PassProfiler {
+ public:
+    struct Event {
+        cstring name;
+        int thread;
+        int64_t startUs;
+        int64_t durationUs;
+        size_t bytesAllocated;
+        size_t collections;
+        size_t collectionMs;
+        size_t nodesBefore;  // nodes reachable from the root before the pass
+        size_t nodesAfter;   // nodes reachable from the result
+        size_t nodesNew;     // nodes in the result created during the pass
+    };
+
+    /// Profile the rest of the compilation, and write the result to @p file when the
+    /// program exits.
+    static void start(std::filesystem::path file);
+    /// Stop profiling, writing the profile now.
+    static void stop();
+    /// @return the active profiler, or nullptr if profiling is off.
+    static PassProfiler *get();
+
+    explicit PassProfiler(std::filesystem::path file = {});
+    PassProfiler(const PassProfiler &) = delete;
+    /// Writes the profile to the file given to the constructor, if any.
+    ~PassProfiler();
+
+    std::vector<Event> events() const;
+    /// Write the events as a Chrome trace.
+    void write(std::ostream &out) const;
+
+    /// Profiles a pass from construction until finish() is called (or the scope is left
+    /// by an exception).  Does nothing when profiling is off.
+    class Scope {
+        PassProfiler *profiler;
+        Event event{};
+        int firstNewId = 0;
+        std::chrono::steady_clock::time_point start;
+        gc_stats_t gcStart;
+
+     public:
+        Scope(const char *name, const IR::Node *root);
+        Scope(const Scope &) = delete;
+        ~Scope();
+        void finish(const IR::Node *result);
+    };
+    /// @return true while a pass is being profiled on this thread.
+    static bool inPass();
+
+ private:
+    std::filesystem::path file;
+    std::chrono::steady_clock::time_point epoch;
+    mutable std::mutex lock;
+    std::vector<Event> recorded;
+
+    void record(const Event &event);
+    static int currentNodeId();
+};
+
+}  // namespace P4
+
+#endif /* IR_PASS_PROFILER_H_ */
@@ -15,11 +15,11 @@ limitations under the License.
 */
 
 #include <cstddef>
-#include <map>
 #include <utility>
 
 #include "frontends/common/parser_options.h"
 #include "ir/configuration.h"
+#include "ir/hash_cons.h"
 #include "ir/id.h"
 #include "ir/ir.h"
 #include "ir/vector.h"
@@ -49,19 +49,16 @@ const IR::ID IR::Type_Table::hit = ID("hit");
 const IR::ID IR::Type_Table::miss = ID("miss");
 const IR::ID IR::Type_Table::action_run = ID("action_run");
 
-long Type_Declaration::nextId = 0;
-long Type_InfInt::nextId = 0;
-long Type_Any::nextId = 0;
+std::atomic<long> Type_Declaration::nextId = 0;
+std::atomic<long> Type_InfInt::nextId = 0;
+std::atomic<long> Type_Any::nextId = 0;
 
 const Type *Type_Stack::at(size_t) const { return elementType; }
 
 const Type_Bits *Type_Bits::get(int width, bool isSigned) {
-    // map (width, signed) to type
-    using bit_type_key = std::pair<int, bool>;
-    static std::map<bit_type_key, const IR::Type_Bits *> *type_map = nullptr;
-    if (type_map == nullptr) type_map = new std::map<bit_type_key, const IR::Type_Bits *>();
-    auto &result = (*type_map)[std::make_pair(width, isSigned)];
-    if (!result) result = new Type_Bits(width, isSigned);
+    static HashConsTable<Type_Bits, std::pair<int, bool>> types("Type_Bits");
+    const auto *result =
+        types.get({width, isSigned}, [&] { return new Type_Bits(width, isSigned); });
     if (width > P4CContext::getConfig().maximumWidthSupported())
         ::P4::error(ErrorType::ERR_UNSUPPORTED, "%1%: Compiler only supports widths up to %2%",
                     result, P4CContext::getConfig().maximumWidthSupported());
@@ -88,8 +85,8 @@ const Type_Bits *Type_Bits::get(const Util::SourceInfo &si, const IR::Expression
 }
 
 const Type_Unknown *Type_Unknown::get() {
-    static const Type_Unknown *singleton = nullptr;
-    if (!singleton) singleton = (new Type_Unknown());
+    static const Type_Unknown *singleton =
+        HashConsTableBase::makeSingleton([] { return new Type_Unknown(); });
     return singleton;
 }
 
@@ -99,8 +96,8 @@ const Type_Unknown *Type_Unknown::get(const Util::SourceInfo &si) {
 }
 
 const Type_Boolean *Type_Boolean::get() {
-    static const Type_Boolean *singleton = nullptr;
-    if (!singleton) singleton = (new Type_Boolean());
+    static const Type_Boolean *singleton =
+        HashConsTableBase::makeSingleton([] { return new Type_Boolean(); });
     return singleton;
 }
 
@@ -110,8 +107,8 @@ const Type_Boolean *Type_Boolean::get(const Util::SourceInfo &si) {
 }
 
 const Type_String *Type_String::get() {
-    static const Type_String *singleton = nullptr;
-    if (!singleton) singleton = (new Type_String());
+    static const Type_String *singleton =
+        HashConsTableBase::makeSingleton([] { return new Type_String(); });
     return singleton;
 }
 
@@ -149,8 +146,8 @@ const Type_InfInt *Type_InfInt::get(const Util::SourceInfo &si) {
 }
 
 const Type_Dontcare *Type_Dontcare::get() {
-    static const Type_Dontcare *singleton;
-    if (!singleton) singleton = (new Type_Dontcare());
+    static const Type_Dontcare *singleton =
+        HashConsTableBase::makeSingleton([] { return new Type_Dontcare(); });
     return singleton;
 }
 
@@ -160,8 +157,8 @@ const Type_Dontcare *Type_Dontcare::get(const Util::SourceInfo &si) {
 }
 
 const Type_State *Type_State::get() {
-    static const Type_State *singleton;
-    if (!singleton) singleton = (new Type_State());
+    static const Type_State *singleton =
+        HashConsTableBase::makeSingleton([] { return new Type_State(); });
     return singleton;
 }
 
@@ -171,8 +168,8 @@ const Type_State *Type_State::get(const Util::SourceInfo &si) {
 }
 
 const Type_Void *Type_Void::get() {
-    static const Type_Void *singleton = nullptr;
-    if (!singleton) singleton = (new Type_Void());
+    static const Type_Void *singleton =
+        HashConsTableBase::makeSingleton([] { return new Type_Void(); });
     return singleton;
 }
 
@@ -182,8 +179,8 @@ const Type_Void *Type_Void::get(const Util::SourceInfo &si) {
 }
 
 const Type_MatchKind *Type_MatchKind::get() {
-    static const Type_MatchKind *singleton = nullptr;
-    if (!singleton) singleton = (new Type_MatchKind());
+    static const Type_MatchKind *singleton =
+        HashConsTableBase::makeSingleton([] { return new Type_MatchKind(); });
     return singleton;
 }
 
@@ -18,6 +18,7 @@ limitations under the License.
 #define IR_VECTOR_H_
 
 #include "ir/node.h"
+#include "lib/cow_ptr.h"
 #include "lib/enumerator.h"
 #include "lib/indent.h"
 #include "lib/null.h"
@@ -55,9 +56,19 @@ class VectorBase : public Node {
 
 // This class should only be used in the IR.
 // User-level code should use regular std::vector
+// The elements are shared by the copies of a Vector (in particular the clones made by
+// Transform and Modifier) until one of them is modified.  Calling a non-const method
+// that gives access to the elements (e.g. begin()) makes the copy.
 template <class T>
 class Vector : public VectorBase {
-    safe_vector<const T *> vec;
+    cow_ptr<safe_vector<const T *>> vec;
+
+    /// Returns the position of @p i in the elements after they are copied for writing.
+    typename safe_vector<const T *>::iterator writable(
+        typename safe_vector<const T *>::iterator i) {
+        auto index = typename safe_vector<const T *>::const_iterator(i) - vec->begin();
+        return vec.mutate().begin() + index;
+    }
 
  public:
     typedef const T *value_type;
@@ -67,45 +78,53 @@ class Vector : public VectorBase {
     explicit Vector(JSONLoader &json);
     Vector &operator=(const Vector &) = default;
     Vector &operator=(Vector &&) = default;
-    explicit Vector(const T *a) { vec.emplace_back(a); }
-    explicit Vector(const safe_vector<const T *> &a) { vec.insert(vec.end(), a.begin(), a.end()); }
-    Vector(std::initializer_list<const T *> a) : vec(a) {}
+    explicit Vector(const T *a) { vec.mutate().emplace_back(a); }
+    explicit Vector(const safe_vector<const T *> &a) : vec(a) {}
+    Vector(std::initializer_list<const T *> a) : vec(safe_vector<const T *>(a)) {}
     template <class InputIt>
-    Vector(InputIt first, InputIt last) : vec(first, last) {}
+    Vector(InputIt first, InputIt last) : vec(safe_vector<const T *>(first, last)) {}
     Vector(Util::Enumerator<const T *> *e)  // NOLINT(runtime/explicit)
-        : vec(e->begin(), e->end()) {}
+        : vec(safe_vector<const T *>(e->begin(), e->end())) {}
     static Vector<T> *fromJSON(JSONLoader &json);
 
     using iterator = typename safe_vector<const T *>::iterator;
     using const_iterator = typename safe_vector<const T *>::const_iterator;
 
-    iterator begin() { return vec.begin(); }
-    const_iterator begin() const { return vec.begin(); }
+    iterator begin() { return vec.mutate().begin(); }
+    const_iterator begin() const { return vec->begin(); }
     VectorBase::iterator VectorBase_begin() const override {
         /* DANGER -- works as long as IR::Node is the first ultimate base class of T */
-        return reinterpret_cast<VectorBase::iterator>(&vec[0]);
+        return reinterpret_cast<VectorBase::iterator>(vec->data());
     }
-    iterator end() { return vec.end(); }
-    const_iterator end() const { return vec.end(); }
+    iterator end() { return vec.mutate().end(); }
+    const_iterator end() const { return vec->end(); }
     VectorBase::iterator VectorBase_end() const override {
         /* DANGER -- works as long as IR::Node is the first ultimate base class of T */
-        return reinterpret_cast<VectorBase::iterator>(&vec[0] + vec.size());
-    }
-    std::reverse_iterator<iterator> rbegin() { return vec.rbegin(); }
-    std::reverse_iterator<const_iterator> rbegin() const { return vec.rbegin(); }
-    std::reverse_iterator<iterator> rend() { return vec.rend(); }
-    std::reverse_iterator<const_iterator> rend() const { return vec.rend(); }
-    size_t size() const override { return vec.size(); }
-    void resize(size_t sz) { vec.resize(sz); }
-    bool empty() const override { return vec.empty(); }
-    const T *const &front() const { return vec.front(); }
-    const T *&front() { return vec.front(); }
-    void clear() { vec.clear(); }
-    iterator erase(iterator i) { return vec.erase(i); }
-    iterator erase(iterator s, iterator e) { return vec.erase(s, e); }
+        return reinterpret_cast<VectorBase::iterator>(vec->data() + vec->size());
+    }
+    std::reverse_iterator<iterator> rbegin() { return vec.mutate().rbegin(); }
+    std::reverse_iterator<const_iterator> rbegin() const { return vec->rbegin(); }
+    std::reverse_iterator<iterator> rend() { return vec.mutate().rend(); }
+    std::reverse_iterator<const_iterator> rend() const { return vec->rend(); }
+    size_t size() const override { return vec->size(); }
+    void resize(size_t sz) { vec.mutate().resize(sz); }
+    bool empty() const override { return vec->empty(); }
+    const T *const &front() const { return vec->front(); }
+    const T *&front() { return vec.mutate().front(); }
+    void clear() { vec = {}; }
+    iterator erase(iterator i) {
+        i = writable(i);
+        return vec.mutate().erase(i);
+    }
+    iterator erase(iterator s, iterator e) {
+        auto n = e - s;
+        s = writable(s);
+        return vec.mutate().erase(s, s + n);
+    }
     template <typename ForwardIter>
     iterator insert(iterator i, ForwardIter b, ForwardIter e) {
-        return vec.insert(i, b, e);
+        i = writable(i);
+        return vec.mutate().insert(i, b, e);
     }
 
     template <typename Container>
@@ -133,34 +152,40 @@ class Vector : public VectorBase {
         push_back(item->to<T>());
     }
 
-    iterator insert(iterator i, const T *v) { return vec.insert(i, v); }
-    iterator insert(iterator i, size_t n, const T *v) { return vec.insert(i, n, v); }
+    iterator insert(iterator i, const T *v) {
+        i = writable(i);
+        return vec.mutate().insert(i, v);
+    }
+    iterator insert(iterator i, size_t n, const T *v) {
+        i = writable(i);
+        return vec.mutate().insert(i, n, v);
+    }
 
-    const T *const &operator[](size_t idx) const { return vec[idx]; }
-    const T *&operator[](size_t idx) { return vec[idx]; }
-    const T *const &at(size_t idx) const { return vec.at(idx); }
-    const T *&at(size_t idx) { return vec.at(idx); }
+    const T *const &operator[](size_t idx) const { return (*vec)[idx]; }
+    const T *&operator[](size_t idx) { return vec.mutate()[idx]; }
+    const T *const &at(size_t idx) const { return vec->at(idx); }
+    const T *&at(size_t idx) { return vec.mutate().at(idx); }
     template <class... Args>
     void emplace_back(Args &&...args) {
-        vec.emplace_back(new T(std::forward<Args>(args)...));
+        vec.mutate().emplace_back(new T(std::forward<Args>(args)...));
     }
-    void push_back(T *a) { vec.push_back(a); }
-    void push_back(const T *a) { vec.push_back(a); }
-    void pop_back() { vec.pop_back(); }
-    const T *const &back() const { return vec.back(); }
-    const T *&back() { return vec.back(); }
+    void push_back(T *a) { vec.mutate().push_back(a); }
+    void push_back(const T *a) { vec.mutate().push_back(a); }
+    void pop_back() { vec.mutate().pop_back(); }
+    const T *const &back() const { return vec->back(); }
+    const T *&back() { return vec.mutate().back(); }
     template <class U>
     void push_back(U &a) {
-        vec.push_back(a);
+        vec.mutate().push_back(a);
     }
     void check_null() const {
-        for (auto e : vec) CHECK_NULL(e);
+        for (auto e : *vec) CHECK_NULL(e);
     }
 
     IRNODE_SUBCLASS(Vector)
     IRNODE_DECLARE_APPLY_OVERLOAD(Vector)
     bool operator==(const Node &a) const override { return a == *this; }
-    bool operator==(const Vector &a) const override { return vec == a.vec; }
+    bool operator==(const Vector &a) const override { return vec.shares(a.vec) || *vec == *a.vec; }
     /* DANGER -- if you get an error on the above line
      *       operator== ... marked ‘override’, but does not override
      * that mean you're trying to create an instantiation of IR::Vector that
@@ -192,7 +217,7 @@ class Vector : public VectorBase {
     virtual void parallel_visit_children(Visitor &v, const char *name = nullptr);
     virtual void parallel_visit_children(Visitor &v, const char *name = nullptr) const;
     void toJSON(JSONGenerator &json) const override;
-    Util::Enumerator<const T *> *getEnumerator() const { return Util::enumerate(vec); }
+    Util::Enumerator<const T *> *getEnumerator() const { return Util::enumerate(*vec); }
     template <typename S>
     Util::Enumerator<const S *> *only() const {
         return getEnumerator()->template as<const S *>()->where(
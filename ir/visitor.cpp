@@ -20,6 +20,8 @@ limitations under the License.
 #include <stdlib.h>
 #include <time.h>
 
+#include <mutex>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
@@ -35,6 +37,7 @@ limitations under the License.
 #endif
 
 #include "dbprint.h"
+#include "ir/dense_node_map.h"
 #include "ir/id.h"
 #include "ir/ir.h"
 #include "ir/vector.h"
@@ -48,6 +51,45 @@ namespace P4 {
 
 enum class VisitStatus : unsigned { New, Revisit, Busy, Done };
 
+namespace {
+
+/// Node maps of the visitors that finished, so that the next visitors can reuse their
+/// pages.  Shared by all threads rather than thread-local, so that the garbage collector
+/// sees the pointers in them.  Maps that would take the pool over its memory budget are
+/// freed instead.
+template <class V>
+class NodeMapPool {
+    static constexpr size_t maxFree = 16;
+    static constexpr size_t maxMemory = size_t(64) << 20;
+    std::mutex lock;
+    std::vector<std::unique_ptr<IR::DenseNodeMap<V>>> free;
+    size_t memory = 0;  // held by the maps in free
+
+ public:
+    static NodeMapPool &get() {
+        static auto *pool = new NodeMapPool;  // never destroyed, trackers may outlive it
+        return *pool;
+    }
+    std::unique_ptr<IR::DenseNodeMap<V>> acquire() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (free.empty()) return std::make_unique<IR::DenseNodeMap<V>>();
+        auto map = std::move(free.back());
+        free.pop_back();
+        memory -= map->memoryUsed();
+        return map;
+    }
+    void release(std::unique_ptr<IR::DenseNodeMap<V>> map) {
+        map->clear();
+        std::lock_guard<std::mutex> guard(lock);
+        if (free.size() < maxFree && memory + map->memoryUsed() <= maxMemory) {
+            memory += map->memoryUsed();
+            free.push_back(std::move(map));
+        }
+    }
+};
+
+}  // namespace
+
 /** @class Visitor::ChangeTracker
  *  @brief Assists visitors in traversing the IR.
 
@@ -64,15 +106,20 @@ class Visitor::ChangeTracker {
         bool visitOnce;
         const IR::Node *result;
     };
-    using visited_t = absl::flat_hash_map<const IR::Node *, visit_info_t, Util::Hash>;
+    using visited_t = IR::DenseNodeMap<visit_info_t>;
     bool forceClone;
-    visited_t visited;
+    std::unique_ptr<visited_t> visited;
+
+    visit_info_t &info(const IR::Node *n) const {
+        auto *info = visited->find(n);
+        if (!info) BUG("visitor state tracker corrupted");
+        return *info;
+    }
 
  public:
     explicit ChangeTracker(bool forceClone)
-        : forceClone(forceClone),
-          visited(16) {}  // Pre-allocate 16 slots as usually these maps are small, but we do create
-                          // lots of them. This saves quite some time for rehashes
+        : forceClone(forceClone), visited(NodeMapPool<visit_info_t>::get().acquire()) {}
+    ~ChangeTracker() { NodeMapPool<visit_info_t>::get().release(std::move(visited)); }
 
     /** Begin tracking @n during a visiting pass.  Use `finish(@n)` to mark @n as
      * visited once the pass completes.
@@ -84,12 +131,12 @@ class Visitor::ChangeTracker {
      */
     [[nodiscard]] VisitStatus try_start(const IR::Node *n, bool defaultVisitOnce) {
         // Initialization
-        auto [it, inserted] = visited.emplace(n, visit_info_t{true, defaultVisitOnce, n});
+        auto [info, inserted] = visited->emplace(n, visit_info_t{true, defaultVisitOnce, n});
 
         if (!inserted) {  // We already seen this node, determine its status
-            if (it->second.visit_in_progress) return VisitStatus::Busy;
-            if (it->second.visitOnce) return VisitStatus::Done;
-            it->second.visit_in_progress = true;
+            if (info->visit_in_progress) return VisitStatus::Busy;
+            if (info->visitOnce) return VisitStatus::Done;
+            info->visit_in_progress = true;
             return VisitStatus::Revisit;
         }
 
@@ -110,19 +157,16 @@ class Visitor::ChangeTracker {
      * previously been invoked.
      */
     bool finish(const IR::Node *orig, const IR::Node *final) {
-        auto it = visited.find(orig);
-        if (it == visited.end()) BUG("visitor state tracker corrupted");
-
-        visit_info_t *orig_visit_info = &(it->second);
+        visit_info_t *orig_visit_info = &info(orig);
         orig_visit_info->visit_in_progress = false;
         if (!final) {
             orig_visit_info->result = final;
             return true;
         } else if (forceClone || (final != orig && *final != *orig)) {
             orig_visit_info->result = final;
-            visited.emplace(final, visit_info_t{false, orig_visit_info->visitOnce, final});
+            visited->emplace(final, visit_info_t{false, orig_visit_info->visitOnce, final});
             return true;
-        } else if (visited.count(final)) {
+        } else if (visited->contains(final)) {
             // coalescing with some previously visited node, so we don't want to undo
             // the coalesce
             orig_visit_info->result = final;
@@ -136,23 +180,12 @@ class Visitor::ChangeTracker {
     }
 
     /** Return a visitOnce flag for node @n */
-    [[nodiscard]] bool shouldVisitOnce(const IR::Node *n) const {
-        auto it = visited.find(n);
-        if (it == visited.end()) BUG("visitor state tracker corrupted");
-        return it->second.visitOnce;
-    }
+    [[nodiscard]] bool shouldVisitOnce(const IR::Node *n) const { return info(n).visitOnce; }
 
     /** Forget nodes that have already been visited, allowing them to be visited
      * again. */
     void revisit_visited() {
-        for (auto it = visited.begin(); it != visited.end();) {
-            if (!it->second.visit_in_progress)
-                // `visited` is abseil map, therefore erase does not return iterator, use
-                // post-increment
-                visited.erase(it++);
-            else
-                ++it;
-        }
+        visited->erase_if([](const visit_info_t &info) { return !info.visit_in_progress; });
     }
 
     /** Determine whether @n is currently being visited and the visitor has not finished
@@ -161,8 +194,8 @@ class Visitor::ChangeTracker {
      * @return true if @n is being visited and has not finished
      */
     [[nodiscard]] bool busy(const IR::Node *n) const {
-        auto it = visited.find(n);
-        return it != visited.end() && it->second.visit_in_progress;
+        const auto *info = visited->find(n);
+        return info && info->visit_in_progress;
     }
 
     /** Determine whether @n has been visited and the visitor has finished
@@ -173,8 +206,8 @@ class Visitor::ChangeTracker {
      * @return true if @n has been visited and the visitor is finished and visitOnce is true
      */
     [[nodiscard]] bool done(const IR::Node *n) const {
-        auto it = visited.find(n);
-        return it != visited.end() && !it->second.visit_in_progress && it->second.visitOnce;
+        const auto *info = visited->find(n);
+        return info && !info->visit_in_progress && info->visitOnce;
     }
 
     /** Produce the result of visiting @n.
@@ -184,9 +217,8 @@ class Visitor::ChangeTracker {
      * if `start(@n)` has not been invoked.
      */
     const IR::Node *result(const IR::Node *n) const {
-        auto it = visited.find(n);
-        if (it == visited.end()) return n;
-        return it->second.result;
+        const auto *info = visited->find(n);
+        return info ? info->result : n;
     }
 
     /** Produce the final result of visiting @n.
@@ -195,22 +227,14 @@ class Visitor::ChangeTracker {
      * been invoked.
      */
     const IR::Node *finalResult(const IR::Node *n) const {
-        auto it = visited.find(n);
-        bool done = it != visited.end() && !it->second.visit_in_progress && it->second.visitOnce;
-        return done ? it->second.result : nullptr;
+        const auto *info = visited->find(n);
+        bool done = info && !info->visit_in_progress && info->visitOnce;
+        return done ? info->result : nullptr;
     }
 
-    void visitOnce(const IR::Node *n) {
-        auto it = visited.find(n);
-        if (it == visited.end()) BUG("visitor state tracker corrupted");
-        it->second.visitOnce = true;
-    }
+    void visitOnce(const IR::Node *n) { info(n).visitOnce = true; }
 
-    void visitAgain(const IR::Node *n) {
-        auto it = visited.find(n);
-        if (it == visited.end()) BUG("visitor state tracker corrupted");
-        it->second.visitOnce = false;
-    }
+    void visitAgain(const IR::Node *n) { info(n).visitOnce = false; }
 };
 
 /** @class Visitor::Tracker
@@ -225,25 +249,23 @@ class Visitor::Tracker {
     struct info_t {
         bool done, visitOnce;
     };
-    using visited_t = absl::flat_hash_map<const IR::Node *, info_t, Util::Hash>;
-    visited_t visited;
+    using visited_t = IR::DenseNodeMap<info_t>;
+    std::unique_ptr<visited_t> visited;
+
+    info_t &info(const IR::Node *n) const {
+        auto *info = visited->find(n);
+        if (!info) BUG("visitor state tracker corrupted");
+        return *info;
+    }
 
  public:
-    Tracker()
-        : visited(16) {}  // Pre-allocate 16 slots as usually these maps are small, but we do create
-                          // lots of them. This saves quite some time for rehashes
+    Tracker() : visited(NodeMapPool<info_t>::get().acquire()) {}
+    ~Tracker() { NodeMapPool<info_t>::get().release(std::move(visited)); }
 
     /** Forget nodes that have already been visited, allowing them to be visited
      * again. */
     void revisit_visited() {
-        for (auto it = visited.begin(); it != visited.end();) {
-            if (it->second.done)
-                // `visited` is abseil map, therefore erase does not return iterator, use
-                // post-increment
-                visited.erase(it++);
-            else
-                ++it;
-        }
+        visited->erase_if([](const info_t &info) { return info.done; });
     }
 
     /** Begin tracking @n during a visiting pass.  Use `finish(@n)` to mark @n as
@@ -257,12 +279,12 @@ class Visitor::Tracker {
      */
     [[nodiscard]] VisitStatus try_start(const IR::Node *n, bool defaultVisitOnce) {
         // Initialization
-        auto [it, inserted] = visited.emplace(n, info_t{false, defaultVisitOnce});
+        auto [info, inserted] = visited->emplace(n, info_t{false, defaultVisitOnce});
 
         if (!inserted) {  // We already seen this node, determine its status
-            if (!it->second.done) return VisitStatus::Busy;
-            if (it->second.visitOnce) return VisitStatus::Done;
-            it->second.done = false;
+            if (!info->done) return VisitStatus::Busy;
+            if (info->visitOnce) return VisitStatus::Done;
+            info->done = false;
             return VisitStatus::Revisit;
         }
 
@@ -280,12 +302,7 @@ class Visitor::Tracker {
      * @exception Util::CompilerBug This method fails if `start(@n)` has not
      * previously been invoked.
      */
-    void finish(const IR::Node *n) {
-        auto it = visited.find(n);
-        if (it == visited.end()) BUG("visitor state tracker corrupted");
-
-        it->second.done = true;
-    }
+    void finish(const IR::Node *n) { info(n).done = true; }
 
     /** Determine whether @n is currently being visited and the visitor has not finished
      * That is, `start(@n)` has been invoked, and `finish(@n)` has not,
@@ -293,8 +310,8 @@ class Visitor::Tracker {
      * @return true if @n is being visited and has not finished
      */
     [[nodiscard]] bool busy(const IR::Node *n) const {
-        auto it = visited.find(n);
-        return it != visited.end() && !it->second.done;
+        const auto *info = visited->find(n);
+        return info && !info->done;
     }
 
     /** Determine whether @n has been visited and the visitor has finished
@@ -305,28 +322,16 @@ class Visitor::Tracker {
      * @return true if @n has been visited and the visitor is finished and visitOnce is true
      */
     [[nodiscard]] bool done(const IR::Node *n) const {
-        auto it = visited.find(n);
-        return it != visited.end() && it->second.done && it->second.visitOnce;
+        const auto *info = visited->find(n);
+        return info && info->done && info->visitOnce;
     }
 
     /** Return a visitOnce flag for node @n */
-    bool shouldVisitOnce(const IR::Node *n) const {
-        auto it = visited.find(n);
-        if (it == visited.end()) BUG("visitor state tracker corrupted");
-        return it->second.visitOnce;
-    }
+    bool shouldVisitOnce(const IR::Node *n) const { return info(n).visitOnce; }
 
-    void visitOnce(const IR::Node *n) {
-        auto it = visited.find(n);
-        if (it == visited.end()) BUG("visitor state tracker corrupted");
-        it->second.visitOnce = true;
-    }
+    void visitOnce(const IR::Node *n) { info(n).visitOnce = true; }
 
-    void visitAgain(const IR::Node *n) {
-        auto it = visited.find(n);
-        if (it == visited.end()) BUG("visitor state tracker corrupted");
-        it->second.visitOnce = false;
-    }
+    void visitAgain(const IR::Node *n) { info(n).visitOnce = false; }
 };
 
 // static
@@ -360,14 +365,43 @@ Visitor::profile_t Visitor::init_apply(const IR::Node *root, const Context *pare
     ctxt = parent_ctxt;
     return rv;
 }
+
+/// Computes IR::Node::kindSummary(), remembering the summary of every node it visits.
+/// Not kept across applies, since nodes may be modified in place between them.
+class Inspector::KindSummaries : public Visitor {
+    Context top;
+    IR::DenseNodeMap<uint64_t> summaries;
+    uint64_t children = 0;  // of the node being summarized
+
+ public:
+    KindSummaries() { ctxt = &top; }
+    uint64_t get(const IR::Node *n) {
+        if (const auto *rv = summaries.find(n)) return *rv;
+        uint64_t saved = children;
+        children = 0;
+        n->visit_children(*this);
+        uint64_t rv = IR::Node::kindBit(n->typeId()) | children;
+        children = saved;
+        summaries.emplace(n, rv);
+        return rv;
+    }
+    const IR::Node *apply_visitor(const IR::Node *n, const char *) override {
+        if (n) children |= get(n);
+        return n;
+    }
+};
+
 Visitor::profile_t Modifier::init_apply(const IR::Node *root) {
     auto rv = Visitor::init_apply(root);
     visited = std::make_shared<ChangeTracker>(forceClone);
     return rv;
 }
 Visitor::profile_t Inspector::init_apply(const IR::Node *root) {
+    BUG_CHECK(!kindFilter || !controlFlowVisitor(), "%1%: a ControlFlowVisitor cannot skip subtrees",
+              name());
     auto rv = Visitor::init_apply(root);
     visited = std::make_shared<Tracker>();
+    if (kindFilter) kindSummaries = std::make_shared<KindSummaries>();
     return rv;
 }
 Visitor::profile_t Transform::init_apply(const IR::Node *root) {
@@ -509,7 +543,7 @@ const IR::Node *Modifier::apply_visitor(const IR::Node *n, const char *name) {
 
 const IR::Node *Inspector::apply_visitor(const IR::Node *n, const char *name) {
     if (ctxt) ctxt->child_name = name;
-    if (n && !join_flows(n)) {
+    if (n && (!kindFilter || (kindSummaries->get(n) & kindFilter)) && !join_flows(n)) {
         PushContext local(ctxt, n);
         switch (visited->try_start(n, visitDagOnce)) {
             case VisitStatus::Busy:
@@ -531,10 +565,28 @@ const IR::Node *Inspector::apply_visitor(const IR::Node *n, const char *name) {
         ctxt->child_index++;
     else {
         visited.reset();
+        kindSummaries.reset();
     }
     return n;
 }
 
+uint64_t IR::Node::kindSummary() const { return Inspector::KindSummaries().get(this); }
+
+uint64_t Inspector::kindMask(RTTI::TypeId typeId) {
+    if (typeId == RTTI::TypeId(IR::NodeKind::VectorBase)) return ~uint64_t(0);
+    uint64_t rv = IR::Node::kindBit(typeId);
+    // Instantiations of Vector and IndexedVector are not listed in the tree macros.
+    if (RTTI::typeidDiscriminator(typeId) == RTTI::TypeId(IR::NodeDiscriminator::VectorT))
+        rv |= IR::Node::kindBit(RTTI::combineTypeIdWithDiscriminator(
+            RTTI::TypeId(IR::NodeDiscriminator::IndexedVectorT), typeId));
+#define KIND_MASK(CLASS)                  \
+    if (IR::CLASS::TypeInfo::isA(typeId)) \
+        rv |= IR::Node::kindBit(IR::CLASS::TypeInfo::id());
+    IRNODE_ALL_NON_TEMPLATE_CLASSES(KIND_MASK)
+#undef KIND_MASK
+    return rv;
+}
+
 const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
     if (ctxt) ctxt->child_name = name;
     if (n) {
@@ -705,7 +757,7 @@ bool ControlFlowVisitor::join_flows(const IR::Node *n) {
     bool delta = true;
     while (delta && status.count >= 0) {
         delta = false;
-        for (auto *sl = split_link; sl; sl = sl->prev) {
+        for (auto *sl = *split_link; sl; sl = sl->prev) {
             if (sl->ready()) {
                 sl->do_visit();  //  visit some parallel stuff;
                 delta = true;
@@ -203,8 +203,23 @@ class Visitor {
     virtual ControlFlowVisitor *controlFlowVisitor() { return nullptr; }
     virtual Visitor &flow_clone() { return *this; }
     // all flow_clones share a split_link chain to allow stack walking
-    SplitFlowVisit_base *split_link_mem = nullptr, *&split_link;
-    Visitor() : split_link(split_link_mem) {}
+    SplitFlowVisit_base *split_link_mem = nullptr, **split_link = &split_link_mem;
+    Visitor() = default;
+    /// Give this visitor a split_link chain of its own rather than sharing the one of the
+    /// visitor it was cloned from.  Needed for clones that run on another thread.
+    void unshare_split_link() {
+        split_link_mem = nullptr;
+        split_link = &split_link_mem;
+    }
+
+    /// Passes that only look at one top-level declaration at a time, carry no state
+    /// from one declaration to the next, and do not depend on init_apply/end_apply or
+    /// pre/postorder of the P4Program itself can return true here.  The PassManager may
+    /// then apply clones of the pass to the declarations of a P4Program concurrently
+    /// (see --jobs).  Such a pass must implement clone().  It must also leave a declaration
+    /// unchanged when applied again to a declaration it already left unchanged: PassRepeated
+    /// relies on that to only revisit the declarations that changed in its last iteration.
+    virtual bool perDeclarationSafe() const { return false; }
 
     /** Merge the given visitor into this visitor at a joint point in the
      * control flow graph.  Should update @this and leave the other unchanged.
@@ -412,7 +427,15 @@ class Modifier : public virtual Visitor {
 
 class Inspector : public virtual Visitor {
     std::shared_ptr<Tracker> visited;
+    /// See visitOnlySubtreesContaining; 0 to visit everything.
+    uint64_t kindFilter = 0;
+    class KindSummaries;
+    std::shared_ptr<KindSummaries> kindSummaries;  // for the current apply, if kindFilter
+    friend class IR::Node;                         // for kindSummary()
     bool check_clone(const Visitor *) override;
+    /// @return the IR::Node::kindBit() of all the node types that are @p typeId or one of
+    /// its subclasses.
+    static uint64_t kindMask(RTTI::TypeId typeId);
 
  public:
     profile_t init_apply(const IR::Node *root) override;
@@ -432,6 +455,17 @@ class Inspector : public virtual Visitor {
     bool visit_in_progress(const IR::Node *n) const;
     void visitOnce() const override;
     void visitAgain() const override;
+
+ protected:
+    /// Makes the inspector skip the subtrees that cannot contain a node of one of the types
+    /// @p T (or of one of their subclasses), using IR::Node::kindSummary().  No visitor
+    /// function (preorder, postorder, revisit...) is called for the nodes of the skipped
+    /// subtrees, so this is for inspectors that only act on these types, e.g. one that
+    /// only looks at method calls.  Cannot be used by a ControlFlowVisitor.
+    template <class... T>
+    void visitOnlySubtreesContaining() {
+        kindFilter = (kindMask(RTTI::TypeInfo<T>::id()) | ...);
+    }
 };
 
 class Transform : public virtual Visitor {
@@ -633,10 +667,10 @@ class SplitFlowVisit_base {
     friend ControlFlowVisitor;
 
     explicit SplitFlowVisit_base(Visitor &v) : v(v) {
-        prev = v.split_link;
-        v.split_link = this;
+        prev = *v.split_link;
+        *v.split_link = this;
     }
-    ~SplitFlowVisit_base() { v.split_link = prev; }
+    ~SplitFlowVisit_base() { *v.split_link = prev; }
     void *operator new(size_t);  // declared and not defined, as this class can
     // only be instantiated on the stack.  Trying to allocate one on the heap will
     // cause a linker error.
@@ -729,7 +763,7 @@ class SplitFlowVisitVector : public SplitFlowVisit_base {
             BUG_CHECK(!paused, "trying to visit paused split_flow_visitor");
             int idx = visit_next++;
             if (vec)
-                result[idx] = visitors.at(idx)->apply_visitor(vec->at(idx));
+                result[idx] = visitors.at(idx)->apply_visitor(std::as_const(*vec).at(idx));
             else
                 visitors.at(idx)->visit(const_vec->at(idx), nullptr, start_index + idx);
         }
@@ -737,21 +771,23 @@ class SplitFlowVisitVector : public SplitFlowVisit_base {
     void run_visit() override {
         SplitFlowVisit_base::run_visit();
         if (vec) {
-            int idx = 0;
-            for (auto i = vec->begin(); i != vec->end(); ++idx) {
-                if (!result[idx] && *i) {
-                    i = vec->erase(i);
-                } else if (result[idx] == *i) {
-                    ++i;
+            // Only write to the vector if an element changed (see IR::Vector::visit_children).
+            size_t pos = 0;
+            for (size_t idx = 0; pos < vec->size(); ++idx) {
+                const N *el = std::as_const(*vec)[pos];
+                if (!result[idx] && el) {
+                    vec->erase(vec->begin() + pos);
+                } else if (result[idx] == el) {
+                    ++pos;
                 } else if (auto l = result[idx]->template to<IR::Vector<N>>()) {
-                    i = vec->erase(i);
-                    i = vec->insert(i, l->begin(), l->end());
-                    i += l->size();
+                    auto i = vec->erase(vec->begin() + pos);
+                    vec->insert(i, l->begin(), l->end());
+                    pos += l->size();
                 } else if (auto v = result[idx]->template to<IR::VectorBase>()) {
                     if (v->empty()) {
-                        i = vec->erase(i);
+                        vec->erase(vec->begin() + pos);
                     } else {
-                        i = vec->insert(i, v->size() - 1, nullptr);
+                        auto i = vec->insert(vec->begin() + pos, v->size() - 1, nullptr);
                         for (auto el : *v) {
                             CHECK_NULL(el);
                             if (auto e = el->template to<N>())
@@ -760,9 +796,10 @@ class SplitFlowVisitVector : public SplitFlowVisit_base {
                                 BUG("visitor returned invalid type %s for Vector<%s>",
                                     el->node_type_name(), N::static_type_name());
                         }
+                        pos += v->size();
                     }
                 } else if (auto e = result[idx]->template to<N>()) {
-                    *i++ = e;
+                    (*vec)[pos++] = e;
                 } else {
                     CHECK_NULL(result[idx]);
                     BUG("visitor returned invalid type %s for Vector<%s>",
@@ -0,0 +1,125 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "lib/arena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#include "lib/log.h"
+#include "lib/n4.h"
+
+namespace P4::Util {
+
+namespace {
+
+/// The chunk a thread is currently bumping through.  The serial number makes a chunk of
+/// an arena that has since been destroyed (and whose address may have been reused)
+/// harmless.
+struct LocalChunk {
+    uint64_t serial = 0;
+    char *next = nullptr;
+    char *end = nullptr;
+};
+
+thread_local LocalChunk localChunk;
+
+std::atomic<uint64_t> nextSerial = 1;
+
+}  // namespace
+
+std::atomic<Arena *> Arena::currentArena = nullptr;
+thread_local unsigned Arena::suspended = 0;
+
+Arena::Arena() : serial(nextSerial.fetch_add(1, std::memory_order_relaxed)) {}
+
+Arena::~Arena() {
+    auto start = std::chrono::steady_clock::now();
+    for (auto *c = cleanups.load(std::memory_order_acquire); c; c = c->next)
+        if (c->fn) c->fn(c->obj);
+    auto stats = this->stats();
+    for (auto &chunk : chunks) std::free(chunk.first);
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    LOG1("arena released: " << stats.chunks << " chunks, " << n4(stats.reserved) << "B, "
+                            << stats.cleanups << " cleanups in " << usec << "us");
+}
+
+void *Arena::allocate(size_t size) {
+    size = std::max(alignment, (size + alignment - 1) & ~(alignment - 1));
+    auto &local = localChunk;
+    if (local.serial == serial && size_t(local.end - local.next) >= size) {
+        auto *rv = local.next;
+        local.next += size;
+        return rv;
+    }
+    return allocateSlow(size);
+}
+
+char *Arena::allocateSlow(size_t size) {
+    // Big objects get a chunk of their own, so they do not waste the rest of the
+    // thread's current chunk.
+    bool dedicated = size > chunkSize / 4;
+    size_t bytes = dedicated ? size : chunkSize;
+    auto *chunk = static_cast<char *>(std::malloc(bytes));
+    if (!chunk) throw std::bad_alloc();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto pos = std::upper_bound(chunks.begin(), chunks.end(), std::make_pair(chunk, bytes));
+        chunks.insert(pos, {chunk, bytes});
+        reserved += bytes;
+    }
+    if (!dedicated) localChunk = {serial, chunk + size, chunk + bytes};
+    return chunk;
+}
+
+Arena::Cleanup *Arena::atRelease(void (*fn)(void *), void *obj) {
+    auto *rv = new (allocate(sizeof(Cleanup))) Cleanup{fn, obj, nullptr};
+    atRelease(rv);
+    return rv;
+}
+
+void Arena::atRelease(Cleanup *cleanup) {
+    cleanup->next = cleanups.load(std::memory_order_relaxed);
+    while (!cleanups.compare_exchange_weak(cleanup->next, cleanup, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    cleanupCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Arena::contains(const void *p) const {
+    const char *addr = static_cast<const char *>(p);
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), addr,
+                               [](const char *a, const std::pair<char *, size_t> &chunk) {
+                                   return a < chunk.first;
+                               });
+    if (it == chunks.begin()) return false;
+    --it;
+    return addr < it->first + it->second;
+}
+
+Arena::Stats Arena::stats() const {
+    Stats rv;
+    std::lock_guard<std::mutex> guard(lock);
+    rv.chunks = chunks.size();
+    rv.reserved = reserved;
+    rv.cleanups = cleanupCount.load(std::memory_order_relaxed);
+    return rv;
+}
+
+}  // namespace P4::Util
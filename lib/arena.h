@@ -0,0 +1,115 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_ARENA_H_
+#define LIB_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace P4::Util {
+
+/// A bump-pointer region for objects that all die together, such as the IR nodes of a
+/// single compilation.  Memory is handed out from large chunks and is only returned when
+/// the arena itself is destroyed; objects that own other memory can ask to be cleaned up
+/// at that point with atRelease.
+///
+/// Allocation is safe from several threads at once: every thread bumps through a chunk
+/// of its own and only takes a lock to get a new one.
+class Arena {
+ public:
+    /// A function to run on an object when the arena is released.  Setting fn to
+    /// nullptr cancels it, e.g. when the object was destroyed early.
+    struct Cleanup {
+        void (*fn)(void *);
+        void *obj;
+        Cleanup *next;
+    };
+
+    struct Stats {
+        size_t chunks = 0;    // number of chunks obtained from the system
+        size_t reserved = 0;  // total size of those chunks
+        size_t cleanups = 0;  // number of registered cleanups
+    };
+
+    static constexpr size_t alignment = alignof(std::max_align_t);
+    static constexpr size_t chunkSize = size_t(1) << 20;
+
+    Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    /// Runs the registered cleanups, newest first, then frees all memory at once.
+    ~Arena();
+
+    /// @return @p size bytes aligned to `alignment`.  Never returns nullptr.
+    void *allocate(size_t size);
+    /// Arrange for fn(obj) to be called when the arena is released.  The record itself
+    /// lives in the arena.
+    Cleanup *atRelease(void (*fn)(void *), void *obj);
+    /// Same, with a record provided by the caller, which must stay valid until the arena
+    /// is released (typically because it was allocated from the arena).
+    void atRelease(Cleanup *cleanup);
+    /// @return true if @p p points into memory handed out by this arena.  Takes a lock;
+    /// meant for rare paths such as operator delete.
+    bool contains(const void *p) const;
+    Stats stats() const;
+
+    /// @return the arena new objects should go to on this thread, or nullptr if there is
+    /// none (or it is suspended on this thread).
+    static Arena *current() {
+        return suspended ? nullptr : currentArena.load(std::memory_order_acquire);
+    }
+
+    /// Makes an arena current for all threads for the lifetime of the scope.
+    class Scope {
+        Arena *prev;
+
+     public:
+        explicit Scope(Arena &arena) : prev(currentArena.exchange(&arena)) {}
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope() { currentArena.store(prev); }
+    };
+
+    /// Stops using the current arena on this thread for the lifetime of the scope, for
+    /// objects that are cached across compilations.
+    class Suspend {
+     public:
+        Suspend() { ++suspended; }
+        Suspend(const Suspend &) = delete;
+        Suspend &operator=(const Suspend &) = delete;
+        ~Suspend() { --suspended; }
+    };
+
+ private:
+    char *allocateSlow(size_t size);
+
+    static std::atomic<Arena *> currentArena;
+    static thread_local unsigned suspended;
+
+    const uint64_t serial;  // identifies this arena in the per-thread chunk cache
+    mutable std::mutex lock;
+    std::vector<std::pair<char *, size_t>> chunks;  // sorted by address
+    size_t reserved = 0;
+    std::atomic<Cleanup *> cleanups = nullptr;
+    std::atomic<size_t> cleanupCount = 0;
+};
+
+}  // namespace P4::Util
+
+#endif /* LIB_ARENA_H_ */
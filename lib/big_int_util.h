@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef LIB_BIG_INT_UTIL_H_
 #define LIB_BIG_INT_UTIL_H_
 
+#include <cstdint>
+#include <optional>
+
 #include <boost/version.hpp>
 
 #if BOOST_VERSION < 106700
@@ -69,6 +72,21 @@ inline unsigned scan1(const boost::multiprecision::cpp_int &val, unsigned pos) {
     return scan1_positive(val, pos);
 }
 
+/// @returns @p value if it fits in an int64_t.  cpp_int keeps such values in a single
+/// inline limb, so this only inspects the representation; it is much cheaper than
+/// comparing against the int64_t limits, and lets callers use machine arithmetic.
+inline std::optional<int64_t> toInt64(const big_int &value) {
+    const auto &backend = value.backend();
+    if (backend.size() != 1) return std::nullopt;
+    uint64_t magnitude = *backend.limbs();
+    if (backend.sign()) {
+        if (magnitude > uint64_t(INT64_MAX) + 1) return std::nullopt;
+        return static_cast<int64_t>(0 - magnitude);
+    }
+    if (magnitude > uint64_t(INT64_MAX)) return std::nullopt;
+    return static_cast<int64_t>(magnitude);
+}
+
 }  // namespace P4::Util
 
 namespace P4 {
@@ -0,0 +1,94 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_COW_PTR_H_
+#define LIB_COW_PTR_H_
+
+#include <atomic>
+#include <utility>
+
+namespace P4 {
+
+/// Holds a value of type T that is shared by the copies of the cow_ptr, and only copied
+/// when one of them modifies it (copy on write).  A cow_ptr that holds no value reads as
+/// a default-constructed T, and allocates nothing until it is written to.
+///
+/// The value is reference counted.  When the owners are garbage collected without being
+/// destroyed the count stays too high, and the remaining owner makes one copy too many.
+template <class T>
+class cow_ptr {
+    struct Block {
+        T value;
+        std::atomic<unsigned> refs = 1;
+
+        Block() = default;
+        explicit Block(const T &value) : value(value) {}
+    };
+    Block *block = nullptr;
+
+    void acquire() const {
+        if (block) block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    void release() {
+        if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete block;
+        block = nullptr;
+    }
+
+ public:
+    cow_ptr() = default;
+    cow_ptr(const cow_ptr &other) : block(other.block) { acquire(); }
+    cow_ptr(cow_ptr &&other) noexcept : block(std::exchange(other.block, nullptr)) {}
+    explicit cow_ptr(T value) : block(new Block) { block->value = std::move(value); }
+    cow_ptr &operator=(const cow_ptr &other) {
+        other.acquire();
+        release();
+        block = other.block;
+        return *this;
+    }
+    cow_ptr &operator=(cow_ptr &&other) noexcept {
+        if (this != &other) {
+            release();
+            block = std::exchange(other.block, nullptr);
+        }
+        return *this;
+    }
+    ~cow_ptr() { release(); }
+
+    /// The value, for reading.
+    const T &get() const {
+        static const T empty{};
+        return block ? block->value : empty;
+    }
+    const T &operator*() const { return get(); }
+    const T *operator->() const { return &get(); }
+
+    /// The value, for writing: copies it first if it is shared.
+    T &mutate() {
+        if (!block) {
+            block = new Block;
+        } else if (block->refs.load(std::memory_order_acquire) != 1) {
+            auto *copy = new Block(block->value);
+            release();
+            block = copy;
+        }
+        return block->value;
+    }
+
+    /// True if both hold the same value, without comparing it.
+    bool shares(const cow_ptr &other) const { return block == other.block; }
+};
+
+}  // namespace P4
+
+#endif /* LIB_COW_PTR_H_ */
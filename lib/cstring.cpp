@@ -16,7 +16,6 @@ limitations under the License.
 
 #include "cstring.h"
 
-#include "absl/container/node_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_replace.h"
 
@@ -28,16 +27,17 @@ limitations under the License.
 #endif /* HAVE_LIBGC */
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstddef>
 #include <cstring>
 #include <functional>
 #include <iomanip>
 #include <ios>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <string_view>
-#include <unordered_set>
 
 #include "hash.h"
 
@@ -58,7 +58,8 @@ inline table_entry_flags operator|(table_entry_flags l, table_entry_flags r) {
     return static_cast<table_entry_flags>(static_cast<int>(l) | static_cast<int>(r));
 }
 
-// cache entry, ordered by string length
+// cache entry; entries are allocated once and never move or die, so the address of an
+// in-place string is stable
 class table_entry {
     std::size_t m_length = 0;
     table_entry_flags m_flags = table_entry_flags::none;
@@ -86,8 +87,8 @@ class table_entry {
         if (length < sizeof(const char *)) {
             // String with length less than size of pointer store directly
             // in pointer, that hint allows reduce stack fragmentation.
-            // We can make such optimization because std::unordered_set never
-            // moves objects in memory on new element insert
+            // We can make such optimization because entries never
+            // move in memory once they are in the cache
             std::memcpy(m_inplace_string, string, length);
             m_inplace_string[length] = '\0';
             m_flags = table_entry_flags::inplace;
@@ -152,48 +153,124 @@ class table_entry {
     }
 };
 
-// We'd make Util::Hash to be transparent instead. However, this would enable
-// transparent hashing globally and in some cases in very undesired manner. So
-// for now aim for more fine-grained approach.
-struct TableEntryHash {
-    using is_transparent = void;
+/// One shard of the intern table: an insert-only open addressing hash table.
+///
+/// Lookups take no lock: a slot, once filled, never changes, and a full table is
+/// replaced by a bigger copy that is published atomically.  A reader that misses in
+/// a stale table just falls through to the insertion path, which takes the shard lock
+/// and looks again in the current table before adding the string.  Replaced tables
+/// are not freed explicitly, as a concurrent reader might still be probing them; with
+/// libgc they are collected once no thread refers to them.
+class cache_shard {
+    struct slot {
+        std::atomic<std::size_t> hash;
+        std::atomic<const table_entry *> entry;
+    };
+    struct table {
+        std::size_t mask;
+        slot *slots;
+    };
+
+    std::atomic<table *> m_table;
+    std::atomic<std::size_t> m_count = 0;
+    std::mutex m_lock;  // serializes insertion and growth
 
-    // IMPORTANT: These two hashes MUST match in order for heterogenous
-    // lookup to work properly
-    size_t operator()(const table_entry &entry) const {
-        return Util::hash(entry.string(), entry.length());
+    static table *make_table(std::size_t size) {
+        // value-initialization zeroes the atomics
+        return new table{size - 1, new slot[size]()};
+    }
+
+    static const table_entry *find(const table *t, std::size_t hash, std::string_view s) {
+        for (std::size_t i = hash & t->mask;; i = (i + 1) & t->mask) {
+            const auto *entry = t->slots[i].entry.load(std::memory_order_acquire);
+            if (entry == nullptr) return nullptr;
+            if (t->slots[i].hash.load(std::memory_order_relaxed) == hash && *entry == s)
+                return entry;
+        }
     }
 
-    size_t operator()(std::string_view entry) const {
-        return Util::hash(entry.data(), entry.length());
+    static void place(table *t, std::size_t hash, const table_entry *entry) {
+        std::size_t i = hash & t->mask;
+        while (t->slots[i].entry.load(std::memory_order_relaxed) != nullptr) i = (i + 1) & t->mask;
+        t->slots[i].hash.store(hash, std::memory_order_relaxed);
+        t->slots[i].entry.store(entry, std::memory_order_release);
+    }
+
+ public:
+    cache_shard() : m_table(make_table(64)) {}
+
+    const table_entry *lookup(std::size_t hash, std::string_view s) const {
+        return find(m_table.load(std::memory_order_acquire), hash, s);
+    }
+
+    const char *intern(std::size_t hash, const char *string, std::size_t length,
+                       table_entry_flags flags) {
+        std::string_view s(string, length);
+        if (const auto *entry = lookup(hash, s)) return entry->string();
+
+        std::lock_guard<std::mutex> guard(m_lock);
+        auto *t = m_table.load(std::memory_order_relaxed);
+        if (const auto *entry = find(t, hash, s)) return entry->string();
+
+        // Keep the load factor at or below 1/2 so probe sequences stay short.
+        std::size_t count = m_count.load(std::memory_order_relaxed) + 1;
+        if (count * 2 > t->mask + 1) {
+            auto *bigger = make_table((t->mask + 1) * 2);
+            for (std::size_t i = 0; i <= t->mask; ++i)
+                if (const auto *entry = t->slots[i].entry.load(std::memory_order_relaxed))
+                    place(bigger, t->slots[i].hash.load(std::memory_order_relaxed), entry);
+            m_table.store(bigger, std::memory_order_release);
+            t = bigger;
+        }
+        const auto *entry = new table_entry(string, length, flags);
+        place(t, hash, entry);
+        m_count.store(count, std::memory_order_relaxed);
+        return entry->string();
+    }
+
+    /// Approximate statistics; takes no lock, so it is safe to call from a GC callback.
+    std::size_t size(std::size_t &count) const {
+        const auto *t = m_table.load(std::memory_order_acquire);
+        std::size_t rv = (t->mask + 1) * sizeof(slot);
+        count = 0;
+        for (std::size_t i = 0; i <= t->mask; ++i) {
+            if (const auto *entry = t->slots[i].entry.load(std::memory_order_acquire)) {
+                rv += sizeof(*entry) + entry->length();
+                ++count;
+            }
+        }
+        return rv;
     }
 };
 
-auto &cache() {
-    // We need node_hash_set due to SSO: we return address of embedded string
-    // that should be stable
-    static absl::node_hash_set<table_entry, TableEntryHash, std::equal_to<>> g_cache;
+/// Strings are spread over the shards by the top bits of their hash (the low bits pick
+/// the slot within a shard), so concurrent insertions rarely contend for the same lock.
+constexpr std::size_t shard_bits = 6;
 
-    return g_cache;
+cache_shard &shard_for(std::size_t hash) {
+    static cache_shard g_shards[1 << shard_bits];
+    return g_shards[hash >> (sizeof(std::size_t) * 8 - shard_bits)];
 }
 
+std::size_t hash_of(const char *string, std::size_t length) { return Util::hash(string, length); }
+
 const char *save_to_cache(const char *string, std::size_t length, table_entry_flags flags) {
-    // Checks if string is already cached and if not, calls ctor to construct in
-    // place.  As a result, only a single lookup is performed regardless whether
-    // entry is in cache or not.
-    return cache()
-        .lazy_emplace(table_entry(string, length, table_entry_flags::no_need_copy),
-                      [string, length, flags](const auto &ctor) { ctor(string, length, flags); })
-        ->string();
+    auto hash = hash_of(string, length);
+    return shard_for(hash).intern(hash, string, length, flags);
+}
+
+const table_entry *find_in_cache(std::string_view s) {
+    auto hash = hash_of(s.data(), s.size());
+    return shard_for(hash).lookup(hash, s);
 }
 
 }  // namespace
 
-bool cstring::is_cached(std::string_view s) { return cache().contains(s); }
+bool cstring::is_cached(std::string_view s) { return find_in_cache(s) != nullptr; }
 
 cstring cstring::get_cached(std::string_view s) {
-    auto entry = cache().find(s);
-    if (entry == cache().end()) return nullptr;
+    const auto *entry = find_in_cache(s);
+    if (entry == nullptr) return nullptr;
 
     cstring res;
     res.str = entry->string();
@@ -216,8 +293,12 @@ void cstring::construct_from_literal(const char *string, std::size_t length) {
 
 size_t cstring::cache_size(size_t &count) {
     size_t rv = 0;
-    count = cache().size();
-    for (auto &s : cache()) rv += sizeof(s) + s.length();
+    count = 0;
+    for (size_t i = 0; i < (size_t(1) << shard_bits); ++i) {
+        size_t shard_count;
+        rv += shard_for(i << (sizeof(size_t) * 8 - shard_bits)).size(shard_count);
+        count += shard_count;
+    }
     return rv;
 }
 
@@ -54,8 +54,9 @@ limitations under the License.
  *     std::string.
  *   - Interned strings can never be freed, so they'll stick around for the
  *     lifetime of the program.
- *   - The string interning cstring performs is currently not threadsafe, so you
- *     can't safely use cstrings off the main thread.
+ *   - Interning goes through a table shared by all threads.  Looking up a
+ *     string that is already interned takes no lock, but adding a new one
+ *     locks one of the table's shards.
  *
  * Given these tradeoffs, the general rule of thumb to follow is that you should
  * try to convert strings to cstrings early and keep them in that form. That
@@ -0,0 +1,95 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_DATAFLOW_H_
+#define LIB_DATAFLOW_H_
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/bitvec.h"
+
+namespace P4 {
+
+/// The lattice operation DataflowWorklist needs from a state type: join(a, b) merges b
+/// into a and returns true if that changed a.  The default uses operator|=, which for
+/// a bitvec is set union and returns whether any bit was added.
+template <class State>
+struct DataflowLattice {
+    static bool join(State &a, const State &b) { return a |= b; }
+};
+
+/// The transfer function of a bit-vector (gen/kill) dataflow problem such as reaching
+/// definitions: out = gen | (in - kill)
+struct GenKill {
+    bitvec gen, kill;
+    bitvec operator()(const bitvec &in) const { return gen | (in - kill); }
+};
+
+/// Solves a forward dataflow problem over the basic blocks (or other nodes) of a control
+/// flow graph with a worklist.  The graph need not be built up front: the transfer
+/// function finds the successors of a node as it runs, and calls propagate() for each.
+///
+/// The entry state of each node is stored densely, indexed by the order in which the
+/// nodes were first reached.  Queued nodes are processed in that order, so most nodes
+/// are processed after their predecessors, and a loop is processed again only while
+/// the state flowing around it still changes.
+template <class Node, class State, class Lattice = DataflowLattice<State>>
+class DataflowWorklist {
+    std::unordered_map<Node, unsigned> index;
+    std::vector<Node> nodes;
+    std::vector<State> entry;
+    std::set<unsigned> queued;
+
+ public:
+    /// Join @p state into the entry state of @p n, and queue @p n if that changed it or
+    /// if @p n had not been reached before.
+    /// @returns true if @p n was queued
+    bool propagate(Node n, const State &state) {
+        auto [it, added] = index.emplace(n, nodes.size());
+        if (added) {
+            nodes.push_back(n);
+            entry.push_back(state);
+        } else if (!Lattice::join(entry[it->second], state)) {
+            return false;
+        }
+        queued.insert(it->second);
+        return true;
+    }
+
+    /// Process queued nodes until there are none left, calling transfer(node, state)
+    /// with a copy of the node's entry state.
+    template <class Transfer>
+    void run(Transfer transfer) {
+        while (!queued.empty()) {
+            unsigned i = *queued.begin();
+            queued.erase(queued.begin());
+            State state(entry[i]);
+            transfer(nodes[i], state);
+        }
+    }
+
+    /// The entry state of @p n, or nullptr if it has not been reached.
+    const State *entryState(Node n) const {
+        auto it = index.find(n);
+        return it == index.end() ? nullptr : &entry[it->second];
+    }
+    /// The number of nodes reached so far.
+    size_t size() const { return nodes.size(); }
+};
+
+}  // namespace P4
+
+#endif /* LIB_DATAFLOW_H_ */
@@ -18,6 +18,7 @@ limitations under the License.
 #define LIB_ERROR_REPORTER_H_
 
 #include <iostream>
+#include <mutex>
 #include <ostream>
 #include <set>
 #include <type_traits>
@@ -55,6 +56,10 @@ class ErrorReporter {
 
     std::ostream *outputstream;
 
+    /// Serializes diagnostics coming from PassManager worker threads.  Recursive, as the
+    /// diagnose overloads call each other.
+    static inline std::recursive_mutex diagnoseLock;
+
     /// Track errors or warnings that have already been issued for a particular source location
     std::set<std::pair<int, const Util::SourceInfo>> errorTracker;
 
@@ -113,6 +118,7 @@ class ErrorReporter {
     template <class T, typename = decltype(std::declval<T>()->getSourceInfo()), typename... Args>
     void diagnose(DiagnosticAction action, const int errorCode, const char *format,
                   const char *suffix, T node, Args &&...args) {
+        std::lock_guard<std::recursive_mutex> guard(diagnoseLock);
         if (!node || error_reported(errorCode, node->getSourceInfo())) return;
 
         if (cstring name = get_error_name(errorCode))
@@ -138,6 +144,7 @@ class ErrorReporter {
     void diagnose(DiagnosticAction action, const char *diagnosticName, const char *format,
                   const char *suffix, Args &&...args) {
         if (action == DiagnosticAction::Ignore) return;
+        std::lock_guard<std::recursive_mutex> guard(diagnoseLock);
 
         ErrorMessage::MessageType msgType = ErrorMessage::MessageType::None;
         if (action == DiagnosticAction::Info) {
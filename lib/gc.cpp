@@ -29,6 +29,9 @@ limitations under the License.
 #endif
 
 #if HAVE_LIBGC
+#if HAVE_GC_THREADS
+#define GC_THREADS 1
+#endif /* HAVE_GC_THREADS */
 #include <gc/gc.h>
 #include <gc/gc_cpp.h>
 #include <gc/gc_mark.h>
@@ -40,6 +43,7 @@ limitations under the License.
 #include <new>
 
 #include "absl/debugging/stacktrace.h"
+#include "arena.h"
 #include "backtrace_exception.h"
 #include "cstring.h"
 #include "log.h"
@@ -57,6 +61,15 @@ static bool done_init, started_init;
 static char emergency_pool[16 * 1024];
 static char *emergency_ptr;
 
+// Once other threads may run, the C library keeps malloc'd memory (thread descriptors,
+// TLS blocks) where the collector does not look for pointers, so from then on malloc
+// hands out uncollectable memory; free still releases it explicitly.
+static bool threads_allowed = false;
+
+static void *gc_malloc(size_t size) {
+    return threads_allowed ? GC_malloc_uncollectable(size) : GC_malloc(size);
+}
+
 static alloc_trace_cb_t trace_cb;
 static bool tracing = false;
 #define TRACE_ALLOC(size)                                  \
@@ -243,12 +256,12 @@ void *realloc(void *ptr, size_t size) {
     if (ptr) {
         if (GC_is_heap_ptr(ptr)) return GC_realloc(ptr, size);
         size_t max = raw_size(ptr);
-        void *rv = GC_malloc(size);
+        void *rv = gc_malloc(size);
         memcpy(rv, ptr, max < size ? max : size);
         raw_free(ptr);
         return rv;
     } else {
-        return GC_malloc(size);
+        return gc_malloc(size);
     }
 }
 // IMPORTANT: do not simplify this to realloc(nullptr, size)
@@ -258,7 +271,7 @@ void *malloc(size_t size) {
     if (!done_init) return realloc(nullptr, size);
 
     TRACE_ALLOC(size)
-    return GC_malloc(size);
+    return gc_malloc(size);
 }
 void free(void *ptr) {
     if (done_init && GC_is_heap_ptr(ptr)) GC_free(ptr);
@@ -328,8 +341,69 @@ size_t gc_mem_inuse(size_t *max) {
     GC_get_heap_usage_safe(&heapsize, &heapfree, 0, 0, 0);
     if (max) *max = heapsize;
     return heapsize - heapfree;
+#elif HAVE_IR_ARENA
+    // Nothing is collected; report what the IR of the current compilation occupies.
+    auto *arena = Util::Arena::current();
+    size_t inuse = arena ? arena->stats().reserved : 0;
+    if (max) *max = inuse;
+    return inuse;
 #else
     if (max) *max = 0;
     return 0;
 #endif
 }
+
+gc_stats_t gc_stats() {
+    gc_stats_t rv;
+#if HAVE_LIBGC
+    rv.bytes_allocated = GC_get_total_bytes();
+    rv.collections = GC_get_gc_no();
+#if (GC_VERSION_MAJOR == 8 && GC_VERSION_MINOR >= 2) || GC_VERSION_MAJOR > 8
+    // Collections are only timed from the first call on.
+    static bool measuring = (GC_start_performance_measurement(), true);
+    (void)measuring;
+    rv.collection_ms = GC_get_full_gc_total_time();
+#endif
+#elif HAVE_IR_ARENA
+    if (auto *arena = Util::Arena::current()) rv.bytes_allocated = arena->stats().reserved;
+#endif
+    return rv;
+}
+
+bool gc_allow_threads() {
+#if HAVE_LIBGC
+#if HAVE_GC_THREADS
+    if (!threads_allowed) {
+        maybe_initialize_gc();
+        GC_allow_register_threads();
+        threads_allowed = true;
+    }
+    return true;
+#else
+    return false;
+#endif /* HAVE_GC_THREADS */
+#else
+    return true;
+#endif /* HAVE_LIBGC */
+}
+
+#if HAVE_LIBGC && HAVE_GC_THREADS
+// libgc wraps pthread_create, so threads it started are registered already and are
+// unregistered by its own exit handler; only undo the registrations made here.
+static thread_local bool registered_here = false;
+#endif
+
+void gc_register_thread() {
+#if HAVE_LIBGC && HAVE_GC_THREADS
+    struct GC_stack_base sb;
+    if (GC_get_stack_base(&sb) == GC_SUCCESS)
+        registered_here = GC_register_my_thread(&sb) == GC_SUCCESS;
+#endif
+}
+
+void gc_unregister_thread() {
+#if HAVE_LIBGC && HAVE_GC_THREADS
+    if (registered_here) GC_unregister_my_thread();
+    registered_here = false;
+#endif
+}
@@ -24,6 +24,23 @@ limitations under the License.
 void setup_gc_logging();
 size_t gc_mem_inuse(size_t *max = 0);  // trigger GC, return inuse after
 
+/// Running totals of the collector's work, for profiling.  Without garbage collection,
+/// bytes_allocated is what the current IR arena (if any) has reserved, and the rest is 0.
+struct gc_stats_t {
+    size_t bytes_allocated = 0;  // since the start of the program
+    size_t collections = 0;
+    size_t collection_ms = 0;  // spent in full collections, if the collector measures it
+};
+gc_stats_t gc_stats();
+
+/// Threads other than the main one must be known to the collector before they allocate
+/// or hold pointers to GC memory.  gc_allow_threads must be called on the main thread
+/// before any other thread registers; it returns false if the collector was built
+/// without thread support, in which case no other thread may touch GC memory at all.
+bool gc_allow_threads();
+void gc_register_thread();
+void gc_unregister_thread();
+
 struct alloc_trace_cb_t {
     void (*fn)(void *arg, void **pc, size_t sz);
     void *arg;
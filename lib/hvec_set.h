@@ -18,6 +18,7 @@ limitations under the License.
 #define LIB_HVEC_SET_H_
 
 #include <initializer_list>
+#include <iterator>
 #include <tuple>
 #include <vector>
 
@@ -33,7 +34,9 @@ class hvec_set : hash_vector_base {
     PRED eql;
 
  public:
+    typedef KEY key_type;
     typedef const KEY value_type;
+    typedef size_t size_type;
     typedef HASH hasher;
     typedef PRED key_equal;
     typedef ALLOC allocator_type;
@@ -131,12 +134,20 @@ class hvec_set : hash_vector_base {
  public:
     typedef _iter<hvec_set, value_type> iterator;
     typedef _iter<const hvec_set, const value_type> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
     iterator begin() { return iterator(*this, erased.ffz()); }
     iterator end() { return iterator(*this, data.size()); }
     const_iterator begin() const { return const_iterator(*this, erased.ffz()); }
     const_iterator end() const { return const_iterator(*this, data.size()); }
     const_iterator cbegin() const { return const_iterator(*this, erased.ffz()); }
     const_iterator cend() const { return const_iterator(*this, data.size()); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+    const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
     value_type &front() const { return *begin(); }
     value_type &back() const {
         auto it = end();
@@ -102,7 +102,7 @@ class Options {
     virtual std::vector<const char *> *process(int argc, char *const argv[]);
 
     [[nodiscard]] virtual const char *getIncludePath() const = 0;
-    cstring getCompileCommand() { return compileCommand; }
+    cstring getCompileCommand() const { return compileCommand; }
     cstring getBuildDate() { return buildDate; }
     cstring getBinaryName() { return cstring(binaryName); }
     virtual void usage();
@@ -16,13 +16,23 @@ limitations under the License.
 
 #include "source_file.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
 #include <sstream>
 
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
+#include "lib/bitops.h"
 #include "lib/exceptions.h"
 #include "lib/log.h"
 #include "lib/stringify.h"
@@ -48,29 +58,197 @@ cstring SourcePosition::toString() const {
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
-SourceInfo::SourceInfo(const InputSources *sources, SourcePosition start, SourcePosition end)
-    : sources(sources), start(start), end(end) {
+struct SourceInfo::Range {
+    const InputSources *sources = nullptr;
+    SourcePosition start;
+    SourcePosition end;
+};
+
+struct SourceInfo::Dumped {
+    cstring filename = ""_cs;
+    int line = -1;
+    int column = -1;
+    cstring srcBrief = ""_cs;
+};
+
+namespace {
+
+/// The entries SourceInfo handles refer to.  Entries are only ever appended, possibly by
+/// several threads at once, and never move: the table is made of chunks of doubling size,
+/// which are allocated when the first of their entries is added.
+template <typename Entry>
+class SourceInfoTable {
+    static constexpr unsigned firstChunkBits = 10;
+    static constexpr unsigned chunks = 32 - firstChunkBits;
+
+    std::atomic<uint32_t> count{1};  // 0 is the handle of invalid SourceInfos
+    std::atomic<Entry *> chunk[chunks] = {};
+    std::mutex chunkLock;
+
+    static std::pair<unsigned, uint32_t> locate(uint32_t index) {
+        uint32_t biased = index + (uint32_t(1) << firstChunkBits);
+        unsigned chunkIndex = floor_log2(biased) - firstChunkBits;
+        return {chunkIndex, biased - (uint32_t(1) << (chunkIndex + firstChunkBits))};
+    }
+
+ public:
+    uint32_t add(const Entry &entry, uint32_t limit) {
+        uint32_t index = count.fetch_add(1, std::memory_order_relaxed);
+        BUG_CHECK(index < limit, "Too many source positions");
+        auto [chunkIndex, offset] = locate(index);
+        Entry *entries = chunk[chunkIndex].load(std::memory_order_acquire);
+        if (entries == nullptr) {
+            std::lock_guard<std::mutex> guard(chunkLock);
+            entries = chunk[chunkIndex].load(std::memory_order_relaxed);
+            if (entries == nullptr) {
+                entries = new Entry[size_t(1) << (chunkIndex + firstChunkBits)];
+                chunk[chunkIndex].store(entries, std::memory_order_release);
+            }
+        }
+        entries[offset] = entry;
+        return index;
+    }
+
+    const Entry &get(uint32_t index) const {
+        auto [chunkIndex, offset] = locate(index);
+        return chunk[chunkIndex].load(std::memory_order_acquire)[offset];
+    }
+};
+
+}  // namespace
+
+// Allocated on the heap, so that the tables outlive the SourceInfos in static objects.
+static SourceInfoTable<SourceInfo::Range> &ranges() {
+    static auto *table = new SourceInfoTable<SourceInfo::Range>;
+    return *table;
+}
+
+static SourceInfoTable<SourceInfo::Dumped> &dumped() {
+    static auto *table = new SourceInfoTable<SourceInfo::Dumped>;
+    return *table;
+}
+
+SourceInfo::SourceInfo(cstring filename, int line, int column, cstring srcBrief)
+    : handle(dumped().add({filename, line, column, srcBrief}, dumpedBit) | dumpedBit) {}
+
+SourceInfo::SourceInfo(const InputSources *sources, SourcePosition point) {
+    if (point.isValid()) handle = ranges().add({sources, point, point}, dumpedBit);
+}
+
+SourceInfo::SourceInfo(const InputSources *sources, SourcePosition start, SourcePosition end) {
     BUG_CHECK(sources != nullptr, "Invalid InputSources in SourceInfo");
     if (!start.isValid() || !end.isValid())
         BUG("Invalid source position in SourceInfo %1%-%2%", start.toString(), end.toString());
     if (start > end)
         BUG("SourceInfo position start %1% after end %2%", start.toString(), end.toString());
+    handle = ranges().add({sources, start, end}, dumpedBit);
+}
+
+const SourceInfo::Range &SourceInfo::range() const {
+    static const Range invalid;
+    if (!isValid()) return invalid;
+    return ranges().get(handle);
+}
+
+const InputSources *SourceInfo::sources() const { return range().sources; }
+
+const SourcePosition &SourceInfo::getStart() const { return range().start; }
+
+const SourcePosition &SourceInfo::getEnd() const { return range().end; }
+
+SourceInfo SourceInfo::operator+(const SourceInfo &rhs) const {
+    if (!isValid()) return rhs;
+    if (!rhs.isValid() || handle == rhs.handle) return *this;
+    const Range &left = range();
+    const Range &right = rhs.range();
+    SourcePosition s = left.start.min(right.start);
+    SourcePosition e = left.end.max(right.end);
+    // The parser extends ranges by each of their parts: avoid adding an entry if one of
+    // the operands already spans the other.
+    if (s == left.start && e == left.end) return *this;
+    if (s == right.start && e == right.end && left.sources == right.sources) return rhs;
+    return SourceInfo(left.sources, s, e);
+}
+
+cstring SourceInfo::filename() const {
+    if (handle & dumpedBit) return dumped().get(handle & ~dumpedBit).filename;
+    return ""_cs;
+}
+
+int SourceInfo::line() const {
+    if (handle & dumpedBit) return dumped().get(handle & ~dumpedBit).line;
+    return -1;
+}
+
+int SourceInfo::column() const {
+    if (handle & dumpedBit) return dumped().get(handle & ~dumpedBit).column;
+    return -1;
+}
+
+cstring SourceInfo::srcBrief() const {
+    if (handle & dumpedBit) return dumped().get(handle & ~dumpedBit).srcBrief;
+    return ""_cs;
 }
 
 cstring SourceInfo::toString() const {
-    return absl::StrFormat("(%v)-(%v)", start.toString(), end.toString());
+    return absl::StrFormat("(%v)-(%v)", getStart().toString(), getEnd().toString());
 }
 
 std::ostream &operator<<(std::ostream &os, const SourceInfo &info) {
-    os << absl::StrFormat("(%v)-(%v)", info.start, info.end);
+    os << absl::StrFormat("(%v)-(%v)", info.getStart(), info.getEnd());
     return os;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
+/* static */ std::shared_ptr<const SourceBuffer> SourceBuffer::open(
+    const std::filesystem::path &file) {
+    std::shared_ptr<SourceBuffer> result(new SourceBuffer);
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            ::close(fd);
+            result->mapping = mapping;
+            result->mappingSize = info.st_size;
+            result->view = std::string_view(static_cast<const char *>(mapping), info.st_size);
+            return result;
+        }
+    }
+    ::close(fd);
+
+    // Pipes and the like cannot be mapped.
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return nullptr;
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    result->owned = contents.str();
+    result->view = result->owned;
+    return result;
+}
+
+/* static */ std::shared_ptr<const SourceBuffer> SourceBuffer::fromString(std::string text) {
+    std::shared_ptr<SourceBuffer> result(new SourceBuffer);
+    result->owned = std::move(text);
+    result->view = result->owned;
+    return result;
+}
+
+SourceBuffer::~SourceBuffer() {
+    if (mapping != nullptr) munmap(mapping, mappingSize);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
 InputSources::InputSources() : sealed(false) {
     mapLine("", 1);  // the first line read will be line 1 of stdin
-    contents.push_back("");
+    lineStarts.push_back(0);
+}
+
+InputSources::InputSources(std::shared_ptr<const SourceBuffer> buffer) : InputSources() {
+    this->buffer = std::move(buffer);
 }
 
 void InputSources::addComment(SourceInfo srcInfo, bool singleLine, cstring body) {
@@ -89,9 +267,14 @@ void InputSources::seal() {
     sealed = true;
 }
 
+std::string_view InputSources::text() const {
+    if (buffer) return buffer->text().substr(0, bufferLength);
+    return contents;
+}
+
 unsigned InputSources::lineCount() const {
-    int size = contents.size();
-    if (contents.back().empty()) {
+    int size = lineStarts.size();
+    if (lineStarts.back() == text().size()) {
         // do not count the last line if it is empty.
         size -= 1;
         if (size < 0) BUG("Negative line count");
@@ -99,54 +282,35 @@ unsigned InputSources::lineCount() const {
     return size;
 }
 
+void InputSources::append(std::string_view text) {
+    if (sealed) BUG("Appending to sealed InputSources");
+    size_t start = this->text().size();
+    if (buffer) {
+        BUG_CHECK(bufferLength + text.size() <= buffer->text().size(),
+                  "Appending past the end of the source buffer");
+        bufferLength += text.size();
+    } else {
+        contents += text;
+    }
+    // Lines end with a \n; a \r on its own does not end a line.
+    for (const char *nl = text.data(), *end = text.data() + text.size();
+         (nl = static_cast<const char *>(memchr(nl, '\n', end - nl))) != nullptr; ++nl)
+        lineStarts.push_back(start + (nl - text.data()) + 1);
+}
+
 // Append this text to the last line
 void InputSources::appendToLastLine(std::string_view text) {
-    if (sealed) BUG("Appending to sealed InputSources");
     // Text should not contain any newline characters
-    for (size_t i = 0; i < text.size(); i++) {
-        char c = text[i];
-        if (c == '\n') BUG("Text contains newlines");
-    }
-    contents.back() += text;
+    if (text.find('\n') != std::string_view::npos) BUG("Text contains newlines");
+    append(text);
 }
 
 // Append a newline and start a new line
-void InputSources::appendNewline(std::string_view newline) {
-    if (sealed) BUG("Appending to sealed InputSources");
-    contents.back() += newline;
-    contents.push_back("");  // start a new line
-}
+void InputSources::appendNewline(std::string_view newline) { append(newline); }
 
 void InputSources::appendText(const char *text) {
     if (text == nullptr) BUG("Null text being appended");
-    std::string_view ref(text);
-
-    while (ref.size() > 0) {
-        auto nlPos = ref.find_first_of("\r\n");
-        if (nlPos == std::string_view::npos) {
-            appendToLastLine(ref);
-            break;
-        }
-
-        size_t toCut = nlPos;
-        if (toCut != 0) {
-            std::string_view nonnl(ref.data(), toCut);
-            appendToLastLine(nonnl);
-            ref.remove_prefix(toCut);
-        } else {
-            if (ref[0] == '\n') {
-                appendNewline("\n");
-                ref.remove_prefix(1);
-            } else if (ref.size() > 2 && ref[0] == '\r' && ref[1] == '\n') {
-                appendNewline("\r\n");
-                ref.remove_prefix(2);
-            } else {
-                // Just \r
-                appendToLastLine(ref.substr(0, 1));
-                ref.remove_prefix(1);
-            }
-        }
-    }
+    append(text);
 }
 
 std::string_view InputSources::getLine(unsigned lineNumber) const {
@@ -156,17 +320,22 @@ std::string_view InputSources::getLine(unsigned lineNumber) const {
         // don't throw: this code may be called by exceptions
         // reporting on elements that have no source position
     }
-    return contents.at(lineNumber - 1);
+    size_t start = lineStarts.at(lineNumber - 1);
+    size_t end = lineNumber < lineStarts.size() ? lineStarts[lineNumber] : text().size();
+    return text().substr(start, end - start);
 }
 
 void InputSources::mapLine(std::string_view file, unsigned originalSourceLineNo) {
     if (sealed) BUG("Changing mapping to sealed InputSources");
     unsigned lineno = getCurrentLineNumber();
-    line_file_map.emplace(lineno, SourceFileLine(file, originalSourceLineNo));
+    // Lines are mapped in order; only the first mapping of a line counts.
+    if (!line_file_map.empty() && line_file_map.back().first >= lineno) return;
+    line_file_map.emplace_back(lineno, SourceFileLine(file, originalSourceLineNo));
 }
 
 SourceFileLine InputSources::getSourceLine(unsigned line) const {
-    auto it = line_file_map.upper_bound(line);
+    auto it = std::upper_bound(line_file_map.begin(), line_file_map.end(), line,
+                               [](unsigned l, const auto &entry) { return l < entry.first; });
     if (it == line_file_map.begin())
         // There must be always something mapped to line 0
         BUG("No source information for line %1%", line);
@@ -186,11 +355,11 @@ SourceFileLine InputSources::getSourceLine(unsigned line) const {
     return SourceFileLine(it->second.fileName, realLine);
 }
 
-unsigned InputSources::getCurrentLineNumber() const { return contents.size(); }
+unsigned InputSources::getCurrentLineNumber() const { return lineStarts.size(); }
 
 SourcePosition InputSources::getCurrentPosition() const {
     unsigned line = getCurrentLineNumber();
-    unsigned column = contents.back().size();
+    unsigned column = text().size() - lineStarts.back();
     return SourcePosition(line, column);
 }
 
@@ -305,7 +474,7 @@ cstring InputSources::getBriefSourceFragment(const SourceInfo &position) const {
 
 cstring InputSources::toDebugString() const {
     std::stringstream builder;
-    for (const auto &line : contents) builder << line;
+    builder << text();
     builder << "---------------" << std::endl;
     for (const auto &lf : line_file_map)
         builder << lf.first << ": " << lf.second.toString() << std::endl;
@@ -316,42 +485,42 @@ cstring InputSources::toDebugString() const {
 
 cstring SourceInfo::toSourceFragment(int trimWidth, bool useMarker) const {
     if (!isValid()) return ""_cs;
-    return sources->getSourceFragment(*this, trimWidth, useMarker);
+    return sources()->getSourceFragment(*this, trimWidth, useMarker);
 }
 
 cstring SourceInfo::toBriefSourceFragment() const {
     if (!isValid()) return ""_cs;
-    return sources->getBriefSourceFragment(*this);
+    return sources()->getBriefSourceFragment(*this);
 }
 
 cstring SourceInfo::toPositionString() const {
     if (!isValid()) return ""_cs;
-    SourceFileLine position = sources->getSourceLine(start.getLineNumber());
+    SourceFileLine position = sources()->getSourceLine(getStart().getLineNumber());
     return position.toString();
 }
 
 cstring SourceInfo::toSourcePositionData(unsigned *outLineNumber, unsigned *outColumnNumber) const {
-    SourceFileLine position = sources->getSourceLine(start.getLineNumber());
+    SourceFileLine position = sources()->getSourceLine(getStart().getLineNumber());
     if (outLineNumber != nullptr) {
         *outLineNumber = position.sourceLine;
     }
     if (outColumnNumber != nullptr) {
-        *outColumnNumber = start.getColumnNumber();
+        *outColumnNumber = getStart().getColumnNumber();
     }
     return position.fileName;
 }
 
 SourceFileLine SourceInfo::toPosition() const {
-    return sources->getSourceLine(start.getLineNumber());
+    return sources()->getSourceLine(getStart().getLineNumber());
 }
 
 cstring SourceInfo::getSourceFile() const {
-    auto sourceLine = sources->getSourceLine(start.getLineNumber());
+    auto sourceLine = sources()->getSourceLine(getStart().getLineNumber());
     return sourceLine.fileName;
 }
 
 cstring SourceInfo::getLineNum() const {
-    SourceFileLine sourceLine = sources->getSourceLine(start.getLineNumber());
+    SourceFileLine sourceLine = sources()->getSourceLine(getStart().getLineNumber());
     return Util::toString(sourceLine.sourceLine);
 }
 
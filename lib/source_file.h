@@ -21,9 +21,14 @@ limitations under the License.
 #ifndef LIB_SOURCE_FILE_H_
 #define LIB_SOURCE_FILE_H_
 
+#include <cstdint>
+#include <filesystem>
 #include <map>
+#include <memory>
 #include <sstream>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/str_format.h"
@@ -128,25 +133,21 @@ For a program element, the start is inclusive and the end is
 exclusive (the first position after the language element).
 
 SourceInfo can also be "invalid"
+
+Every IR node has one, so a SourceInfo is only a 32-bit handle to an entry in a
+process-wide table of ranges, which is resolved when the range is needed.  Entries are
+only ever added, and copying a SourceInfo (e.g. when a node is cloned) copies the handle.
 */
 class SourceInfo final {
  public:
-    cstring filename = ""_cs;
-    int line = -1;
-    int column = -1;
-    cstring srcBrief = ""_cs;
-    SourceInfo(cstring filename, int line, int column, cstring srcBrief) {
-        this->filename = filename;
-        this->line = line;
-        this->column = column;
-        this->srcBrief = srcBrief;
-    }
+    /// Creates a SourceInfo for a position read from an IR dump: it has no InputSources,
+    /// and is not valid, but the position is kept so that it can be written out again.
+    SourceInfo(cstring filename, int line, int column, cstring srcBrief);
     /// Creates an "invalid" SourceInfo
     SourceInfo() = default;
 
     /// Creates a SourceInfo for a 'point' in the source, or invalid
-    SourceInfo(const InputSources *sources, SourcePosition point)
-        : sources(sources), start(point), end(point) {}
+    SourceInfo(const InputSources *sources, SourcePosition point);
 
     SourceInfo(const InputSources *sources, SourcePosition start, SourcePosition end);
 
@@ -157,24 +158,12 @@ class SourceInfo final {
     /**
         A SourceInfo that spans both this and rhs.
         However, if this or rhs is invalid, it is not taken into account */
-    SourceInfo operator+(const SourceInfo &rhs) const {
-        if (!this->isValid()) return rhs;
-        if (!rhs.isValid()) return *this;
-        SourcePosition s = start.min(rhs.start);
-        SourcePosition e = end.max(rhs.end);
-        return SourceInfo(sources, s, e);
-    }
-    SourceInfo &operator+=(const SourceInfo &rhs) {
-        if (!isValid()) {
-            *this = rhs;
-        } else if (rhs.isValid()) {
-            start = start.min(rhs.start);
-            end = end.max(rhs.end);
-        }
-        return *this;
-    }
+    SourceInfo operator+(const SourceInfo &rhs) const;
+    SourceInfo &operator+=(const SourceInfo &rhs) { return *this = *this + rhs; }
 
-    bool operator==(const SourceInfo &rhs) const { return start == rhs.start && end == rhs.end; }
+    bool operator==(const SourceInfo &rhs) const {
+        return handle == rhs.handle || (getStart() == rhs.getStart() && getEnd() == rhs.getEnd());
+    }
 
     cstring toString() const;
 
@@ -193,15 +182,22 @@ class SourceInfo final {
     cstring toSourcePositionData(unsigned *outLineNumber, unsigned *outColumnNumber) const;
     SourceFileLine toPosition() const;
 
-    bool isValid() const { return this->start.isValid(); }
+    bool isValid() const { return handle != 0 && (handle & dumpedBit) == 0; }
     explicit operator bool() const { return isValid(); }
 
     cstring getSourceFile() const;
     cstring getLineNum() const;
 
-    const SourcePosition &getStart() const { return this->start; }
+    const SourcePosition &getStart() const;
 
-    const SourcePosition &getEnd() const { return this->end; }
+    const SourcePosition &getEnd() const;
+
+    /// The position read from an IR dump (see the constructor above); an empty file name
+    /// and -1 for the other SourceInfos.
+    cstring filename() const;
+    int line() const;
+    int column() const;
+    cstring srcBrief() const;
 
     /**
        True if this comes 'before' this source position.
@@ -211,7 +207,7 @@ class SourceInfo final {
     bool operator<(const SourceInfo &rhs) const {
         if (!rhs.isValid()) return false;
         if (!isValid()) return true;
-        return this->start < rhs.start;
+        return getStart() < rhs.getStart();
     }
     inline bool operator>(const SourceInfo &rhs) const { return rhs.operator<(*this); }
     inline bool operator<=(const SourceInfo &rhs) const { return !this->operator>(rhs); }
@@ -219,10 +215,19 @@ class SourceInfo final {
 
     friend std::ostream &operator<<(std::ostream &os, const SourceInfo &info);
 
+    /// The table entries that handles refer to.
+    struct Range;
+    struct Dumped;
+
  private:
-    const InputSources *sources = nullptr;
-    SourcePosition start = SourcePosition();
-    SourcePosition end = SourcePosition();
+    /// Handles with this bit set refer to positions read from an IR dump.
+    static constexpr uint32_t dumpedBit = uint32_t(1) << 31;
+
+    /// 0 for invalid SourceInfos.
+    uint32_t handle = 0;
+
+    const Range &range() const;
+    const InputSources *sources() const;
 };
 
 class IHasSourceInfo {
@@ -281,6 +286,32 @@ class Comment final : IHasDbPrint, IHasSourceInfo {
     [[nodiscard]] SourceInfo getSourceInfo() const override { return srcInfo; }
 };
 
+/**
+  The text of a whole source file.  Regular files are mapped into memory rather than read,
+  so InputSources and the lexers can use a large (usually generated) program in place.
+*/
+class SourceBuffer final {
+ public:
+    /// @return the contents of @p file, or nullptr if it cannot be read.
+    static std::shared_ptr<const SourceBuffer> open(const std::filesystem::path &file);
+    /// @return a buffer holding @p text.
+    static std::shared_ptr<const SourceBuffer> fromString(std::string text);
+
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+    ~SourceBuffer();
+
+    std::string_view text() const { return view; }
+
+ private:
+    SourceBuffer() = default;
+
+    std::string owned;          // the text, unless it is mapped
+    void *mapping = nullptr;    // the mapped file, if any
+    size_t mappingSize = 0;
+    std::string_view view;
+};
+
 /**
   Information about all the input sources that comprise a P4 program that is being compiled.
   The inputSources can be seen as a simple file produced by the preprocessor,
@@ -289,6 +320,10 @@ class Comment final : IHasDbPrint, IHasSourceInfo {
   The mutable part of the API is tailored for interaction with the lexer.
   After the lexer is done this object can be "sealed" and never changes again.
 
+  The text is kept in one piece, with the offsets at which lines start.  When it is
+  created for a SourceBuffer, the text appended must be the contents of the buffer, in
+  order, and it is not copied.
+
   This class implements a singleton pattern: there is a single instance of this class.
 */
 class InputSources final {
@@ -298,6 +333,8 @@ class InputSources final {
 
  public:
     InputSources();
+    /// Creates InputSources for the text of @p buffer, which must then be appended in order.
+    explicit InputSources(std::shared_ptr<const SourceBuffer> buffer);
     std::string_view getLine(unsigned lineNumber) const;
     /// Original source line that produced the line with the specified number
     SourceFileLine getSourceLine(unsigned line) const;
@@ -337,14 +374,24 @@ class InputSources final {
     void appendToLastLine(std::string_view text);
     /// Append a newline and start a new line
     void appendNewline(std::string_view newline);
+    /// Append text that may contain newlines.
+    void append(std::string_view text);
+    /// The text appended so far.
+    std::string_view text() const;
 
     /// Input program that is being currently compiled; there can be only one.
     bool sealed;
 
-    std::map<unsigned, SourceFileLine> line_file_map;
+    /// The lines from which other source lines are mapped, in increasing order.
+    std::vector<std::pair<unsigned, SourceFileLine>> line_file_map;
 
-    /// Each line also stores the end-of-line character(s)
-    std::vector<std::string> contents;
+    /// The text, if it is appended from a buffer; otherwise @ref contents holds it.
+    std::shared_ptr<const SourceBuffer> buffer;
+    size_t bufferLength = 0;
+    std::string contents;
+    /// The offset of the start of each line in the text.  Each line also contains
+    /// its end-of-line character(s).
+    std::vector<size_t> lineStarts;
     /// The commends found in the file.
     std::vector<Comment *> comments;
 };
@@ -0,0 +1,170 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "lib/thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "lib/gc.h"
+
+namespace P4::Util {
+
+namespace {
+
+/// Set while a thread runs a task, so nested parallelFor calls run inline instead of
+/// waiting on tasks that might be queued behind the caller.
+thread_local bool inTask = false;
+
+unsigned sharedJobs = 1;
+
+}  // namespace
+
+struct WorkStealingPool::Batch {
+    const std::function<void(size_t)> *fn;
+    std::vector<std::exception_ptr> errors;
+    std::atomic<size_t> pending;
+    std::mutex lock;
+    std::condition_variable done;
+
+    Batch(const std::function<void(size_t)> &fn, size_t count)
+        : fn(&fn), errors(count), pending(count) {}
+};
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    if (threads == 0) threads = 1;
+    gc_allow_threads();
+    for (unsigned i = 0; i < threads; ++i) queues.emplace_back(new Queue);
+    for (unsigned i = 0; i + 1 < threads; ++i)
+        workers.emplace_back([this, i]() { workerLoop(i); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> guard(wakeLock);
+        shutdown = true;
+    }
+    wake.notify_all();
+    for (auto &w : workers) w.join();
+}
+
+bool WorkStealingPool::take(size_t self, Task &task) {
+    // Own queue first (front), then steal from the back of the others, starting with
+    // the next queue so that thieves spread out over the victims.
+    for (size_t i = 0; i < queues.size(); ++i) {
+        auto &q = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty()) continue;
+        if (i == 0) {
+            task = q.tasks.front();
+            q.tasks.pop_front();
+        } else {
+            task = q.tasks.back();
+            q.tasks.pop_back();
+        }
+        --queued;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::run(const Task &task) {
+    auto *batch = task.batch;
+    inTask = true;
+    try {
+        (*batch->fn)(task.index);
+    } catch (...) {
+        batch->errors[task.index] = std::current_exception();
+    }
+    inTask = false;
+    // Decrement under the lock: once pending reaches zero the caller may return and
+    // destroy the batch, so it must not be touched after the lock is released.
+    std::lock_guard<std::mutex> guard(batch->lock);
+    if (--batch->pending == 0) batch->done.notify_all();
+}
+
+void WorkStealingPool::workerLoop(size_t self) {
+    gc_register_thread();
+    Task task;
+    while (true) {
+        if (take(self, task)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(wakeLock);
+        wake.wait(guard, [this]() { return shutdown || queued > 0; });
+        if (shutdown && queued == 0) break;
+    }
+    gc_unregister_thread();
+}
+
+void WorkStealingPool::parallelFor(size_t count, const std::function<void(size_t)> &fn) {
+    if (count == 0) return;
+    if (count == 1 || workers.empty() || inTask) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> batchGuard(batchLock);
+    Batch batch(fn, count);
+    for (size_t i = 0; i < count; ++i) {
+        auto &q = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.tasks.push_back(Task{&batch, i});
+        ++queued;
+    }
+    {
+        // Taking the lock orders the wakeup after any worker's check of `queued`.
+        std::lock_guard<std::mutex> guard(wakeLock);
+    }
+    wake.notify_all();
+
+    Task task;
+    size_t self = queues.size() - 1;
+    while (batch.pending > 0) {
+        if (take(self, task)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(batch.lock);
+        batch.done.wait(guard, [&batch]() { return batch.pending == 0; });
+    }
+    {
+        // Wait for the last task to release the batch.
+        std::lock_guard<std::mutex> guard(batch.lock);
+    }
+
+    for (auto &error : batch.errors)
+        if (error) std::rethrow_exception(error);
+}
+
+void WorkStealingPool::setJobs(unsigned jobs) {
+    if (jobs == 0) jobs = std::max(1U, std::thread::hardware_concurrency());
+    sharedJobs = jobs;
+}
+
+unsigned WorkStealingPool::getJobs() { return sharedJobs; }
+
+WorkStealingPool *WorkStealingPool::get() {
+    static WorkStealingPool *pool = nullptr;
+    if (sharedJobs <= 1 || !gc_allow_threads()) return nullptr;
+    if (!pool || pool->concurrency() != sharedJobs) {
+        delete pool;
+        pool = new WorkStealingPool(sharedJobs);
+    }
+    return pool;
+}
+
+}  // namespace P4::Util
@@ -0,0 +1,91 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_THREAD_POOL_H_
+#define LIB_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace P4::Util {
+
+/// A fixed set of worker threads that run independent tasks.  Every worker owns a
+/// queue of tasks; a worker that runs out of work steals from the back of the other
+/// queues, so a batch with very unbalanced tasks (one huge control next to many tiny
+/// ones) still keeps all threads busy.
+///
+/// Worker threads are registered with the garbage collector, so tasks may allocate
+/// and hold on to IR nodes.  Anything else a task touches must be safe for concurrent
+/// use; in particular the caller is responsible for not sharing mutable visitor state.
+class WorkStealingPool {
+ public:
+    /// Create a pool that runs tasks on @p threads threads in total, including the
+    /// thread calling parallelFor.
+    explicit WorkStealingPool(unsigned threads);
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+    ~WorkStealingPool();
+
+    /// @return the number of threads (including the caller) that run tasks.
+    unsigned concurrency() const { return queues.size(); }
+
+    /// Invoke fn(0) .. fn(count - 1), possibly concurrently, and wait for all of them to
+    /// finish.  The calling thread takes part in the work.  If any invocation throws,
+    /// the exception of the lowest index is rethrown once the whole batch is done, so the
+    /// result does not depend on scheduling.  Calls made from inside a task run
+    /// sequentially on the calling worker.
+    void parallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+    /// Set the number of jobs used by the shared pool.  0 picks the number of hardware
+    /// threads, 1 (the default) disables the shared pool altogether.
+    static void setJobs(unsigned jobs);
+    static unsigned getJobs();
+    /// @return the shared pool, or nullptr if only one job was requested (or threads
+    /// cannot be used with the garbage collector in this build).
+    static WorkStealingPool *get();
+
+ private:
+    struct Batch;
+    struct Task {
+        Batch *batch;
+        size_t index;
+    };
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;  // the last one belongs to the caller
+    std::vector<std::thread> workers;
+    std::mutex batchLock;  // only one batch is distributed at a time
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::atomic<size_t> queued = 0;
+    bool shutdown = false;
+
+    bool take(size_t self, Task &task);
+    void run(const Task &task);
+    void workerLoop(size_t self);
+};
+
+}  // namespace P4::Util
+
+#endif /* LIB_THREAD_POOL_H_ */
@@ -16,6 +16,8 @@ limitations under the License.
 
 #include "def_use.h"
 
+#include <tuple>
+
 #include "frontends/p4/methodInstance.h"
 
 namespace P4 {
@@ -45,7 +47,6 @@ const hvec_set<const ComputeDefUse::loc_t *> ComputeDefUse::empty;
 
 ComputeDefUse::ComputeDefUse()
     : ResolutionContext(true), cached_locs(*new std::unordered_set<loc_t>), defuse(*new defuse_t) {
-    joinFlows = true;
     visitDagOnce = false;
 }
 
@@ -60,7 +61,7 @@ void ComputeDefUse::flow_merge(Visitor &a_) {
     ComputeDefUse &a = dynamic_cast<ComputeDefUse &>(a_);
     LOG8("ComputeDefUse::flow_merge(" << a.uid << ") -> " << uid);
     unreachable &= a.unreachable;
-    for (auto &di : a.def_info) def_info[di.first].flow_merge(di.second);
+    def_info_lattice::join(def_info, a.def_info);
 }
 void ComputeDefUse::flow_copy(ControlFlowVisitor &a_) {
     ComputeDefUse &a = dynamic_cast<ComputeDefUse &>(a_);
@@ -92,7 +93,7 @@ ComputeDefUse::def_info_t::def_info_t(const def_info_t &a)
     for (auto &v : Values(slices)) v.parent = this;
 }
 
-ComputeDefUse::def_info_t::def_info_t(def_info_t &&a)
+ComputeDefUse::def_info_t::def_info_t(def_info_t &&a) noexcept
     : defs(std::move(a.defs)),
       live(std::move(a.live)),
       parent(std::move(a.parent)),
@@ -116,7 +117,8 @@ ComputeDefUse::def_info_t &ComputeDefUse::def_info_t::operator=(
     return *this;
 }
 
-ComputeDefUse::def_info_t &ComputeDefUse::def_info_t::operator=(ComputeDefUse::def_info_t &&a) {
+ComputeDefUse::def_info_t &ComputeDefUse::def_info_t::operator=(
+    ComputeDefUse::def_info_t &&a) noexcept {
     defs = std::move(a.defs);
     live = std::move(a.live);
     parent = std::move(a.parent);
@@ -128,20 +130,30 @@ ComputeDefUse::def_info_t &ComputeDefUse::def_info_t::operator=(ComputeDefUse::d
     return *this;
 }
 
-void ComputeDefUse::def_info_t::flow_merge(def_info_t &a) {
+/// merge the defs of a into this; returns true if that changed anything
+bool ComputeDefUse::def_info_t::flow_merge(const def_info_t &a) {
+    auto sizes = std::make_tuple(defs.size(), valid_bit_defs.size(), fields.size(), slices.size());
     defs.insert(a.defs.begin(), a.defs.end());
-    live |= a.live;
+    bool changed = live |= a.live;
     valid_bit_defs.insert(a.valid_bit_defs.begin(), a.valid_bit_defs.end());
-    for (auto &f : a.fields) fields[f.first].flow_merge(f.second);
+    for (auto &f : a.fields) changed |= fields[f.first].flow_merge(f.second);
     for (auto &s : a.slices) {
         split_slice(s.first);
         for (auto it = slices_overlap_begin(s.first);
              it != slices.end() && it->first.overlaps(s.first); ++it) {
             BUG_CHECK(s.first.contains(it->first), "slice_split failed to work");
-            it->second.flow_merge(s.second);
+            changed |= it->second.flow_merge(s.second);
         }
     }
     slices_sanity();
+    return changed ||
+           sizes != std::make_tuple(defs.size(), valid_bit_defs.size(), fields.size(), slices.size());
+}
+
+bool ComputeDefUse::def_info_lattice::join(def_info_map_t &a, const def_info_map_t &b) {
+    bool changed = false;
+    for (auto &[decl, di] : b) changed |= a[decl].flow_merge(di);
+    return changed;
 }
 
 bool ComputeDefUse::def_info_t::operator==(const def_info_t &a) const {
@@ -169,63 +181,6 @@ bool ComputeDefUse::def_info_t::operator==(const def_info_t &a) const {
     return true;
 }
 
-class ComputeDefUse::SetupJoinPoints : public ControlFlowVisitor::SetupJoinPoints,
-                                       public P4::ResolutionContext {
-    bool preorder(const IR::ParserState *n) override {
-        LOG6("SetupJoinPoints(ParserState " << n->name << ")" << Log::indent);
-        return true;
-    }
-    void revisit(const IR::ParserState *n) override {
-        if (n->isBuiltin() && n->components.empty() && !n->selectExpression) {
-            // FIXME -- P4-14->16 conversion uses a single accept and reject state for
-            // both ingress and egress, which will cause problems, so we avoid it.
-            // Perhaps we should ignore/not revisit all states with components.empty()
-            // as they by definition don't do anything?
-            return;
-        }
-        ++join_points[n].count;
-        LOG6("SetupJoinPoints::revisit(ParserState " << n->name << ") [" << join_points[n].count
-                                                     << "]");
-    }
-    void loop_revisit(const IR::ParserState *n) override { LOG6("  * loop into " << n->name); }
-    void postorder(const IR::ParserState *) override { LOG6_UNINDENT; }
-    void revisit(const IR::Node *) override {}
-    bool preorder(const IR::PathExpression *pe) override {
-        if (pe->type->is<IR::Type_State>()) {
-            auto *d = resolveUnique(pe->path->name, P4::ResolutionType::Any);
-            BUG_CHECK(d, "failed to resolve %s", pe);
-            auto ps = d->to<IR::ParserState>();
-            BUG_CHECK(ps, "%s is not a parser state", d);
-            visit(ps, "transition");
-        }
-        return false;
-    }
-    bool preorder(const IR::P4Parser *p) override {
-        IndentCtl::TempIndent indent;
-        LOG6("SetupJoinPoints(P4Parser " << p->name << ")" << indent);
-        LOG8("    " << Log::indent << Log::indent << *p << Log::unindent << Log::unindent);
-        if (auto start = p->states.getDeclaration<IR::ParserState>("start"_cs))
-            visit(start, "start");
-        return false;
-    }
-    bool preorder(const IR::P4Control *) override { return false; }
-    bool preorder(const IR::Type *) override { return false; }
-
- public:
-    explicit SetupJoinPoints(decltype(join_points) &fjp)
-        : ControlFlowVisitor::SetupJoinPoints(fjp) {}
-};
-
-void ComputeDefUse::applySetupJoinPoints(const IR::Node *root) {
-    root->apply(SetupJoinPoints(*flow_join_points));
-}
-
-bool ComputeDefUse::filter_join_point(const IR::Node *n) {
-    LOG6("init_join_flows " << n->to<IR::ParserState>()->name << " = "
-                            << flow_join_points->at(n).count);
-    return false;
-}
-
 const ComputeDefUse::loc_t *ComputeDefUse::getLoc(const Visitor::Context *ctxt) {
     if (!ctxt) return nullptr;
     loc_t tmp{ctxt->node, getLoc(ctxt->parent)};
@@ -252,7 +207,7 @@ void ComputeDefUse::def_info_t::slices_sanity() {
 
 /// return an iterator to the first element of 'slices' that overlaps the given range,
 /// or slices.end() if none do
-std::map<le_bitrange, ComputeDefUse::def_info_t>::iterator
+flat_map<le_bitrange, ComputeDefUse::def_info_t>::iterator
 ComputeDefUse::def_info_t::slices_overlap_begin(le_bitrange range) {
     auto rv = slices.lower_bound(range);
     if (rv != slices.begin()) {
@@ -262,24 +217,29 @@ ComputeDefUse::def_info_t::slices_overlap_begin(le_bitrange range) {
     return rv;
 }
 
+/// return an iterator to the first element of 'slices' after those that overlap the given
+/// range (the first element that starts after it)
+flat_map<le_bitrange, ComputeDefUse::def_info_t>::iterator
+ComputeDefUse::def_info_t::slices_overlap_end(le_bitrange range) {
+    return slices.lower_bound(le_bitrange(range.hi + 1, range.hi + 1));
+}
+
 /* erase parts of the slices that overlap the specified range.  So if we have [7:0] and [15:8],
  * erase_slice([11:4]) will leave [3:0] and [15:12]
  */
 void ComputeDefUse::def_info_t::erase_slice(le_bitrange range) {
-    for (auto it = slices_overlap_begin(range); it != slices.end() && it->first.overlaps(range);) {
-        if (!range.contains(it->first)) {
-            if (it->first.lo < range.lo) {
-                bool i = slices.emplace(le_bitrange(it->first.lo, range.lo - 1), it->second).second;
-                BUG_CHECK(i, "inserting already present range?");
-            }
-            if (it->first.hi > range.hi) {
-                bool i =
-                    slices.emplace(le_bitrange(range.hi + 1, it->first.hi), std::move(it->second))
-                        .second;
-                BUG_CHECK(i, "inserting already present range?");
-            }
-        }
-        it = slices.erase(it);
+    auto it = slices_overlap_begin(range), end = slices_overlap_end(range);
+    if (it != end) {
+        // only the first and last overlapping slices can extend past range; keep those parts
+        std::vector<std::pair<le_bitrange, def_info_t>> keep;
+        if (it->first.lo < range.lo)
+            keep.emplace_back(le_bitrange(it->first.lo, range.lo - 1), it->second);
+        auto last = std::prev(end);
+        if (last->first.hi > range.hi)
+            keep.emplace_back(le_bitrange(range.hi + 1, last->first.hi), std::move(last->second));
+        it = slices.erase(it, end);
+        for (auto &[slice, info] : keep)
+            it = std::next(slices.emplace_hint(it, slice, std::move(info)));
     }
     slices_sanity();
 }
@@ -289,33 +249,28 @@ void ComputeDefUse::def_info_t::erase_slice(le_bitrange range) {
  * split the slices into [3:0], [7:4], [11:8], and [15:12]
  */
 void ComputeDefUse::def_info_t::split_slice(le_bitrange range) {
-    auto it = slices_overlap_begin(range);
-    if (it == slices.end() || !it->first.overlaps(range)) {
+    auto it = slices_overlap_begin(range), end = slices_overlap_end(range);
+    if (it == end) {
         // range doesn't overlap any existing slices: create a new slice with empty def_use_t
-        slices[range];
+        slices.emplace_hint(it, range, def_info_t());
     } else {
-        while (it != slices.end() && it->first.overlaps(range)) {
-            if (!range.contains(it->first)) {
-                // first, insert the pieces of it->first that do not overlap range
-                if (it->first.lo < range.lo) {
-                    bool i =
-                        slices.emplace(le_bitrange(it->first.lo, range.lo - 1), it->second).second;
-                    BUG_CHECK(i, "inserting already present range?");
-                }
-                if (it->first.hi > range.hi) {
-                    bool i =
-                        slices.emplace(le_bitrange(range.hi + 1, it->first.hi), it->second).second;
-                    BUG_CHECK(i, "inserting already present range?");
-                }
-                // then insert the intersecion of range and it->first
-                bool i =
-                    slices.emplace(range.intersectWith(it->first), std::move(it->second)).second;
-                BUG_CHECK(i, "inserting already present range?");
-                it = slices.erase(it);
-            } else {
-                ++it;
-            }
-        }
+        // only the first and last overlapping slices can extend past range; replace each
+        // of those by the pieces outside range and its intersection with range
+        auto split = [this, range](size_t idx) {
+            auto pos = slices.begin() + idx;
+            le_bitrange slice = pos->first;
+            if (range.contains(slice)) return;
+            def_info_t info = std::move(pos->second);
+            pos = slices.erase(pos);
+            if (slice.hi > range.hi)
+                pos = slices.emplace_hint(pos, le_bitrange(range.hi + 1, slice.hi), info);
+            pos = slices.emplace_hint(pos, le_bitrange(range.intersectWith(slice)), info);
+            if (slice.lo < range.lo)
+                slices.emplace_hint(pos, le_bitrange(slice.lo, range.lo - 1), std::move(info));
+        };
+        size_t first = it - slices.begin(), last = end - slices.begin() - 1;
+        split(last);  // the later one first, so the index of the earlier one stays valid
+        if (first != last) split(first);
     }
     slices_sanity();
 }
@@ -390,11 +345,22 @@ bool ComputeDefUse::preorder(const IR::P4Parser *p) {
         if (a->direction == IR::Direction::In || a->direction == IR::Direction::InOut)
             def_info[a].defs.insert(getLoc(a));
     state = NORMAL;
-    if (auto start = p->states.getDeclaration<IR::ParserState>("start"_cs)) {
-        visit(start, "start");
-    } else {
-        BUG("No start state in %s", p);
-    }
+    auto start = p->states.getDeclaration<IR::ParserState>("start"_cs);
+    BUG_CHECK(start, "No start state in %s", p);
+    DataflowWorklist<const IR::ParserState *, def_info_map_t, def_info_lattice> worklist;
+    def_info_map_t exit;
+    parser_states = &worklist;
+    worklist.propagate(start, def_info);
+    worklist.run([&](const IR::ParserState *ps, def_info_map_t &entry) {
+        def_info = std::move(entry);
+        unreachable = false;
+        visit(ps, "states");
+        // transitions have added the states that follow; the parser ends after
+        // states without one
+        if (!ps->selectExpression) def_info_lattice::join(exit, def_info);
+    });
+    parser_states = nullptr;
+    def_info = std::move(exit);
     for (auto *a : p->getApplyParameters()->parameters)
         if (a->direction == IR::Direction::Out || a->direction == IR::Direction::InOut)
             add_uses(getLoc(a), def_info[a]);
@@ -406,8 +372,6 @@ bool ComputeDefUse::preorder(const IR::ParserState *p) {
     LOG5("ComputeDefUse" << uid << "(ParserState " << p->name << ")" << Log::indent);
     return true;
 }
-void ComputeDefUse::revisit(const IR::ParserState *p) { LOG5("  * revisit " << p->name); }
-void ComputeDefUse::loop_revisit(const IR::ParserState *p) { LOG5("  * loop into " << p->name); }
 void ComputeDefUse::postorder(const IR::ParserState *) { LOG5_UNINDENT; }
 
 bool ComputeDefUse::preorder(const IR::KeyElement *ke) {
@@ -563,9 +527,10 @@ const IR::Expression *ComputeDefUse::do_write(def_info_t &di, const IR::Expressi
             // propagate struct liveness to all of the fields
             if (di.live[fi]) {
                 for (auto *sf : str->fields) {
-                    if (!di.fields.count(sf->name)) {
-                        set_live_from_type(di.fields[sf->name], sf->type);
-                        di.fields[sf->name].defs = di.defs;
+                    if (!di.fields.count(sf->name.name)) {
+                        auto &field = di.fields[sf->name.name];
+                        set_live_from_type(field, sf->type);
+                        field.defs = di.defs;
                     }
                 }
             }
@@ -656,7 +621,8 @@ bool ComputeDefUse::preorder(const IR::PathExpression *pe) {
         BUG_CHECK(d, "failed to resolve %s", pe);
         auto ps = d->to<IR::ParserState>();
         BUG_CHECK(ps, "%s is not a parser state", d);
-        visit(ps, "transition");
+        BUG_CHECK(parser_states, "transition to %s outside of a parser", ps->name);
+        if (parser_states->propagate(ps, def_info)) LOG5("  * transition to " << ps->name);
         return false;
     }
     if (state == SKIPPING) return false;
@@ -666,9 +632,6 @@ bool ComputeDefUse::preorder(const IR::PathExpression *pe) {
     if (isWrite() && state != READ_ONLY) do_write(def_info[d], pe, getContext());
     return false;
 }
-void ComputeDefUse::loop_revisit(const IR::PathExpression *pe) {
-    LOG5("  * not visiting PathExpresion " << pe->path->name << " to avoid loop!");
-}
 
 bool ComputeDefUse::preorder(const IR::MethodCallExpression *mc) {
     auto *mi = P4::MethodInstance::resolve(mc, this);
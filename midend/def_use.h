@@ -20,6 +20,8 @@ limitations under the License.
 #include "frontends/common/resolveReferences/resolveReferences.h"
 #include "ir/ir.h"
 #include "lib/bitrange.h"
+#include "lib/dataflow.h"
+#include "lib/flat_map.h"
 #include "lib/hvec_map.h"
 #include "lib/hvec_set.h"
 
@@ -34,8 +36,12 @@ namespace P4 {
  * that reach the argument use while getUses(def) will return all the uses of the
  * given def.  The returned values are sets of ComputeUseDef::loc_t objects which
  * contain both the node that is def or use as well as the context path from the root
- * of the IR to that node -- actions that are used by mulitple tables or parser states
- * reachable via multiple paths may have mulitple entries as a result
+ * of the IR to that node -- actions that are used by mulitple tables may have mulitple
+ * entries as a result
+ *
+ * Parsers are analyzed with a DataflowWorklist over their states rather than by following
+ * the transitions: each state is visited again only while the defs reaching it change,
+ * so defs also reach around loops in the parser.
  *
  * @pre Currently the code does not consider calls between controls or parsers, as it is
  * expected to run after inlining when all such calls have been flattened.
@@ -118,24 +124,34 @@ class ComputeDefUse : public Inspector,
         def_info_t *parent = nullptr;
         // track valid bit access for headers separate from the rest of the header
         locset_t valid_bit_defs;
-        // one of these maps will always be empty.
-        std::map<cstring, def_info_t> fields;
-        std::map<le_bitrange, def_info_t> slices;  // also used for arrays
-        // keys in slices are always non-overlapping (checked by slices_sanity)
+        // one of these maps will always be empty.  Both are kept flat, sorted by key, so
+        // they iterate in the same order as a std::map would.
+        flat_map<cstring, def_info_t> fields;
+        flat_map<le_bitrange, def_info_t> slices;  // also used for arrays
+        // keys in slices are always non-overlapping (checked by slices_sanity), so the
+        // slices overlapping a range are a contiguous run found by binary search
         void slices_sanity();
-        std::map<le_bitrange, def_info_t>::iterator slices_overlap_begin(le_bitrange);
+        flat_map<le_bitrange, def_info_t>::iterator slices_overlap_begin(le_bitrange);
+        flat_map<le_bitrange, def_info_t>::iterator slices_overlap_end(le_bitrange);
         void erase_slice(le_bitrange);
         void split_slice(le_bitrange);
-        void flow_merge(def_info_t &);
+        bool flow_merge(const def_info_t &);
         bool operator==(const def_info_t &) const;
         bool operator!=(const def_info_t &a) const { return !(*this == a); }
         def_info_t() = default;
         def_info_t(const def_info_t &);
-        def_info_t(def_info_t &&);
+        def_info_t(def_info_t &&) noexcept;
         def_info_t &operator=(const def_info_t &);
-        def_info_t &operator=(def_info_t &&);
+        def_info_t &operator=(def_info_t &&) noexcept;
+    };
+    typedef hvec_map<const IR::IDeclaration *, def_info_t> def_info_map_t;
+    def_info_map_t def_info;
+    struct def_info_lattice {
+        static bool join(def_info_map_t &, const def_info_map_t &);
     };
-    hvec_map<const IR::IDeclaration *, def_info_t> def_info;
+    // the defs reaching each parser state; set while visiting a parser
+    DataflowWorklist<const IR::ParserState *, def_info_map_t, def_info_lattice> *parser_states =
+        nullptr;
     void add_uses(const loc_t *, def_info_t &);
     void set_live_from_type(def_info_t &di, const IR::Type *type);
 
@@ -163,8 +179,6 @@ class ComputeDefUse : public Inspector,
     bool preorder(const IR::P4Parser *) override;
     bool preorder(const IR::Function *) override;
     bool preorder(const IR::ParserState *) override;
-    void revisit(const IR::ParserState *) override;
-    void loop_revisit(const IR::ParserState *) override;
     void postorder(const IR::ParserState *) override;
     bool preorder(const IR::Type *) override { return false; }
     bool preorder(const IR::Vector<IR::Annotation> *) override { return false; }
@@ -173,14 +187,9 @@ class ComputeDefUse : public Inspector,
     const IR::Expression *do_read(def_info_t &, const IR::Expression *, const Context *);
     const IR::Expression *do_write(def_info_t &, const IR::Expression *, const Context *);
     bool preorder(const IR::PathExpression *) override;
-    void loop_revisit(const IR::PathExpression *) override;
     bool preorder(const IR::MethodCallExpression *) override;
     void end_apply() override;
 
-    class SetupJoinPoints;
-    void applySetupJoinPoints(const IR::Node *root) override;
-    bool filter_join_point(const IR::Node *) override;
-
  public:
     ComputeDefUse();
     void clear();
@@ -54,11 +54,19 @@ class hasSideEffects : public Inspector, public ResolutionContext {
         return false;
     }
     bool preorder(const IR::Expression *) override { return !result; }
+    void skipOtherSubtrees() {
+        visitOnlySubtreesContaining<IR::BaseAssignmentStatement, IR::MethodCallExpression,
+                                    IR::Primitive>();
+    }
 
  public:
-    explicit hasSideEffects(const IR::Expression *e) { e->apply(*this); }
+    explicit hasSideEffects(const IR::Expression *e) {
+        skipOtherSubtrees();
+        e->apply(*this);
+    }
     hasSideEffects(P4::TypeMap *tm, const IR::Expression *e, const Visitor::Context *ctxt)
         : typeMap(tm) {
+        skipOtherSubtrees();
         e->apply(*this, ctxt);
     }
     bool operator()(const IR::Expression *e) {
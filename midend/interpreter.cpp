@@ -8,6 +8,7 @@
 namespace P4 {
 
 unsigned SymbolicValue::crtid = 0;
+std::atomic<unsigned> ValueMap::crtOwner{0};
 
 SymbolicValue *SymbolicValueFactory::create(const IR::Type *type, bool uninitialized) const {
     type = typeMap->getTypeType(type, true);
@@ -256,34 +257,56 @@ SymbolicValue *SymbolicStruct::clone() const {
     return result;
 }
 
+SymbolicValue *SymbolicStruct::shallowClone() const {
+    auto result = new SymbolicStruct(type->to<IR::Type_StructLike>());
+    result->fieldValue = fieldValue;
+    return result;
+}
+
+SymbolicValue *SymbolicStruct::getWritable(const IR::Node *node, cstring field) {
+    auto result = get(node, field);
+    if (result->is<SymbolicError>()) return result;
+    return own(fieldValue.at(field));
+}
+
 void SymbolicStruct::assign(const SymbolicValue *other) {
     if (other->is<SymbolicError>()) return;
     BUG_CHECK(other->is<SymbolicStruct>(), "%1%: expected a struct", other);
     auto sv = other->to<SymbolicStruct>();
-    for (auto f : sv->fieldValue) fieldValue[f.first]->assign(f.second);
+    for (auto f : sv->fieldValue) own(fieldValue[f.first])->assign(f.second);
 }
 
 bool SymbolicStruct::merge(const SymbolicValue *other) {
     BUG_CHECK(other->is<SymbolicStruct>(), "%1%: expected a struct", other);
     auto sv = other->to<SymbolicStruct>();
     bool changes = false;
-    for (auto f : sv->fieldValue) changes = changes || fieldValue[f.first]->merge(f.second);
+    for (auto f : sv->fieldValue)
+        changes = changes || mergeComponent(fieldValue[f.first], f.second);
     return changes;
 }
 
 void SymbolicStruct::setAllUnknown() {
     for (auto f : type->to<IR::Type_StructLike>()->fields)
-        fieldValue[f->name.name]->setAllUnknown();
+        own(fieldValue[f->name.name])->setAllUnknown();
 }
 
 bool SymbolicStruct::equals(const SymbolicValue *other) const {
     if (!other->is<SymbolicStruct>()) return false;
     auto sv = other->to<SymbolicStruct>();
-    for (auto f : sv->fieldValue)
-        if (!get(nullptr, f.first)->equals(f.second)) return false;
+    for (auto f : sv->fieldValue) {
+        auto value = get(nullptr, f.first);
+        if (value != f.second && !value->equals(f.second)) return false;
+    }
     return true;
 }
 
+size_t SymbolicStruct::hash() const {
+    size_t result = 0;
+    for (auto f : fieldValue)
+        result = Util::hash_combine(result, Util::Hash{}(f.first, f.second->hash()));
+    return result;
+}
+
 bool SymbolicStruct::hasUninitializedParts() const {
     for (auto f : fieldValue)
         if (f.second->hasUninitializedParts()) return true;
@@ -345,18 +368,25 @@ SymbolicValue *SymbolicHeaderUnion::clone() const {
     return result;
 }
 
+SymbolicValue *SymbolicHeaderUnion::shallowClone() const {
+    auto result = new SymbolicHeaderUnion(type->to<IR::Type_HeaderUnion>());
+    result->fieldValue = fieldValue;
+    return result;
+}
+
 void SymbolicHeaderUnion::assign(const SymbolicValue *other) {
     if (other->is<SymbolicError>()) return;
     auto hv = other->to<SymbolicHeaderUnion>();
     BUG_CHECK(hv, "%1%: expected a header union", other);
-    for (auto f : hv->fieldValue) fieldValue[f.first]->assign(f.second);
+    for (auto f : hv->fieldValue) own(fieldValue[f.first])->assign(f.second);
 }
 
 bool SymbolicHeaderUnion::merge(const SymbolicValue *other) {
     auto hv = other->to<SymbolicHeaderUnion>();
     BUG_CHECK(hv, "%1%: expected a header union", other);
     bool changes = false;
-    for (auto f : hv->fieldValue) changes = changes || fieldValue[f.first]->merge(f.second);
+    for (auto f : hv->fieldValue)
+        changes = changes || mergeComponent(fieldValue[f.first], f.second);
     return changes;
 }
 
@@ -393,7 +423,7 @@ SymbolicValue *SymbolicHeader::get(const IR::Node *node, cstring field) const {
 
 void SymbolicHeader::setAllUnknown() {
     SymbolicStruct::setAllUnknown();
-    valid->setAllUnknown();
+    own(valid)->setAllUnknown();
 }
 
 SymbolicValue *SymbolicHeader::clone() const {
@@ -403,24 +433,32 @@ SymbolicValue *SymbolicHeader::clone() const {
     return result;
 }
 
+SymbolicValue *SymbolicHeader::shallowClone() const {
+    auto result = new SymbolicHeader(type->to<IR::Type_Header>());
+    result->fieldValue = fieldValue;
+    result->valid = valid;
+    return result;
+}
+
 void SymbolicHeader::assign(const SymbolicValue *other) {
     if (other->is<SymbolicError>()) return;
     BUG_CHECK(other->is<SymbolicStruct>(), "%1%: expected a struct", other);
     if (auto hv = other->to<SymbolicStruct>()) {
-        for (auto f : hv->fieldValue) fieldValue[f.first]->assign(f.second);
+        for (auto f : hv->fieldValue) own(fieldValue[f.first])->assign(f.second);
     }
     if (auto hv = other->to<SymbolicHeader>())
-        valid->assign(hv->valid);
+        own(valid)->assign(hv->valid);
     else
-        valid->assign(new SymbolicBool(true));
+        own(valid)->assign(new SymbolicBool(true));
 }
 
 bool SymbolicHeader::merge(const SymbolicValue *other) {
     BUG_CHECK(other->is<SymbolicHeader>(), "%1%: expected a header", other);
     auto hv = other->to<SymbolicHeader>();
     bool changes = false;
-    for (auto f : hv->fieldValue) changes = changes || fieldValue[f.first]->merge(f.second);
-    changes = changes || valid->merge(hv->valid);
+    for (auto f : hv->fieldValue)
+        changes = changes || mergeComponent(fieldValue[f.first], f.second);
+    changes = changes || mergeComponent(valid, hv->valid);
     return changes;
 }
 
@@ -434,6 +472,13 @@ bool SymbolicHeader::equals(const SymbolicValue *other) const {
     return SymbolicStruct::equals(other);
 }
 
+size_t SymbolicHeader::hash() const {
+    if (valid->isKnown() && !valid->value)
+        // Invalid headers are equal
+        return valid->hash();
+    return Util::hash_combine(valid->hash(), SymbolicStruct::hash());
+}
+
 void SymbolicHeader::dbprint(std::ostream &out) const {
     out << "{ ";
     out << "valid=>";
@@ -467,10 +512,13 @@ SymbolicArray::SymbolicArray(const IR::Type_Stack *type, bool uninitialized,
 }
 
 void SymbolicArray::shift(int amount) {
+    // The elements that are emptied still share their value with the element they were
+    // moved to, so they get a value of their own before they are invalidated.
     if (amount < 0) {
         for (unsigned i = 0; i < values.size() + amount; i++) values[i] = values[i - amount];
         for (unsigned i = values.size() + amount; i < values.size(); i++) {
             if (values[i]->is<SymbolicHeader>()) {
+                values[i] = values[i]->shallowClone()->to<SymbolicStruct>();
                 values[i]->to<SymbolicHeader>()->setValid(false);
             }
         }
@@ -479,6 +527,7 @@ void SymbolicArray::shift(int amount) {
             values[values.size() - i - 1] = values[values.size() - i - amount - 1];
         for (unsigned i = 0; i < (unsigned)amount; i++) {
             if (values[i]->is<SymbolicHeader>()) {
+                values[i] = values[i]->shallowClone()->to<SymbolicStruct>();
                 values[i]->to<SymbolicHeader>()->setValid(false);
             }
         }
@@ -492,10 +541,10 @@ SymbolicValue *SymbolicArray::next(const IR::Node *node) {
             if (v->to<SymbolicHeader>()->valid->isUnknown() ||
                 v->to<SymbolicHeader>()->valid->isUninitialized())
                 return new AnyElement(this);
-            if (!v->to<SymbolicHeader>()->valid->value) return v;
+            if (!v->to<SymbolicHeader>()->valid->value) return own(values[i]);
         }
         if (values[i]->is<SymbolicHeaderUnion>()) {
-            return v;
+            return own(values[i]);
         }
     }
     return new SymbolicException(node, P4::StandardExceptions::StackOutOfBounds);
@@ -528,17 +577,17 @@ SymbolicValue *SymbolicArray::last(const IR::Node *node) {
             if (v->to<SymbolicHeader>()->valid->isUnknown() ||
                 v->to<SymbolicHeader>()->valid->isUninitialized())
                 return new AnyElement(this);
-            if (v->to<SymbolicHeader>()->valid->value) return v;
+            if (v->to<SymbolicHeader>()->valid->value) return own(values[index]);
         }
         if (values[i]->is<SymbolicHeaderUnion>()) {
-            return v;
+            return own(values[index]);
         }
     }
     return new SymbolicException(node, P4::StandardExceptions::StackOutOfBounds);
 }
 
 void SymbolicArray::setAllUnknown() {
-    for (unsigned i = 0; i < values.size(); i++) values.at(i)->setAllUnknown();
+    for (unsigned i = 0; i < values.size(); i++) own(values.at(i))->setAllUnknown();
 }
 
 SymbolicValue *SymbolicArray::clone() const {
@@ -548,18 +597,25 @@ SymbolicValue *SymbolicArray::clone() const {
     return result;
 }
 
+SymbolicValue *SymbolicArray::shallowClone() const {
+    auto result = new SymbolicArray(type->to<IR::Type_Stack>());
+    result->values = values;
+    return result;
+}
+
 void SymbolicArray::assign(const SymbolicValue *other) {
     if (other->is<SymbolicError>()) return;
     BUG_CHECK(other->is<SymbolicArray>(), "%1%: expected an array", other);
     for (unsigned i = 0; i < values.size(); i++)
-        values.at(i)->assign(other->to<SymbolicArray>()->get(nullptr, i));
+        own(values.at(i))->assign(other->to<SymbolicArray>()->get(nullptr, i));
 }
 
 bool SymbolicArray::merge(const SymbolicValue *other) {
     BUG_CHECK(other->is<SymbolicArray>(), "%1%: expected an array", other);
     bool changes = false;
     for (unsigned i = 0; i < values.size(); i++)
-        changes = changes || values.at(i)->merge(other->to<SymbolicArray>()->get(nullptr, i));
+        changes =
+            changes || mergeComponent(values.at(i), other->to<SymbolicArray>()->get(nullptr, i));
     return changes;
 }
 
@@ -567,11 +623,18 @@ bool SymbolicArray::equals(const SymbolicValue *other) const {
     if (!other->is<SymbolicArray>()) return false;
     auto sa = other->to<SymbolicArray>();
     for (unsigned i = 0; i < values.size(); i++) {
-        if (!values.at(i)->equals(sa->get(nullptr, i))) return false;
+        auto value = sa->get(nullptr, i);
+        if (values.at(i) != value && !values.at(i)->equals(value)) return false;
     }
     return true;
 }
 
+size_t SymbolicArray::hash() const {
+    size_t result = 0;
+    for (auto v : values) result = Util::hash_combine(result, v->hash());
+    return result;
+}
+
 bool SymbolicArray::hasUninitializedParts() const {
     for (unsigned i = 0; i < values.size(); i++)
         if (values.at(i)->hasUninitializedParts()) return true;
@@ -618,7 +681,7 @@ SymbolicTuple::SymbolicTuple(const IR::Type_Tuple *type, bool uninitialized,
 }
 
 void SymbolicTuple::setAllUnknown() {
-    for (unsigned i = 0; i < values.size(); i++) values.at(i)->setAllUnknown();
+    for (unsigned i = 0; i < values.size(); i++) own(values.at(i))->setAllUnknown();
 }
 
 SymbolicValue *SymbolicTuple::clone() const {
@@ -627,13 +690,19 @@ SymbolicValue *SymbolicTuple::clone() const {
     return result;
 }
 
+SymbolicValue *SymbolicTuple::shallowClone() const {
+    auto result = new SymbolicTuple(type->to<IR::Type_Tuple>());
+    result->values = values;
+    return result;
+}
+
 bool SymbolicTuple::merge(const SymbolicValue *other) {
     BUG_CHECK(other->is<SymbolicTuple>(), "%1%: expected a tuple value", other);
     auto tpl = other->to<SymbolicTuple>();
     BUG_CHECK(values.size() == tpl->values.size(), "merging tuples with different sizes");
     bool changes = false;
     for (unsigned i = 0; i < values.size(); i++)
-        changes = changes || values.at(i)->merge(tpl->get(i));
+        changes = changes || mergeComponent(values.at(i), tpl->get(i));
     return changes;
 }
 
@@ -645,6 +714,12 @@ bool SymbolicTuple::equals(const SymbolicValue *other) const {
     return true;
 }
 
+size_t SymbolicTuple::hash() const {
+    size_t result = 0;
+    for (auto v : values) result = Util::hash_combine(result, v->hash());
+    return result;
+}
+
 bool SymbolicTuple::hasUninitializedParts() const {
     for (unsigned i = 0; i < values.size(); i++)
         if (values.at(i)->hasUninitializedParts()) return true;
@@ -675,6 +750,8 @@ bool SymbolicPacketIn::equals(const SymbolicValue *other) const {
     return minimumStreamOffset == sp->minimumStreamOffset;
 }
 
+size_t SymbolicPacketIn::hash() const { return Util::Hash{}(minimumStreamOffset); }
+
 SymbolicVoid *SymbolicVoid::instance = new SymbolicVoid();
 
 /*****************************************************************************************/
@@ -1000,11 +1077,11 @@ void ExpressionEvaluator::postorder(const IR::Member *expression) {
         set(expression, v);
     } else if (basetype->is<IR::Type_HeaderUnion>()) {
         BUG_CHECK(l->is<SymbolicHeaderUnion>(), "%1%: expected a header union", l);
-        auto v = l->to<SymbolicHeaderUnion>()->get(expression, expression->member.name);
+        auto v = l->to<SymbolicHeaderUnion>()->getWritable(expression, expression->member.name);
         set(expression, v);
     } else {
         BUG_CHECK(l->is<SymbolicStruct>(), "%1%: expected a struct", l);
-        auto v = l->to<SymbolicStruct>()->get(expression, expression->member.name);
+        auto v = l->to<SymbolicStruct>()->getWritable(expression, expression->member.name);
         set(expression, v);
     }
 }
@@ -1049,7 +1126,7 @@ void ExpressionEvaluator::postorder(const IR::ArrayIndex *expression) {
     CHECK_NULL(lv);
     auto ix = r->to<SymbolicInteger>();
     CHECK_NULL(ix);
-    auto result = lv->get(expression, ix->constant->asInt());
+    auto result = lv->getWritable(expression, ix->constant->asInt());
     set(expression, result);
 }
 
@@ -1060,7 +1137,7 @@ void ExpressionEvaluator::postorder(const IR::PathExpression *expression) {
     if (type->is<IR::Type_Error>())
         result = new SymbolicEnum(type, decl->getName());
     else
-        result = valueMap->get(decl);
+        result = valueMap->getWritable(decl);
     set(expression, result);
 }
 
@@ -1169,7 +1246,7 @@ void ExpressionEvaluator::postorder(const IR::MethodCallExpression *expression)
                 }
 
                 auto decl = em->object;
-                auto obj = valueMap->get(decl);
+                auto obj = valueMap->getWritable(decl);
                 CHECK_NULL(obj);
                 if (obj->is<SymbolicError>()) {
                     set(expression, obj);
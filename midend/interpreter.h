@@ -16,10 +16,14 @@ limitations under the License.
 #ifndef MIDEND_INTERPRETER_H_
 #define MIDEND_INTERPRETER_H_
 
+#include <atomic>
+
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/p4/typeMap.h"
 #include "ir/ir.h"
+#include "lib/cow_ptr.h"
+#include "lib/hash.h"
 
 // Symbolic P4 program evaluation.
 
@@ -30,15 +34,45 @@ class SymbolicValueFactory;
 // Base class for all abstract values
 class SymbolicValue : public IHasDbPrint, public ICastable {
     static unsigned crtid;
+    friend class ValueMap;
 
  protected:
     explicit SymbolicValue(const IR::Type *type) : id(crtid++), type(type) {}
 
+    // The version of a ValueMap that may modify this value in place (see ValueMap::fork),
+    // or 0 if no map owns it.
+    unsigned owner = 0;
+
+    // Makes 'component' writable by 'owner', replacing it with a shallow copy if it
+    // may be shared with other versions of a ValueMap.  Values that no map owns copy
+    // their components before modifying them, as these may belong to a map.
+    template <class T>
+    static T *own(unsigned owner, T *&component) {
+        if (owner == 0 || component->owner != owner) {
+            component = component->shallowClone()->template to<T>();
+            component->owner = owner;
+        }
+        return component;
+    }
+    // Makes 'component', a part of this value, writable by the owner of this value.
+    template <class T>
+    T *own(T *&component) {
+        return own(owner, component);
+    }
+    // Merges 'other' into 'component', a part of this value.
+    template <class T>
+    bool mergeComponent(T *&component, const SymbolicValue *other) {
+        if (component == other) return false;
+        return own(component)->merge(other);
+    }
+
  public:
     const unsigned id;
     const IR::Type *type;
     virtual bool isScalar() const = 0;
     virtual SymbolicValue *clone() const = 0;
+    // A copy that shares the fields or elements of this value.
+    virtual SymbolicValue *shallowClone() const { return clone(); }
     virtual void setAllUnknown() = 0;
     virtual void assign(const SymbolicValue *other) = 0;
     // Merging two symbolic values; values should form a lattice.
@@ -47,6 +81,8 @@ class SymbolicValue : public IHasDbPrint, public ICastable {
     virtual bool equals(const SymbolicValue *other) const = 0;
     // True if some parts of this value are definitely uninitialized
     virtual bool hasUninitializedParts() const = 0;
+    // A hash that is equal for values that are equal(); it may ignore parts of the value.
+    virtual size_t hash() const { return 0; }
 
     DECLARE_TYPEINFO(SymbolicValue);
 };
@@ -68,57 +104,89 @@ class SymbolicValueFactory {
     unsigned getWidth(const IR::Type *type) const;
 };
 
+/// Maps declarations to their values.  The values are persistent: a fork() of the map
+/// shares them with the original, and each of the two copies the values it modifies, and
+/// the path from the declaration to them, when it first modifies them.  Forking is therefore
+/// cheap whatever the size of the values, and merging only visits the values that differ.
 class ValueMap final : public IHasDbPrint {
+    static std::atomic<unsigned> crtOwner;
+    // The values this map may modify in place are the ones it owns.
+    mutable unsigned owner = ++crtOwner;
+
  public:
-    std::map<const IR::IDeclaration *, SymbolicValue *> map;
-    ValueMap *clone() const {
+    cow_ptr<std::map<const IR::IDeclaration *, SymbolicValue *>> map;
+    /// A copy of this map; see the class comment.
+    ValueMap *fork() const {
         auto result = new ValueMap();
-        for (auto v : map) result->map.emplace(v.first, v.second->clone());
+        result->map = map;
+        // The values are now shared: neither map may modify them without copying them.
+        owner = ++crtOwner;
         return result;
     }
-    ValueMap *filter(std::function<bool(const IR::IDeclaration *, const SymbolicValue *)> filter) {
+    ValueMap *clone() const { return fork(); }
+    ValueMap *filter(
+        std::function<bool(const IR::IDeclaration *, const SymbolicValue *)> filter) const {
         auto result = new ValueMap();
-        for (auto v : map)
-            if (filter(v.first, v.second)) result->map.emplace(v.first, v.second);
+        for (auto v : *map)
+            if (filter(v.first, v.second)) result->map.mutate().emplace(v.first, v.second);
         return result;
     }
     void set(const IR::IDeclaration *left, SymbolicValue *right) {
         CHECK_NULL(left);
         CHECK_NULL(right);
-        map[left] = right;
+        if (right->owner == 0) right->owner = owner;
+        map.mutate()[left] = right;
     }
+    /// The value of @p left, for reading.
     SymbolicValue *get(const IR::IDeclaration *left) const {
         CHECK_NULL(left);
-        return ::P4::get(map, left);
+        return ::P4::get(*map, left);
+    }
+    /// The value of @p left, which this map may modify.
+    SymbolicValue *getWritable(const IR::IDeclaration *left) {
+        CHECK_NULL(left);
+        auto value = get(left);
+        if (value == nullptr || value->owner == owner) return value;
+        return SymbolicValue::own(owner, map.mutate()[left]);
     }
 
     void dbprint(std::ostream &out) const {
         bool first = true;
-        for (auto f : map) {
+        for (auto f : *map) {
             if (!first) out << std::endl;
             out << f.first << "=>" << f.second;
             first = false;
         }
     }
+    /// Merges @p other into this map.  The values that both maps share are not visited.
     bool merge(const ValueMap *other) {
         bool change = false;
-        BUG_CHECK(map.size() == other->map.size(), "Merging incompatible maps?");
-        for (auto d : map) {
-            auto v = other->get(d.first);
+        BUG_CHECK(map->size() == other->map->size(), "Merging incompatible maps?");
+        if (map.shares(other->map)) return false;
+        for (auto d : *other->map) {
+            auto v = get(d.first);
             CHECK_NULL(v);
-            change = change || d.second->merge(v);
+            if (v == d.second) continue;
+            change = change || getWritable(d.first)->merge(d.second);
         }
         return change;
     }
     bool equals(const ValueMap *other) const {
-        BUG_CHECK(map.size() == other->map.size(), "Incompatible maps compared");
-        for (auto v : map) {
+        BUG_CHECK(map->size() == other->map->size(), "Incompatible maps compared");
+        if (map.shares(other->map)) return true;
+        for (auto v : *map) {
             auto ov = other->get(v.first);
             CHECK_NULL(ov);
-            if (!v.second->equals(ov)) return false;
+            if (v.second != ov && !v.second->equals(ov)) return false;
         }
         return true;
     }
+    /// A hash that is equal for maps that are equals().
+    size_t hash() const {
+        size_t result = 0;
+        for (auto v : *map) result = Util::hash_combine(result, v.second->hash());
+        return result;
+    }
 };
 
 class ExpressionEvaluator : public Inspector {
@@ -261,6 +329,7 @@ class ScalarValue : public SymbolicValue {
         return ValueState::NotConstant;
     }
     bool hasUninitializedParts() const override { return state == ValueState::Uninitialized; }
+    size_t hash() const override { return Util::Hash{}(static_cast<int>(state)); }
 
     DECLARE_TYPEINFO(ScalarValue, SymbolicValue);
 };
@@ -314,6 +383,10 @@ class SymbolicBool final : public ScalarValue {
     void assign(const SymbolicValue *other) override;
     bool merge(const SymbolicValue *other) override;
     bool equals(const SymbolicValue *other) const override;
+    size_t hash() const override {
+        return isKnown() ? Util::hash_combine(ScalarValue::hash(), Util::Hash{}(value))
+                         : ScalarValue::hash();
+    }
 
     DECLARE_TYPEINFO(SymbolicBool, ScalarValue);
 };
@@ -414,6 +487,10 @@ class SymbolicEnum final : public ScalarValue {
     void assign(const SymbolicValue *other) override;
     bool merge(const SymbolicValue *other) override;
     bool equals(const SymbolicValue *other) const override;
+    size_t hash() const override {
+        return isKnown() ? Util::hash_combine(ScalarValue::hash(), Util::Hash{}(value.name))
+                         : ScalarValue::hash();
+    }
 
     DECLARE_TYPEINFO(SymbolicEnum, ScalarValue);
 };
@@ -431,6 +508,8 @@ class SymbolicStruct : public SymbolicValue {
         CHECK_NULL(r);
         return r;
     }
+    // The value of 'field', which can be modified; an error if it cannot be read.
+    SymbolicValue *getWritable(const IR::Node *node, cstring field);
     void set(cstring field, SymbolicValue *value) {
         CHECK_NULL(value);
         fieldValue[field] = value;
@@ -438,10 +517,12 @@ class SymbolicStruct : public SymbolicValue {
     void dbprint(std::ostream &out) const override;
     bool isScalar() const override { return false; }
     SymbolicValue *clone() const override;
+    SymbolicValue *shallowClone() const override;
     void setAllUnknown() override;
     void assign(const SymbolicValue *other) override;
     bool merge(const SymbolicValue *other) override;
     bool equals(const SymbolicValue *other) const override;
+    size_t hash() const override;
     bool hasUninitializedParts() const override;
 
     DECLARE_TYPEINFO(SymbolicStruct, SymbolicValue);
@@ -455,12 +536,14 @@ class SymbolicHeader : public SymbolicStruct {
                    const SymbolicValueFactory *factory);
     virtual void setValid(bool v);
     SymbolicValue *clone() const override;
+    SymbolicValue *shallowClone() const override;
     SymbolicValue *get(const IR::Node *node, cstring field) const override;
     void setAllUnknown() override;
     void assign(const SymbolicValue *other) override;
     void dbprint(std::ostream &out) const override;
     bool merge(const SymbolicValue *other) override;
     bool equals(const SymbolicValue *other) const override;
+    size_t hash() const override;
 
     DECLARE_TYPEINFO(SymbolicHeader, SymbolicStruct);
 };
@@ -472,6 +555,7 @@ class SymbolicHeaderUnion : public SymbolicStruct {
                         const SymbolicValueFactory *factory);
     SymbolicBool *isValid() const;
     SymbolicValue *clone() const override;
+    SymbolicValue *shallowClone() const override;
     SymbolicValue *get(const IR::Node *node, cstring field) const override;
     void setAllUnknown() override;
     void assign(const SymbolicValue *other) override;
@@ -500,6 +584,12 @@ class SymbolicArray final : public SymbolicValue {
             return new SymbolicException(node, P4::StandardExceptions::StackOutOfBounds);
         return values.at(index);
     }
+    // The element at 'index', which can be modified.
+    SymbolicValue *getWritable(const IR::Node *node, size_t index) {
+        if (index >= values.size())
+            return new SymbolicException(node, P4::StandardExceptions::StackOutOfBounds);
+        return own(values.at(index));
+    }
     void shift(int amount);  // negative = shift left
     void set(size_t index, SymbolicHeader *value) {
         CHECK_NULL(value);
@@ -507,6 +597,7 @@ class SymbolicArray final : public SymbolicValue {
     }
     void dbprint(std::ostream &out) const override;
     SymbolicValue *clone() const override;
+    SymbolicValue *shallowClone() const override;
     SymbolicValue *next(const IR::Node *node);
     SymbolicValue *last(const IR::Node *node);
     SymbolicValue *lastIndex(const IR::Node *node);
@@ -515,6 +606,7 @@ class SymbolicArray final : public SymbolicValue {
     void assign(const SymbolicValue *other) override;
     bool merge(const SymbolicValue *other) override;
     bool equals(const SymbolicValue *other) const override;
+    size_t hash() const override;
     bool hasUninitializedParts() const override;
 
     DECLARE_TYPEINFO(SymbolicArray, SymbolicValue);
@@ -533,6 +625,7 @@ class AnyElement final : public SymbolicHeader {
         auto result = new AnyElement(parent);
         return result;
     }
+    SymbolicValue *shallowClone() const override { return clone(); }
     void setAllUnknown() override { parent->setAllUnknown(); }
     void assign(const SymbolicValue *) override { parent->setAllUnknown(); }
     void dbprint(std::ostream &out) const override { out << "Any element of " << parent; }
@@ -562,12 +655,14 @@ class SymbolicTuple final : public SymbolicValue {
         }
     }
     SymbolicValue *clone() const override;
+    SymbolicValue *shallowClone() const override;
     bool isScalar() const override { return false; }
     void setAllUnknown() override;
     void assign(const SymbolicValue *) override { BUG("%1%: tuples are read-only", this); }
     void add(SymbolicValue *value) { values.push_back(value); }
     bool merge(const SymbolicValue *other) override;
     bool equals(const SymbolicValue *other) const override;
+    size_t hash() const override;
     bool hasUninitializedParts() const override;
 
     DECLARE_TYPEINFO(SymbolicTuple, SymbolicValue);
@@ -620,6 +715,7 @@ class SymbolicPacketIn final : public SymbolicExtern {
     void advance(unsigned width) { minimumStreamOffset += width; }
     bool merge(const SymbolicValue *other) override;
     bool equals(const SymbolicValue *other) const override;
+    size_t hash() const override;
 
     DECLARE_TYPEINFO(SymbolicPacketIn, SymbolicExtern);
 };
@@ -58,6 +58,26 @@ static cstring expr_name(const IR::Expression *exp) {
     return cstring();
 }
 
+/// Collects the names an expression might refer to: exprUses(e, name) can only be true
+/// if one of them is name, or a prefix of it ending before a '.' or '['.
+class CollectUsedNames : public Inspector {
+    std::vector<cstring> &names;
+    bool preorder(const IR::Path *p) override {
+        names.push_back(p->name.name);
+        return true;
+    }
+    bool preorder(const IR::Primitive *p) override {
+        names.push_back(p->name);
+        return true;
+    }
+
+ public:
+    CollectUsedNames(const IR::Expression *e, std::vector<cstring> &names) : names(names) {
+        visitDagOnce = false;
+        e->apply(*this);
+    }
+};
+
 int DoLocalCopyPropagation::uid_ctr = 0;
 
 /* LocalCopyPropagation does copy propagation and dead code elimination within a 'block'
@@ -72,8 +92,9 @@ class DoLocalCopyPropagation::ElimDead : public Transform {
      * of the block, so it only removes those vars declared in the block */
     DoLocalCopyPropagation &self;
     const IR::Node *preorder(IR::Declaration_Variable *var) override {
-        if (auto local = ::P4::getref(self.available, var->name)) {
-            if (local->local && !local->live) {
+        int id = self.findVar(var->name);
+        if (id >= 0) {
+            if (self.local[id] && !self.live[id]) {
                 LOG3("  removing dead local " << var->name);
                 return nullptr;
             }
@@ -82,13 +103,14 @@ class DoLocalCopyPropagation::ElimDead : public Transform {
     }
     const IR::Statement *postorder(IR::BaseAssignmentStatement *as) override {
         if (auto dest = lvalue_out(as->left)->to<IR::PathExpression>()) {
-            if (auto var = ::P4::getref(self.available, dest->path->name)) {
-                if (var->local && !var->live) {
+            int id = self.findVar(dest->path->name);
+            if (id >= 0) {
+                if (self.local[id] && !self.live[id]) {
                     LOG3("  removing dead assignment to " << dest->path->name);
                     if (self.hasSideEffects(as->right, getChildContext()))
                         return makeSideEffectStatement(as->right);
                     return nullptr;
-                } else if (var->local) {
+                } else if (self.local[id]) {
                     LOG6("  not removing live assignment to " << dest->path->name);
                 } else {
                     LOG6("  not removing assignment to non-local " << dest->path->name);
@@ -187,22 +209,19 @@ void DoLocalCopyPropagation::flow_merge(Visitor &a_) {
     BUG_CHECK(working == a.working, "inconsitent DoLocalCopyPropagation state on merge");
     LOG8("flow_merge " << a.uid << " into " << uid);
     unreachable &= a.unreachable;
-    for (auto &var : available) {
-        if (auto merge = ::P4::getref(a.available, var.first)) {
-            if (merge->val != var.second.val) {
-                if (var.second.val) {
-                    LOG4("    dropping " << var.first << " = " << var.second.val
-                                         << " in flow_merge");
-                }
-                var.second.val = nullptr;
+    if (!vals.shares(a.vals)) {
+        // a value survives only if it is the same in both flows (a variable a does not
+        // track has no value there)
+        std::vector<unsigned> drop;
+        for (auto &[id, val] : *vals) {
+            if (a.getVal(id) != val) {
+                LOG4("    dropping " << vars->names[id] << " = " << val << " in flow_merge");
+                drop.push_back(id);
             }
-            if (merge->live) var.second.live = true;
-        } else {
-            if (var.second.val)
-                LOG4("    dropping " << var.first << " = " << var.second.val << " in flow_merge");
-            var.second.val = nullptr;
         }
+        for (auto id : drop) setVal(id, nullptr);
     }
+    live |= a.live & available;
     need_key_rewrite |= a.need_key_rewrite;
 }
 void DoLocalCopyPropagation::flow_copy(ControlFlowVisitor &a_) {
@@ -211,6 +230,9 @@ void DoLocalCopyPropagation::flow_copy(ControlFlowVisitor &a_) {
     LOG8("flow_copy " << a.uid << " into " << uid);
     unreachable = a.unreachable;
     available = a.available;
+    local = a.local;
+    live = a.live;
+    vals = a.vals;
     need_key_rewrite = a.need_key_rewrite;
     BUG_CHECK(inferForTable == a.inferForTable,
               "inconsistent DoLocalCopyPropagation state on copy");
@@ -220,26 +242,48 @@ bool DoLocalCopyPropagation::operator==(const ControlFlowVisitor &a_) const {
     auto &a = dynamic_cast<const DoLocalCopyPropagation &>(a_);
     BUG_CHECK(working == a.working, "inconsistent DoLocalCopyPropagation state on ==");
     if (unreachable != a.unreachable) return false;
-    auto it = a.available.begin();
-    for (auto &var : available) {
-        if (it == a.available.end()) return false;
-        if (var.first != it->first) return false;
-        if (var.second.local != it->second.local) return false;
-        if (var.second.live != it->second.live) return false;
-        if (var.second.val != it->second.val) return false;
-        ++it;
-    }
-    if (it != a.available.end()) return false;
+    if (available != a.available || local != a.local || live != a.live) return false;
+    if (!vals.shares(a.vals) && *vals != *a.vals) return false;
     if (need_key_rewrite != a.need_key_rewrite) return false;
     return true;
 }
 
-/// test to see if names denote overlapping locations
-bool DoLocalCopyPropagation::name_overlap(cstring name1, cstring name2) {
-    if (name1 == name2) return true;
-    if (name1.startsWith(name2) && strchr(".[", name1.get(name2.size()))) return true;
-    if (name2.startsWith(name1) && strchr(".[", name2.get(name1.size()))) return true;
-    return false;
+/// index of a variable tracked in the current flow, or -1 if it is not tracked
+int DoLocalCopyPropagation::findVar(cstring name) const {
+    auto it = vars->ids.find(name);
+    if (it == vars->ids.end() || !available[it->second]) return -1;
+    return it->second;
+}
+
+/// start tracking a variable in the current flow (with no value, not local, not live)
+unsigned DoLocalCopyPropagation::addVar(cstring name) {
+    auto [it, inserted] = vars->ids.emplace(name, vars->names.size());
+    if (inserted) vars->names.push_back(name);
+    available.setbit(it->second);
+    return it->second;
+}
+
+const IR::Expression *DoLocalCopyPropagation::getVal(unsigned id) const {
+    auto it = vals->find(id);
+    return it == vals->end() ? nullptr : it->second;
+}
+
+void DoLocalCopyPropagation::setVal(unsigned id, const IR::Expression *val) {
+    if (!val) {
+        if (vals->count(id)) vals.mutate().erase(id);
+        return;
+    }
+    std::vector<cstring> used;
+    CollectUsedNames(val, used);
+    for (auto name : used) vars->usedBy[name].setbit(id);
+    vals.mutate()[id] = val;
+}
+
+void DoLocalCopyPropagation::clear_available() {
+    available.clear();
+    local.clear();
+    live.clear();
+    vals = {};
 }
 
 bool DoLocalCopyPropagation::isHeaderUnionIsValid(const IR::Expression *e) {
@@ -254,47 +298,58 @@ bool DoLocalCopyPropagation::isHeaderUnionIsValid(const IR::Expression *e) {
     return false;
 }
 
+/// call fn on each tracked variable whose name denotes a location overlapping name
 void DoLocalCopyPropagation::forOverlapAvail(cstring name,
-                                             std::function<void(cstring, VarInfo *)> fn) {
+                                             std::function<void(cstring, unsigned)> fn) {
     for (const char *pfx = name.c_str(); *pfx; pfx += strspn(pfx, ".[")) {
         pfx += strcspn(pfx, ".[");
-        auto it = available.find(name.before(pfx));
-        if (it != available.end()) fn(it->first, &it->second);
+        auto it = vars->ids.find(name.before(pfx));
+        if (it != vars->ids.end() && available[it->second]) fn(it->first, it->second);
     }
-    for (auto it = available.upper_bound(name); it != available.end(); ++it) {
+    for (auto it = vars->ids.upper_bound(name); it != vars->ids.end(); ++it) {
         if (!it->first.startsWith(name) || !strchr(".[", it->first.get(name.size()))) break;
-        fn(it->first, &it->second);
+        if (available[it->second]) fn(it->first, it->second);
     }
 }
 
 void DoLocalCopyPropagation::dropValuesUsing(cstring name) {
     LOG6("dropValuesUsing(" << name << ")");
-    for (auto &var : available) {
-        LOG7("  checking " << var.first << " = " << var.second.val);
-        if (name_overlap(var.first, name)) {
-            LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << "as " << name
-                                << " is being assigned to");
-            var.second.val = nullptr;
-        } else if (var.second.val && exprUses(var.second.val, name)) {
-            LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << var.first << " as it uses "
-                                << name);
-            var.second.val = nullptr;
+    bitvec drop;
+    forOverlapAvail(name, [&](cstring vname, unsigned id) {
+        LOG4("   dropping " << (getVal(id) ? "" : "(nop) ") << vname << " as " << name
+                            << " is being assigned to");
+        drop.setbit(id);
+    });
+    // only values that refer to name or a prefix of it can use it
+    bitvec maybeUses;
+    for (const char *pfx = name.c_str(); *pfx; pfx += strspn(pfx, ".[")) {
+        pfx += strcspn(pfx, ".[");
+        if (auto *users = ::P4::getref(vars->usedBy, name.before(pfx))) maybeUses |= *users;
+    }
+    maybeUses -= drop;
+    for (auto id : maybeUses) {
+        auto val = getVal(id);
+        if (!val || !available[id]) continue;
+        LOG7("  checking " << vars->names[id] << " = " << val);
+        if (exprUses(val, name)) {
+            LOG4("   dropping " << vars->names[id] << " as it uses " << name);
+            drop.setbit(id);
         }
     }
+    for (auto id : drop) setVal(id, nullptr);
 }
 
 void DoLocalCopyPropagation::visit_local_decl(const IR::Declaration_Variable *var) {
     LOG4("Visiting " << var);
-    auto [it, inserted] = available.emplace(var->name, VarInfo());
-    BUG_CHECK(inserted, "duplicate var declaration for %s", var->name);
-    auto &local = it->second;
-    local.local = true;
+    BUG_CHECK(findVar(var->name) < 0, "duplicate var declaration for %s", var->name);
+    auto id = addVar(var->name);
+    local.setbit(id);
     if (var->initializer) {
         if (!hasSideEffects(var->initializer, getChildContext())) {
             LOG3("  saving init value for " << var->name << ": " << var->initializer);
-            local.val = var->initializer;
+            setVal(id, var->initializer);
         } else {
-            local.live = true;
+            live.setbit(id);
         }
     }
 }
@@ -332,30 +387,31 @@ const IR::Expression *DoLocalCopyPropagation::copyprop_name(cstring name,
              * read, but we can't dead-code eliminate it without eliminating the entire
              * call, so we mark it as live.  Unfortunate as we then won't dead-code
              * remove other assignmnents. */
-            forOverlapAvail(name, [name](cstring, VarInfo *var) {
+            forOverlapAvail(name, [this, name](cstring, unsigned id) {
                 LOG4("  using " << name << " in read-write");
-                var->live = true;
+                live.setbit(id);
             });
             if (inferForFunc) inferForFunc->reads.insert(name);
         }
         return nullptr;
     }
-    if (auto var = ::P4::getref(available, name)) {
-        if (var->val) {
-            if (policy(getChildContext(), var->val)) {
-                LOG3("  propagating value for " << name << ": " << var->val);
+    int id = findVar(name);
+    if (id >= 0) {
+        if (auto val = getVal(id)) {
+            if (policy(getChildContext(), val)) {
+                LOG3("  propagating value for " << name << ": " << val);
                 CopySrcInfo copy(srcInfo);
-                return var->val->apply(copy);
+                return val->apply(copy);
             }
-            LOG3("  policy rejects propagation of " << name << ": " << var->val);
+            LOG3("  policy rejects propagation of " << name << ": " << val);
         } else {
             LOG4("  using " << name << " with no propagated value");
         }
-        var->live = true;
+        live.setbit(id);
     }
-    forOverlapAvail(name, [name](cstring, VarInfo *var) {
+    forOverlapAvail(name, [this, name](cstring, unsigned id) {
         LOG4("  using part of " << name);
-        var->live = true;
+        live.setbit(id);
     });
     if (inferForFunc) inferForFunc->reads.insert(name);
     return nullptr;
@@ -433,7 +489,7 @@ IR::AssignmentStatement *DoLocalCopyPropagation::postorder(IR::AssignmentStateme
                 return as;
             }
             LOG3("  saving value for " << dest << ": " << as->right);
-            available[dest].val = as->right;
+            setVal(addVar(dest), as->right);
         } else {
             LOG3("Can't copyprop " << as->right << " due to side effects");
         }
@@ -548,9 +604,9 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
             } else if (mem->expr->type->is<IR::Type_Header>() ||
                        mem->expr->type->is<IR::Type_HeaderUnion>()) {
                 if (mem->member == "isValid") {
-                    forOverlapAvail(obj, [obj](cstring, VarInfo *var) {
+                    forOverlapAvail(obj, [this, obj](cstring, unsigned id) {
                         LOG4("  using " << obj << " (isValid)");
-                        var->live = true;
+                        live.setbit(id);
                     });
                     if (inferForFunc) inferForFunc->reads.insert(obj);
                 } else {
@@ -565,9 +621,9 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
                 BUG_CHECK(mem->member == "push_front" || mem->member == "pop_front",
                           "Unexpected stack method %s", mem->member);
                 dropValuesUsing(obj);
-                forOverlapAvail(obj, [obj](cstring, VarInfo *var) {
+                forOverlapAvail(obj, [this, obj](cstring, unsigned id) {
                     LOG4("  using " << obj << " (push/pop)");
-                    var->live = true;
+                    live.setbit(id);
                 });
                 if (inferForFunc) {
                     inferForFunc->reads.insert(obj);
@@ -590,15 +646,14 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
         }
     }
     LOG3("unknown method call " << mc->method << " clears all nonlocal saved values");
-    for (auto &var : available) {
-        if (!var.second.local) {
-            LOG7("    may access non-local " << var.first);
-            var.second.val = nullptr;
-            var.second.live = true;
-            if (inferForFunc) {
-                inferForFunc->reads.insert(var.first);
-                inferForFunc->writes.insert(var.first);
-            }
+    bitvec nonlocal = available - local;
+    for (auto id : nonlocal) {
+        LOG7("    may access non-local " << vars->names[id]);
+        setVal(id, nullptr);
+        live.setbit(id);
+        if (inferForFunc) {
+            inferForFunc->reads.insert(vars->names[id]);
+            inferForFunc->writes.insert(vars->names[id]);
         }
     }
     return mc;
@@ -669,11 +724,10 @@ void DoLocalCopyPropagation::LoopPrepass::postorder(const IR::MethodCallExpressi
         }
     }
     LOG3("loop prepass unknown method call " << mc->method << " clears all nonlocal saved values");
-    for (auto &var : self.available) {
-        if (!var.second.local) {
-            LOG7("    may access non-local " << var.first);
-            var.second.val = nullptr;
-        }
+    bitvec nonlocal = self.available - self.local;
+    for (auto id : nonlocal) {
+        LOG7("    may access non-local " << self.vars->names[id]);
+        self.setVal(id, nullptr);
     }
     return;
 }
@@ -694,7 +748,7 @@ IR::P4Action *DoLocalCopyPropagation::postorder(IR::P4Action *act) {
     BUG_CHECK(inferForFunc == &(*actions)[act->name], "corrupt internal data struct");
     act->body = act->body->apply(ElimDead(*this), getChildContext())->to<IR::BlockStatement>();
     working = false;
-    available.clear();
+    clear_available();
     LOG3("DoLocalCopyPropagation finished action " << act->name);
     LOG4("reads=" << inferForFunc->reads << " writes=" << inferForFunc->writes);
     LOG4(act);
@@ -730,7 +784,7 @@ IR::Function *DoLocalCopyPropagation::postorder(IR::Function *fn) {
     BUG_CHECK(inferForFunc == &(*methods)[name], "corrupt internal data struct");
     fn->body = fn->body->apply(ElimDead(*this), getChildContext())->to<IR::BlockStatement>();
     working = false;
-    available.clear();
+    clear_available();
     LOG3("DoLocalCopyPropagation finished function " << name);
     LOG4("reads=" << inferForFunc->reads << " writes=" << inferForFunc->writes);
     LOG4(fn);
@@ -775,7 +829,7 @@ IR::P4Control *DoLocalCopyPropagation::preorder(IR::P4Control *ctrl) {
     ctrl->controlLocals = *ctrl->controlLocals.apply(ElimDead(*this), getChildContext());
     ctrl->body = ctrl->body->apply(ElimDead(*this), getChildContext())->to<IR::BlockStatement>();
     working = false;
-    available.clear();
+    clear_available();
     LOG3("DoLocalCopyPropagation finished control " << ctrl->name);
     LOG4(ctrl);
     prune();
@@ -787,7 +841,7 @@ void DoLocalCopyPropagation::apply_function(DoLocalCopyPropagation::FuncInfo *ac
     ++act->apply_count;
     for (auto write : act->writes) dropValuesUsing(write);
     for (auto read : act->reads)
-        forOverlapAvail(read, [](cstring, VarInfo *var) { var->live = true; });
+        forOverlapAvail(read, [this](cstring, unsigned id) { live.setbit(id); });
     if (inferForFunc) {
         inferForFunc->writes.insert(act->writes.begin(), act->writes.end());
         inferForFunc->reads.insert(act->reads.begin(), act->reads.end());
@@ -803,55 +857,56 @@ void DoLocalCopyPropagation::apply_table(DoLocalCopyPropagation::TableInfo *tbl)
     ++tbl->apply_count;
     std::unordered_set<cstring> remaps_seen;
     for (auto key : tbl->keyreads) {
-        forOverlapAvail(key, [&remaps_seen, key, tbl, this](cstring vname, VarInfo *var) {
+        forOverlapAvail(key, [&remaps_seen, key, tbl, this](cstring vname, unsigned id) {
+            auto val = getVal(id);
             remaps_seen.insert(vname);
-            if (var->val && lvalue_out(var->val)->is<IR::PathExpression>()) {
+            if (val && lvalue_out(val)->is<IR::PathExpression>()) {
                 if (tbl->apply_count > 1 &&
-                    (!tbl->key_remap.count(vname) || !tbl->key_remap.at(vname)->equiv(*var->val))) {
+                    (!tbl->key_remap.count(vname) || !tbl->key_remap.at(vname)->equiv(*val))) {
                     LOG3("  different values used in different applies for key " << key);
                     tbl->key_remap.erase(vname);
-                    var->live = true;
-                } else if (policy(getChildContext(), var->val)) {
-                    LOG3("  will propagate value into table key " << vname << ": " << var->val);
-                    tbl->key_remap.emplace(vname, var->val);
+                    live.setbit(id);
+                } else if (policy(getChildContext(), val)) {
+                    LOG3("  will propagate value into table key " << vname << ": " << val);
+                    tbl->key_remap.emplace(vname, val);
                     need_key_rewrite = true;
                 } else {
                     LOG3("  policy prevents propagation of value into table key " << vname << ": "
-                                                                                  << var->val);
-                    var->live = true;
+                                                                                  << val);
+                    live.setbit(id);
                 }
-            } else if (var->val && lvalue_out(var->val)->is<IR::MethodCallExpression>()) {
-                if (hasSideEffects(lvalue_out(var->val), getChildContext())) {
+            } else if (val && lvalue_out(val)->is<IR::MethodCallExpression>()) {
+                if (hasSideEffects(lvalue_out(val), getChildContext())) {
                     LOG3("  cannot propagate expression with side effect into table key "
-                         << vname << ": " << var->val);
-                    var->live = true;
-                } else if (isHeaderUnionIsValid(lvalue_out(var->val))) {
+                         << vname << ": " << val);
+                    live.setbit(id);
+                } else if (isHeaderUnionIsValid(lvalue_out(val))) {
                     // isValid() on a header union must be handled by the flattenHeaderUnion
                     // pass to lower it to isValid() on a header. Therefore we cannot propagate
                     // it into a table key.
                     LOG3("  cannot propagate isValid() for header union into table key "
-                         << vname << ": " << var->val);
-                    var->live = true;
+                         << vname << ": " << val);
+                    live.setbit(id);
                 } else if (tbl->apply_count > 1 && (!tbl->key_remap.count(vname) ||
-                                                    !tbl->key_remap.at(vname)->equiv(*var->val))) {
+                                                    !tbl->key_remap.at(vname)->equiv(*val))) {
                     LOG3("  different values used in different applies for key " << key);
                     tbl->key_remap.erase(vname);
-                    var->live = true;
-                } else if (policy(getChildContext(), var->val)) {
-                    LOG3("  will propagate value into table key " << vname << ": " << var->val);
-                    tbl->key_remap.emplace(vname, var->val);
+                    live.setbit(id);
+                } else if (policy(getChildContext(), val)) {
+                    LOG3("  will propagate value into table key " << vname << ": " << val);
+                    tbl->key_remap.emplace(vname, val);
                     need_key_rewrite = true;
                 } else {
                     LOG3("  policy prevents propagation of value into table key " << vname << ": "
-                                                                                  << var->val);
-                    var->live = true;
+                                                                                  << val);
+                    live.setbit(id);
                 }
             } else {
                 tbl->key_remap.erase(key);
                 LOG4("  table using "
                      << key << " with "
-                     << (var->val ? "value too complex for key" : "no propagated value"));
-                var->live = true;
+                     << (val ? "value too complex for key" : "no propagated value"));
+                live.setbit(id);
             }
         });
     }
@@ -896,7 +951,7 @@ const IR::P4Parser *DoLocalCopyPropagation::postorder(IR::P4Parser *parser) {
     for (auto *state : parser->states) apply_function(&(*states)[state->name]);
     auto *rv = parser->apply(ElimDead(*this), getChildContext());
     working = false;
-    available.clear();
+    clear_available();
     return rv;
 }
 
@@ -917,7 +972,7 @@ IR::ParserState *DoLocalCopyPropagation::postorder(IR::ParserState *state) {
     state->components = *state->components.apply(ElimDead(*this), getChildContext());
     working = false;
     inferForFunc = nullptr;
-    available.clear();
+    clear_available();
     LOG3("DoLocalCopyPropagation finished parser state " << state->name);
     LOG4(state);
     return state;
@@ -929,7 +984,8 @@ void DoLocalCopyPropagation::end_apply(const IR::Node *node) {
     uid = uid_ctr = 0;  // reset uids
 
     // clear maps
-    available.clear();
+    clear_available();
+    *vars = VarIndex();
     tables->clear();
     actions->clear();
     methods->clear();
@@ -16,11 +16,15 @@ limitations under the License.
 #ifndef MIDEND_LOCAL_COPYPROP_H_
 #define MIDEND_LOCAL_COPYPROP_H_
 
+#include <unordered_map>
+
 #include "frontends/common/resolveReferences/resolveReferences.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
 #include "has_side_effects.h"
 #include "ir/ir.h"
 #include "ir/visitor.h"
+#include "lib/bitvec.h"
+#include "lib/cow_ptr.h"
 
 namespace P4 {
 
@@ -56,10 +60,14 @@ class DoLocalCopyPropagation : public ControlFlowVisitor,
                                ResolutionContext {
     TypeMap *typeMap;
     bool working = false;
-    struct VarInfo {
-        bool local = false;
-        bool live = false;
-        const IR::Expression *val = nullptr;
+    /// Dense numbering of the variables (and fields) tracked by the pass, shared by all
+    /// the flow clones, so that the per-flow state can be bitvecs indexed by it.
+    struct VarIndex {
+        std::map<cstring, unsigned> ids;  // ordered, for forOverlapAvail
+        std::vector<cstring> names;
+        /// For each name, the variables that have been given a value that may refer to it.
+        /// Only an over-approximation, to limit the values dropValuesUsing checks.
+        std::unordered_map<cstring, bitvec> usedBy;
     };
     struct TableInfo {
         std::set<cstring> keyreads, actions;
@@ -76,7 +84,11 @@ class DoLocalCopyPropagation : public ControlFlowVisitor,
         /// values on the left and the right side, the assignment becomes a self-assignment
         bool is_first_write_insert = false;
     };
-    std::map<cstring, VarInfo> available;
+    std::shared_ptr<VarIndex> vars;
+    /// The variables tracked in the current flow, and which of them are local to the
+    /// block and live.  The values are shared between flows until one of them changes.
+    bitvec available, local, live;
+    cow_ptr<std::map<unsigned, const IR::Expression *>> vals;
     std::shared_ptr<std::map<cstring, TableInfo>> tables;
     std::shared_ptr<std::map<cstring, FuncInfo>> actions;
     std::shared_ptr<std::map<cstring, FuncInfo>> methods;
@@ -98,8 +110,12 @@ class DoLocalCopyPropagation : public ControlFlowVisitor,
     void flow_merge(Visitor &) override;
     void flow_copy(ControlFlowVisitor &) override;
     bool operator==(const ControlFlowVisitor &) const override;
-    bool name_overlap(cstring, cstring);
-    void forOverlapAvail(cstring, std::function<void(cstring, VarInfo *)>);
+    int findVar(cstring) const;
+    unsigned addVar(cstring);
+    const IR::Expression *getVal(unsigned) const;
+    void setVal(unsigned, const IR::Expression *);
+    void clear_available();
+    void forOverlapAvail(cstring, std::function<void(cstring, unsigned)>);
     void dropValuesUsing(cstring);
     bool hasSideEffects(const IR::Expression *e, const Visitor::Context *ctxt) {
         return bool(::P4::hasSideEffects(typeMap, e, ctxt));
@@ -154,6 +170,7 @@ class DoLocalCopyPropagation : public ControlFlowVisitor,
                            std::function<bool(const Context *, const IR::Expression *)> policy,
                            bool eut)
         : typeMap(typeMap),
+          vars(std::make_shared<VarIndex>()),
           tables(std::make_shared<std::map<cstring, TableInfo>>()),
           actions(std::make_shared<std::map<cstring, FuncInfo>>()),
           methods(std::make_shared<std::map<cstring, FuncInfo>>()),
@@ -402,13 +402,13 @@ class ParserSymbolicInterpreter {
         return result;
     }
 
+    /// The @p values are not copied: they must not be modified once the state is created.
     ParserStateInfo *newStateInfo(const ParserStateInfo *predecessor, cstring stateName,
-                                  ValueMap *values, size_t index) {
+                                  const ValueMap *values, size_t index) {
         if (stateName == IR::ParserState::accept || stateName == IR::ParserState::reject)
             return nullptr;
         auto state = structure->get(stateName);
-        auto pi =
-            new ParserStateInfo(stateName, parser, state, predecessor, values->clone(), index);
+        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values, index);
         synthesizedParser->add(pi);
         return pi;
     }
@@ -608,6 +608,7 @@ class ParserSymbolicInterpreter {
     static bool headerValidityChanged(const SymbolicValue *first, const SymbolicValue *second) {
         CHECK_NULL(first);
         CHECK_NULL(second);
+        if (first == second) return false;
         if (first->is<SymbolicHeader>()) {
             auto fhdr = first->to<SymbolicHeader>();
             auto shdr = second->to<SymbolicHeader>();
@@ -637,7 +638,7 @@ class ParserSymbolicInterpreter {
 
     /// True if any header has changed its "validity" bit
     static bool headerValidityChange(const ValueMap *before, const ValueMap *after) {
-        for (auto v : before->map) {
+        for (auto v : *before->map) {
             auto value = v.second;
             if (headerValidityChanged(value, after->get(v.first))) return true;
         }
@@ -673,7 +674,7 @@ class ParserSymbolicInterpreter {
                 auto packets = state->before->filter(filter);
                 auto prevPackets = crt->before->filter(filter);
                 if (packets->equals(prevPackets)) {
-                    for (auto p : state->before->map) {
+                    for (auto p : *state->before->map) {
                         if (p.second->is<SymbolicPacketIn>()) {
                             auto pkt = p.second->to<SymbolicPacketIn>();
                             if (pkt->isConservative()) {
@@ -725,7 +726,6 @@ class ParserSymbolicInterpreter {
     EvaluationStateResult evaluateState(ParserStateInfo *state,
                                         std::unordered_set<cstring> &newStates) {
         LOG1("Analyzing " << dbp(state->state));
-        auto valueMap = state->before->clone();
         IR::IndexedVector<IR::StatOrDecl> components;
         IR::ID newName;
         if (unroll) {
@@ -735,6 +735,7 @@ class ParserSymbolicInterpreter {
             }
             newStates.insert(newName);
         }
+        auto valueMap = state->before->clone();
         for (auto s : state->state->components) {
             auto *newComponent = executeStatement(state, s, valueMap);
             if (!newComponent) {
@@ -762,6 +763,32 @@ class ParserSymbolicInterpreter {
         return EvaluationStateResult(result.first, true, components);
     }
 
+    /// Hash of the name, header stack indexes and values of a state, for #evaluated.
+    static size_t symbolicStateHash(const ParserStateInfo *state) {
+        size_t indexes = 0;
+        // The order of an unordered map is unspecified, so its elements are hashed
+        // independently of each other.
+        for (const auto &i : state->statesIndexes)
+            indexes += Util::hash_combine(StackVariableHash{}(i.first), Util::Hash{}(i.second));
+        return Util::Hash{}(state->state->name.name, indexes, state->before->hash());
+    }
+
+    /// True if a state with the same name, header stack indexes and values as @p state was
+    /// already unrolled.  Evaluating @p state again would produce the same successors.
+    bool wasEvaluated(const ParserStateInfo *state, size_t hash) const {
+        auto range = evaluated.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            const auto *other = it->second;
+            if (other->state == state->state && other->statesIndexes == state->statesIndexes &&
+                other->before->equals(state->before))
+                return true;
+        }
+        return false;
+    }
+
+    /// The states that were unrolled without reaching a loop, by symbolicStateHash().
+    std::unordered_multimap<size_t, const ParserStateInfo *> evaluated;
+
  public:
     bool hasOutOfboundState;
     /// constructor
@@ -821,6 +848,14 @@ class ParserSymbolicInterpreter {
                 !stateInfo->scenarioStates.count(stateInfo->name) &&
                 !structure->reachableHSUsage(stateInfo->state->name, stateInfo))
                 continue;
+            // A state that was unrolled already with the same values produces nothing new:
+            // its successors were explored when it was first reached.
+            IR::ID newName = getNewName(stateInfo);
+            size_t hash = symbolicStateHash(stateInfo);
+            if (newStates.count(newName) && wasEvaluated(stateInfo, hash)) {
+                LOG1("Already evaluated " << newName);
+                continue;
+            }
             auto iHSNames = structure->statesWithHeaderStacks.find(stateInfo->name);
             if (iHSNames != structure->statesWithHeaderStacks.end())
                 stateInfo->scenarioHS.insert(iHSNames->second.begin(), iHSNames->second.end());
@@ -830,7 +865,6 @@ class ParserSymbolicInterpreter {
             if (infLoop) {
                 // Stop unrolling if it was an error.
                 if (wasError) {
-                    IR::ID newName = getNewName(stateInfo);
                     if (newStates.count(newName) != 0) {
                         evaluateState(stateInfo, newStates);
                     }
@@ -842,9 +876,9 @@ class ParserSymbolicInterpreter {
                 addOutOfBound(stateInfo, newStates);
                 continue;
             }
-            IR::ID newName = getNewName(stateInfo);
             bool notAdded = newStates.count(newName) == 0;
             auto nextStates = evaluateState(stateInfo, newStates);
+            if (notAdded) evaluated.emplace(hash, stateInfo);
             if (get<0>(nextStates) == nullptr) {
                 if (get<1>(nextStates) && stateInfo->predecessor &&
                     newName.name != stateInfo->predecessor->newState->name) {
@@ -77,7 +77,7 @@ struct ParserStateInfo {
     const IR::P4Parser *parser;
     const IR::ParserState *state;        // original state this is produced from
     const ParserStateInfo *predecessor;  // how we got here in the symbolic evaluation
-    ValueMap *before;
+    const ValueMap *before;              // shared with the other successors of predecessor
     ValueMap *after;
     IR::ParserState *newState;  // pointer to a new state
     size_t currentIndex;
@@ -87,7 +87,7 @@ struct ParserStateInfo {
     std::unordered_set<cstring> scenarioHS;    // scenario header stack's operations
     StackVariableIndexMap substitutedIndexes;  // values of the evaluated indexes
     ParserStateInfo(cstring name, const IR::P4Parser *parser, const IR::ParserState *state,
-                    const ParserStateInfo *predecessor, ValueMap *before, size_t index)
+                    const ParserStateInfo *predecessor, const ValueMap *before, size_t index)
         : name(name),
           parser(parser),
           state(state),
@@ -64,6 +64,9 @@ class SimplifyBitwise : public Transform {
     void assignSlices(const IR::Expression *expr, big_int mask);
 
  public:
+    SimplifyBitwise *clone() const override { return new SimplifyBitwise(*this); }
+    bool perDeclarationSafe() const override { return true; }
+
     const IR::Node *preorder(IR::BaseAssignmentStatement *as) override;
     const IR::Node *preorder(IR::OpAssignmentStatement *as) override { return as; }
     const IR::Node *preorder(IR::BAndAssign *as) override {
@@ -0,0 +1,158 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "lib/arena.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "ir/ir.h"
+#include "lib/gc.h"
+
+namespace P4::Test {
+
+TEST(Arena, AllocationsAreAlignedAndDisjoint) {
+    Util::Arena arena;
+    std::set<uintptr_t> seen;
+    for (size_t size = 0; size < 300; ++size) {
+        auto addr = reinterpret_cast<uintptr_t>(arena.allocate(size));
+        EXPECT_EQ(addr % Util::Arena::alignment, 0U);
+        EXPECT_TRUE(seen.insert(addr).second);
+        EXPECT_TRUE(arena.contains(reinterpret_cast<void *>(addr)));
+    }
+    int local = 0;
+    EXPECT_FALSE(arena.contains(&local));
+}
+
+TEST(Arena, BigAllocationsGetTheirOwnChunk) {
+    Util::Arena arena;
+    auto *small = static_cast<char *>(arena.allocate(16));
+    auto *big = static_cast<char *>(arena.allocate(Util::Arena::chunkSize));
+    EXPECT_TRUE(arena.contains(big + Util::Arena::chunkSize - 1));
+    // The small allocations keep going in the first chunk.
+    auto *next = static_cast<char *>(arena.allocate(16));
+    EXPECT_EQ(next, small + 16);
+    EXPECT_EQ(arena.stats().chunks, 2U);
+}
+
+TEST(Arena, CleanupsRunNewestFirst) {
+    std::vector<int> order;
+    static std::vector<int> *log;
+    log = &order;
+    int values[3] = {0, 1, 2};
+    {
+        Util::Arena arena;
+        auto record = [](void *v) { log->push_back(*static_cast<int *>(v)); };
+        for (auto &v : values) arena.atRelease(record, &v);
+        arena.atRelease(record, &values[0])->fn = nullptr;  // cancelled
+        EXPECT_EQ(arena.stats().cleanups, 4U);
+        EXPECT_TRUE(order.empty());
+    }
+    EXPECT_EQ(order, (std::vector<int>{2, 1, 0}));
+}
+
+TEST(Arena, ConcurrentAllocation) {
+    if (!gc_allow_threads()) GTEST_SKIP() << "the garbage collector does not support threads";
+    Util::Arena arena;
+    std::vector<std::vector<int *>> results(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&arena, &results, t]() {
+            gc_register_thread();
+            for (int i = 0; i < 100000; ++i) {
+                auto *p = static_cast<int *>(arena.allocate(sizeof(int) * (1 + i % 7)));
+                *p = t;
+                results[t].push_back(p);
+            }
+            gc_unregister_thread();
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    for (int t = 0; t < 4; ++t)
+        for (auto *p : results[t]) ASSERT_EQ(*p, t);
+}
+
+TEST(Arena, ScopeAndSuspend) {
+    EXPECT_EQ(Util::Arena::current(), nullptr);
+    Util::Arena arena;
+    {
+        Util::Arena::Scope scope(arena);
+        EXPECT_EQ(Util::Arena::current(), &arena);
+        {
+            Util::Arena::Suspend suspend;
+            EXPECT_EQ(Util::Arena::current(), nullptr);
+        }
+        EXPECT_EQ(Util::Arena::current(), &arena);
+    }
+    EXPECT_EQ(Util::Arena::current(), nullptr);
+}
+
+#if HAVE_IR_ARENA
+TEST(Arena, IRNodes) {
+    const IR::Type_Bits *cached = nullptr;
+    const IR::Node *node = nullptr;
+    {
+        Util::Arena arena;
+        Util::Arena::Scope scope(arena);
+        node = new IR::Add(new IR::Constant(1), new IR::Constant(2));
+        EXPECT_TRUE(arena.contains(node));
+        // Cached types outlive the compilation.
+        cached = IR::Type_Bits::get(17);
+        EXPECT_FALSE(arena.contains(cached));
+        // At least the three nodes above, each destroyed when the arena goes away.
+        EXPECT_GE(arena.stats().cleanups, 3U);
+    }
+    EXPECT_EQ(IR::Type_Bits::get(17), cached);
+    EXPECT_EQ(cached->width_bits(), 17);
+}
+
+// Only prints timings; run with --gtest_also_run_disabled_tests.
+TEST(Arena, DISABLED_IRNodeAllocationBenchmark) {
+    constexpr int count = 1000000;
+    auto build = []() {
+        const IR::Expression *expr = new IR::Constant(0);
+        for (int i = 1; i < count; ++i) expr = new IR::Add(expr, new IR::PathExpression("x"));
+        return expr;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    build();
+    auto heap = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    size_t reserved = 0;
+    {
+        Util::Arena arena;
+        Util::Arena::Scope scope(arena);
+        build();
+        reserved = arena.stats().reserved;
+    }
+    auto inArena = std::chrono::steady_clock::now() - start;
+
+    using std::chrono::milliseconds;
+    std::cout << "building " << 2 * count << " nodes: heap "
+              << std::chrono::duration_cast<milliseconds>(heap).count() << "ms, arena "
+              << std::chrono::duration_cast<milliseconds>(inArena).count()
+              << "ms including release (" << reserved / (1024 * 1024) << "MB)" << std::endl;
+}
+#endif /* HAVE_IR_ARENA */
+
+}  // namespace P4::Test
@@ -0,0 +1,105 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#include "ir/binary_ir.h"
+#include "ir/ir.h"
+#include "ir/json_generator.h"
+#include "ir/json_loader.h"
+
+namespace P4::Test {
+
+namespace {
+
+std::string toJSON(const IR::Node *node) {
+    std::stringstream ss;
+    JSONGenerator(ss, true).emit(node);
+    return ss.str();
+}
+
+const IR::Node *load(std::stringstream &ss) {
+    const IR::Node *node = nullptr;
+    JSONLoader(ss) >> node;
+    return node;
+}
+
+}  // namespace
+
+TEST(BinaryIR, RoundTrip) {
+    const auto *c = new IR::Constant(IR::Type_Bits::get(16), 5);
+    const auto *big = new IR::Constant(big_int("123456789012345678901234567890"));
+    const auto *e = new IR::Add(new IR::Mul(c, c), new IR::Sub(big, new IR::PathExpression("x")));
+
+    std::stringstream ss;
+    JSONGenerator(ss, true, true).emit(e);
+    EXPECT_TRUE(BinaryIR::isBinary(ss));
+    const auto *copy = load(ss);
+    ASSERT_TRUE(copy);
+    EXPECT_TRUE(e->equiv(*copy));
+    EXPECT_EQ(toJSON(e), toJSON(copy));
+
+    // The shared constant is loaded once.
+    const auto *mul = copy->to<IR::Add>()->left->to<IR::Mul>();
+    ASSERT_TRUE(mul);
+    EXPECT_EQ(mul->left, mul->right);
+}
+
+TEST(BinaryIR, Malformed) {
+    std::stringstream ss;
+    JSONGenerator(ss, false, true).emit(new IR::PathExpression("x"));
+    auto data = ss.str();
+    ASSERT_TRUE(BinaryIR::read(data));
+    for (size_t i = 0; i < data.size(); ++i)
+        EXPECT_FALSE(BinaryIR::read(std::string_view(data).substr(0, i))) << i;
+    data[BinaryIR::magic.size()]++;  // version
+    EXPECT_FALSE(BinaryIR::read(data));
+}
+
+// Compares sizes and timings of the two encodings; disabled since it checks nothing that
+// RoundTrip does not.
+TEST(BinaryIR, DISABLED_Benchmark) {
+    constexpr int count = 20000;
+    auto *program = new IR::Vector<IR::Node>;
+    for (int i = 0; i < count; ++i) {
+        auto *lhs = new IR::Member(new IR::PathExpression("hdr"), "f" + std::to_string(i % 64));
+        auto *rhs = new IR::Add(lhs, new IR::Constant(IR::Type_Bits::get(32), i));
+        program->push_back(new IR::AssignmentStatement(lhs, rhs));
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    for (bool binary : {false, true}) {
+        std::stringstream ss;
+        auto start = Clock::now();
+        JSONGenerator(ss, true, binary).emit(program);
+        auto store = Clock::now() - start;
+        auto size = ss.str().size();
+        start = Clock::now();
+        const auto *copy = load(ss);
+        auto loadTime = Clock::now() - start;
+        ASSERT_TRUE(copy);
+        EXPECT_TRUE(program->equiv(*copy));
+        std::cout << (binary ? "binary" : "JSON") << ": " << size / 1024 << "KB, store "
+                  << ms(store) << "ms, load " << ms(loadTime) << "ms" << std::endl;
+    }
+}
+
+}  // namespace P4::Test
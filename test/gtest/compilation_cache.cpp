@@ -0,0 +1,77 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include "frontends/common/compilationCache.h"
+#include "frontends/common/parseInput.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "ir/pass_manager.h"
+
+namespace P4::Test {
+
+namespace {
+
+const IR::P4Program *parse(int width) {
+    std::string program = P4_SOURCE(R"(
+        const bit<8> c = 8w1;
+        header h { bit<8> f; }
+    )");
+    program += "const bit<" + std::to_string(width) + "> d = 0;\n";
+    return P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+}
+
+}  // namespace
+
+using CompilationCacheTest = P4CTest;
+
+TEST_F(CompilationCacheTest, StructuralHash) {
+    const auto *first = parse(16);
+    const auto *second = parse(16);
+    const auto *other = parse(32);
+    ASSERT_TRUE(first && second && other);
+    EXPECT_EQ(structuralHash(first), structuralHash(second));
+    EXPECT_NE(structuralHash(first), structuralHash(other));
+    // Only the last declaration differs.
+    EXPECT_EQ(structuralHash(first->objects.front()), structuralHash(other->objects.front()));
+    EXPECT_NE(structuralHash(first->objects.back()), structuralHash(other->objects.back()));
+}
+
+TEST_F(CompilationCacheTest, StoreAndLoad) {
+    auto dir = std::filesystem::temp_directory_path() / "p4c-compilation-cache-test";
+    std::filesystem::remove_all(dir);
+    CompilationCache cache(dir);
+    ASSERT_TRUE(cache.enabled());
+    EXPECT_FALSE(CompilationCache(std::filesystem::path()).enabled());
+
+    const auto *program = parse(16);
+    ASSERT_TRUE(program);
+    PassManager pipeline({});
+    CompilerOptions options;
+    auto key = CompilationCache::key(program, pipeline, options);
+    EXPECT_EQ(key, CompilationCache::key(parse(16), pipeline, options));
+    EXPECT_NE(key, CompilationCache::key(parse(32), pipeline, options));
+
+    EXPECT_EQ(cache.load(key), nullptr);
+    cache.store(key, program);
+    const auto *loaded = cache.load(key);
+    ASSERT_TRUE(loaded);
+    EXPECT_TRUE(program->equiv(*loaded));
+    std::filesystem::remove_all(dir);
+}
+
+}  // namespace P4::Test
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "helpers.h"
 #include "ir/ir.h"
+#include "lib/big_int_util.h"
 
 namespace P4::Test {
 
@@ -142,4 +143,29 @@ TEST_F(ConstantExpr, TestIntegerFuncs) {
     EXPECT_EQ(neg_res.asInt(), -123);
 }
 
+TEST_F(ConstantExpr, TestToInt64) {
+    EXPECT_EQ(Util::toInt64(big_int(0)), 0);
+    EXPECT_EQ(Util::toInt64(big_int(-5)), -5);
+    EXPECT_EQ(Util::toInt64(big_int(INT64_MAX)), INT64_MAX);
+    EXPECT_EQ(Util::toInt64(big_int(INT64_MIN)), INT64_MIN);
+    EXPECT_EQ(Util::toInt64(big_int(INT64_MAX) + 1), std::nullopt);
+    EXPECT_EQ(Util::toInt64(big_int(INT64_MIN) - 1), std::nullopt);
+    EXPECT_EQ(Util::toInt64(big_int(1) << 100), std::nullopt);
+}
+
+TEST_F(ConstantExpr, TestOverflow) {
+    // Values that fit are kept; the others wrap around as before.
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(8), 255, 10, true).value, 255);
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(8), 256, 10, true).value, 0);
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(8), -1, 10, true).value, 255);
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(8, true), 127, 10, true).value, 127);
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(8, true), -128, 10, true).value, -128);
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(8, true), 128, 10, true).value, -128);
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(63, true), INT64_MIN, 10, true).value, 0);
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(64), -1, 10, true).value, big_int(UINT64_MAX));
+    big_int large = (big_int(1) << 100) + 3;
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(128), large, 10, true).value, large);
+    EXPECT_EQ(IR::Constant(IR::Type_Bits::get(4), large, 10, true).value, 3);
+}
+
 }  // namespace P4::Test
@@ -0,0 +1,146 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/// Compares the insertion ordered containers on the operations the analyses use
+/// most: building many small sets, looking keys up, and walking them in order.
+/// The timing tests are disabled; run them with --gtest_also_run_disabled_tests.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "lib/hvec_map.h"
+#include "lib/hvec_set.h"
+#include "lib/ordered_map.h"
+#include "lib/ordered_set.h"
+
+namespace P4::Test {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+}
+
+/// Pointer-like keys, in a random order, as the analyses' keys are.
+std::vector<const int *> makeKeys(size_t count) {
+    static std::vector<int> storage(1 << 20);
+    std::vector<const int *> keys;
+    for (size_t i = 0; i < count; ++i) keys.push_back(&storage[i % storage.size()]);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+    return keys;
+}
+
+/// Builds @p sets sets of @p size keys each, joins neighbouring sets, and looks up
+/// every key, like a def-use analysis does with its location sets.
+/// @return a checksum of the keys seen, in iteration order.
+template <class Set>
+size_t setWorkload(const std::vector<const int *> &keys, size_t sets, size_t size) {
+    std::vector<Set> built(sets);
+    for (size_t i = 0; i < sets; ++i)
+        for (size_t j = 0; j < size; ++j) built[i].insert(keys[(i * 7 + j * 13) % keys.size()]);
+    size_t checksum = 0, position = 0;
+    for (size_t i = 0; i + 1 < sets; ++i) {
+        Set joined(built[i]);
+        for (const auto *key : built[i + 1]) joined.insert(key);
+        for (const auto *key : joined) {
+            checksum += ++position * (key - keys.front()) * joined.count(key);
+        }
+    }
+    return checksum;
+}
+
+template <class Map>
+size_t mapWorkload(const std::vector<const int *> &keys, size_t rounds) {
+    size_t checksum = 0, position = 0;
+    for (size_t round = 0; round < rounds; ++round) {
+        Map map;
+        for (size_t i = 0; i < keys.size(); ++i) map[keys[i]] = i + round;
+        for (const auto *key : keys) checksum += map.find(key)->second;
+        for (const auto &entry : map) checksum += ++position * entry.second;
+    }
+    return checksum;
+}
+
+}  // namespace
+
+TEST(ContainerBenchmark, IterationOrder) {
+    // hvec_set and hvec_map iterate in insertion order, as ordered_set and ordered_map do.
+    auto keys = makeKeys(1000);
+    ordered_set<const int *> oset;
+    hvec_set<const int *> hset;
+    ordered_map<const int *, size_t> omap;
+    hvec_map<const int *, size_t> hmap;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const auto *key = keys[(i * 37) % keys.size()];
+        oset.insert(key);
+        hset.insert(key);
+        omap.emplace(key, i);
+        hmap.emplace(key, i);
+    }
+    EXPECT_TRUE(std::equal(oset.begin(), oset.end(), hset.begin(), hset.end()));
+    EXPECT_TRUE(std::equal(oset.rbegin(), oset.rend(), hset.rbegin(), hset.rend()));
+    EXPECT_TRUE(std::equal(omap.begin(), omap.end(), hmap.begin(), hmap.end()));
+    EXPECT_TRUE(std::equal(omap.rbegin(), omap.rend(), hmap.rbegin(), hmap.rend()));
+}
+
+TEST(ContainerBenchmark, DISABLED_SmallSets) {
+    auto keys = makeKeys(4096);
+    constexpr size_t sets = 20000, size = 8;
+    auto start = Clock::now();
+    auto ordered = setWorkload<ordered_set<const int *>>(keys, sets, size);
+    auto orderedTime = Clock::now() - start;
+    start = Clock::now();
+    auto hvec = setWorkload<hvec_set<const int *>>(keys, sets, size);
+    auto hvecTime = Clock::now() - start;
+    EXPECT_EQ(ordered, hvec);
+    std::cout << sets << " sets of " << size << ": ordered_set " << ms(orderedTime)
+              << "ms, hvec_set " << ms(hvecTime) << "ms" << std::endl;
+}
+
+TEST(ContainerBenchmark, DISABLED_LargeSets) {
+    auto keys = makeKeys(100000);
+    constexpr size_t sets = 20, size = 20000;
+    auto start = Clock::now();
+    auto ordered = setWorkload<ordered_set<const int *>>(keys, sets, size);
+    auto orderedTime = Clock::now() - start;
+    start = Clock::now();
+    auto hvec = setWorkload<hvec_set<const int *>>(keys, sets, size);
+    auto hvecTime = Clock::now() - start;
+    EXPECT_EQ(ordered, hvec);
+    std::cout << sets << " sets of " << size << ": ordered_set " << ms(orderedTime)
+              << "ms, hvec_set " << ms(hvecTime) << "ms" << std::endl;
+}
+
+TEST(ContainerBenchmark, DISABLED_Maps) {
+    auto keys = makeKeys(100000);
+    constexpr size_t rounds = 10;
+    auto start = Clock::now();
+    auto ordered = mapWorkload<ordered_map<const int *, size_t>>(keys, rounds);
+    auto orderedTime = Clock::now() - start;
+    start = Clock::now();
+    auto hvec = mapWorkload<hvec_map<const int *, size_t>>(keys, rounds);
+    auto hvecTime = Clock::now() - start;
+    EXPECT_EQ(ordered, hvec);
+    std::cout << rounds << " maps of " << keys.size() << ": ordered_map " << ms(orderedTime)
+              << "ms, hvec_map " << ms(hvecTime) << "ms" << std::endl;
+}
+
+}  // namespace P4::Test
@@ -18,6 +18,16 @@ limitations under the License.
 
 #include <gtest/gtest.h>
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/container/node_hash_set.h"
+#include "lib/gc.h"
+
 namespace P4::Test {
 
 using namespace P4::literals;
@@ -158,4 +168,76 @@ TEST(cstring, get_cached) {
     EXPECT_FALSE(cstring::get_cached("test").isNullOrEmpty());
 }
 
+TEST(cstring, concurrentIntern) {
+    if (!gc_allow_threads()) GTEST_SKIP() << "the garbage collector does not support threads";
+    constexpr int threads = 8, strings = 2000;
+    std::vector<std::vector<const char *>> seen(threads, std::vector<const char *>(strings));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([t, &seen]() {
+            gc_register_thread();
+            // Every thread interns the same strings, in a different order.
+            for (int i = 0; i < strings; ++i) {
+                int k = (i * 7 + t * 131) % strings;
+                seen[t][k] = cstring("concurrent_" + std::to_string(k)).c_str();
+            }
+            gc_unregister_thread();
+        });
+    }
+    for (auto &w : workers) w.join();
+    for (int k = 0; k < strings; ++k) {
+        const char *expected = cstring::get_cached("concurrent_" + std::to_string(k)).c_str();
+        ASSERT_NE(expected, nullptr);
+        for (int t = 0; t < threads; ++t) EXPECT_EQ(seen[t][k], expected);
+    }
+}
+
+// Not a correctness test, so disabled by default (run with --gtest_also_run_disabled_tests):
+// compares single-threaded intern and lookup throughput of the sharded table with the
+// previous implementation, a node_hash_set behind a single lock.
+TEST(cstring, DISABLED_internBenchmark) {
+    constexpr int count = 200000, rounds = 5;
+    std::vector<std::string> names;
+    for (int i = 0; i < count; ++i) names.push_back("bench_" + std::to_string(i * 2654435761U));
+
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+
+    std::mutex lock;
+    absl::node_hash_set<std::string> previous;
+    auto start = Clock::now();
+    for (const auto &n : names) {
+        std::lock_guard<std::mutex> guard(lock);
+        previous.insert(n);
+    }
+    auto previousInsert = Clock::now() - start;
+    start = Clock::now();
+    size_t found = 0;
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto &n : names) {
+            std::lock_guard<std::mutex> guard(lock);
+            found += previous.count(n);
+        }
+    }
+    auto previousLookup = Clock::now() - start;
+    EXPECT_EQ(found, size_t(count) * rounds);
+
+    start = Clock::now();
+    for (const auto &n : names) cstring c(n);
+    auto internInsert = Clock::now() - start;
+    start = Clock::now();
+    found = 0;
+    for (int r = 0; r < rounds; ++r)
+        for (const auto &n : names) found += !cstring(n).isNull();
+    auto internLookup = Clock::now() - start;
+    EXPECT_EQ(found, size_t(count) * rounds);
+
+    std::cout << "intern " << count << " new strings: previous " << ms(previousInsert)
+              << "ms, sharded " << ms(internInsert) << "ms" << std::endl
+              << "look up " << count * rounds << " interned strings: previous "
+              << ms(previousLookup) << "ms, sharded " << ms(internLookup) << "ms" << std::endl;
+}
+
 }  // namespace P4::Test
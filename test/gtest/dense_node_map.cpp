@@ -0,0 +1,136 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ir/dense_node_map.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "ir/ir.h"
+
+namespace P4::Test {
+
+namespace {
+
+class CountConstants : public Inspector {
+    bool preorder(const IR::Constant *) override {
+        ++count;
+        return false;
+    }
+
+ public:
+    int count = 0;
+};
+
+}  // namespace
+
+TEST(DenseNodeMap, SharedIds) {
+    auto *a = new IR::Constant(1);
+    auto *b = new IR::Constant(2);
+    *b = *a;  // copies the id
+    ASSERT_EQ(a->id, b->id);
+
+    IR::DenseNodeMap<int> map;
+    EXPECT_TRUE(map.emplace(a, 1).second);
+    EXPECT_TRUE(map.emplace(b, 2).second);
+    EXPECT_FALSE(map.emplace(a, 3).second);
+    EXPECT_EQ(*map.find(a), 1);
+    EXPECT_EQ(*map.find(b), 2);
+    EXPECT_EQ(map.size(), 2u);
+
+    map.erase_if([](int value) { return value == 1; });
+    EXPECT_FALSE(map.contains(a));
+    EXPECT_EQ(*map.find(b), 2);
+    // b keeps its entry even though its slot is free now.
+    EXPECT_FALSE(map.emplace(b, 4).second);
+    EXPECT_TRUE(map.emplace(a, 5).second);
+    EXPECT_EQ(map.size(), 2u);
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_FALSE(map.contains(a));
+    EXPECT_FALSE(map.contains(b));
+}
+
+TEST(DenseNodeMap, ClearFreesUnusedPages) {
+    IR::DenseNodeMap<int> map;
+    auto *a = new IR::Constant(1);
+    map.emplace(a, 1);
+    size_t page = map.memoryUsed();
+    EXPECT_GT(page, 0u);
+
+    // Far enough from a to need a page of its own.
+    const IR::Node *b = nullptr;
+    for (int i = 0; i < 10000; ++i) b = new IR::Constant(i);
+    map.emplace(b, 2);
+    EXPECT_EQ(map.memoryUsed(), 2 * page);
+
+    map.clear();
+    EXPECT_EQ(map.memoryUsed(), 2 * page);
+    map.emplace(b, 3);
+    map.clear();
+    EXPECT_EQ(map.memoryUsed(), page);
+    map.clear();
+    EXPECT_EQ(map.memoryUsed(), 0u);
+    EXPECT_TRUE(map.emplace(a, 4).second);
+}
+
+TEST(DenseNodeMap, VisitorsSeeNodesWithSharedIds) {
+    auto *a = new IR::Constant(1);
+    auto *b = new IR::Constant(2);
+    *b = *a;
+    IR::Vector<IR::Expression> vec({a, b, a});
+    CountConstants count;
+    vec.apply(count);
+    EXPECT_EQ(count.count, 2);  // a is only visited once
+}
+
+// Timing only, so not run by default.
+TEST(DenseNodeMap, DISABLED_Benchmark) {
+    constexpr int count = 200000;
+    constexpr int passes = 10;
+    std::vector<const IR::Node *> nodes;
+    nodes.reserve(count);
+    for (int i = 0; i < count; ++i) nodes.push_back(new IR::Constant(i));
+
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    // Each pass tracks every node once and looks it up twice, like a visitor does.
+    size_t found = 0;
+    auto start = Clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        absl::flat_hash_map<const IR::Node *, int, Util::Hash> map(16);
+        for (const auto *n : nodes) map.emplace(n, pass);
+        for (const auto *n : nodes) found += map.count(n) + map.count(n);
+    }
+    auto hashed = Clock::now() - start;
+
+    start = Clock::now();
+    IR::DenseNodeMap<int> dense;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const auto *n : nodes) dense.emplace(n, pass);
+        for (const auto *n : nodes) found -= dense.contains(n) + dense.contains(n);
+        dense.clear();
+    }
+    auto indexed = Clock::now() - start;
+    EXPECT_EQ(found, 0u);
+    std::cout << passes << " passes over " << count << " nodes: flat_hash_map " << ms(hashed)
+              << "ms, DenseNodeMap " << ms(indexed) << "ms" << std::endl;
+}
+
+}  // namespace P4::Test
@@ -72,3 +72,29 @@ TEST(IR, Equiv) {
     pr2->add("listb"_cs, list1);
     EXPECT_FALSE(pr1->equiv(*pr2));
 }
+
+TEST(IR, EquivHashConsed) {
+    auto *t = IR::Type::Bits::get(16);
+    EXPECT_TRUE(t->isCanonical());
+    EXPECT_EQ(t, IR::Type::Bits::get(16));
+    EXPECT_TRUE(IR::Type::Boolean::get()->isCanonical());
+    EXPECT_FALSE(IR::Type::Boolean::get(Util::SourceInfo())->isCanonical());
+
+    auto *a1 = IR::Constant::get(t, 10);
+    auto *a2 = IR::Constant::get(IR::Type::Bits::get(Util::SourceInfo(), 16), 10);
+    auto *b = IR::Constant::get(t, 11);
+    EXPECT_EQ(a1, a2);
+    EXPECT_TRUE(a1->isCanonical());
+    EXPECT_FALSE(a1->equiv(*b));
+
+    // Copies are ordinary nodes, still equiv to the canonical one.
+    auto *copy = a1->clone();
+    EXPECT_FALSE(copy->isCanonical());
+    EXPECT_TRUE(copy->equiv(*a1));
+    EXPECT_TRUE(a1->equiv(*copy));
+
+    // Values wrapped by the constructor are shared, but not canonical.
+    auto *wrapped = IR::Constant::get(IR::Type::Bits::get(8), 256);
+    EXPECT_FALSE(wrapped->isCanonical());
+    EXPECT_TRUE(wrapped->equiv(*IR::Constant::get(IR::Type::Bits::get(8), 0)));
+}
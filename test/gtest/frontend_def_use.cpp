@@ -0,0 +1,86 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+
+#include "frontends/p4/def_use.h"
+#include "helpers.h"
+#include "ir/ir.h"
+
+namespace P4::Test {
+
+using namespace P4::literals;
+
+class FrontendDefUse : public P4CTest {};
+
+TEST_F(FrontendDefUse, LocationIndices) {
+    StorageFactory factory;
+    IR::IndexedVector<IR::StructField> fields;
+    fields.push_back(new IR::StructField("a"_cs, IR::Type_Bits::get(8)));
+    fields.push_back(new IR::StructField("b"_cs, IR::Type_Bits::get(8)));
+    auto *header = new IR::Type_Header("h"_cs, fields);
+    auto *stack = new IR::Type_Stack(header, new IR::Constant(4));
+    const auto *first = factory.create(stack, "s"_cs);
+    const auto *second = factory.create(header, "t"_cs);
+
+    // Each header has two fields and a valid bit.  The stack's last index is numbered
+    // next, but it is not an element, so the canonical set leaves it out.
+    LocationSet all(first);
+    EXPECT_EQ(all.canonicalIndices(), bitvec(0, 12));
+    EXPECT_EQ(all.getArrayLastIndex()->canonicalIndices(), bitvec(12, 1));
+    EXPECT_EQ(LocationSet(second).canonicalIndices(), bitvec(13, 3));
+
+    const auto *element = all.getIndex(2);
+    const auto *field = element->getField("b"_cs);
+    EXPECT_TRUE(field->overlaps(element));
+    EXPECT_TRUE(element->overlaps(&all));
+    EXPECT_FALSE(all.getIndex(1)->overlaps(field));
+    EXPECT_FALSE(all.overlaps(new LocationSet(second)));
+    EXPECT_EQ(all.getValidField()->canonicalIndices().popcount(), 4);
+
+    // Joining keeps the indices of both sides.
+    const auto *joined = element->join(all.getArrayLastIndex());
+    EXPECT_EQ(joined->canonicalIndices(), element->canonicalIndices() |
+                                              all.getArrayLastIndex()->canonicalIndices());
+}
+
+TEST_F(FrontendDefUse, ProgramPoints) {
+    ProgramPointNumbering numbering;
+    auto *statement = new IR::EmptyStatement();
+    ProgramPoint point(statement);
+    ProgramPoints start(&numbering, ProgramPoint::beforeStart);
+    ProgramPoints at(&numbering, point);
+    ProgramPoints after(&numbering, point.after());
+
+    const auto *merged = start.merge(&at);
+    EXPECT_EQ(merged->size(), 2u);
+    EXPECT_TRUE(merged->containsBeforeStart());
+    EXPECT_FALSE(at.containsBeforeStart());
+    // Merging a subset does not allocate a new set.
+    EXPECT_EQ(merged->merge(&at), merged);
+    EXPECT_EQ(at.merge(merged), merged);
+
+    ProgramPoints all;
+    all.add(&after);
+    all.add(merged);
+    EXPECT_EQ(all.size(), 3u);
+    EXPECT_FALSE(all == *merged);
+    std::vector<ProgramPoint> points(all.begin(), all.end());
+    ASSERT_EQ(points.size(), 3u);
+    EXPECT_TRUE(points[0].isBeforeStart());
+    EXPECT_EQ(points[1].last(), statement);
+    EXPECT_EQ(points[2].last(), nullptr);
+}
+
+}  // namespace P4::Test
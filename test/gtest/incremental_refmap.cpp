@@ -0,0 +1,89 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "helpers.h"
+#include "ir/ir.h"
+
+namespace P4::Test {
+
+namespace {
+
+/// Renames the constant called @p from, and all references to it, to @p to.
+class Rename : public Transform {
+    cstring from, to;
+
+    const IR::Node *postorder(IR::Declaration_Constant *decl) override {
+        if (decl->name == from) decl->name = IR::ID(to);
+        return decl;
+    }
+    const IR::Node *postorder(IR::Path *path) override {
+        if (path->name == from) path->name = IR::ID(to);
+        return path;
+    }
+
+ public:
+    Rename(cstring from, cstring to) : from(from), to(to) { setName("Rename"); }
+};
+
+/// Counts the paths it resolves.
+class CountingResolveReferences : public ResolveReferences {
+    bool preorder(const IR::PathExpression *path) override {
+        ++resolved;
+        return ResolveReferences::preorder(path);
+    }
+
+ public:
+    int resolved = 0;
+    using ResolveReferences::ResolveReferences;
+};
+
+}  // namespace
+
+class IncrementalReferenceMap : public P4CTest {};
+
+TEST_F(IncrementalReferenceMap, ResolvesChangedDeclarationsOnly) {
+    const auto *program = parseP4String(P4_SOURCE(R"(
+        const bit<8> a = 1;
+        const bit<8> b = a;
+        const bit<8> c = 2;
+        const bit<8> d = c;
+    )"),
+                                        CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program);
+    ReferenceMap refMap;
+    CountingResolveReferences first(&refMap);
+    program->apply(first);
+    EXPECT_EQ(first.resolved, 2);
+
+    program = program->apply(Rename("a"_cs, "x"_cs));
+    CountingResolveReferences second(&refMap);
+    program->apply(second);
+    ASSERT_EQ(::P4::errorCount(), 0u);
+    // Only b's reference is resolved again.
+    EXPECT_EQ(second.resolved, 1);
+
+    ReferenceMap full;
+    program->apply(ResolveReferences(&full));
+    EXPECT_TRUE(refMap.sameResolution(full));
+    const auto *b = program->objects.at(1)->to<IR::Declaration_Constant>();
+    const auto *path = b->initializer->to<IR::PathExpression>()->path;
+    EXPECT_EQ(refMap.getDeclaration(path, true)->getNode(), program->objects.at(0));
+}
+
+}  // namespace P4::Test
@@ -0,0 +1,167 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "frontends/common/parseInput.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+#include "helpers.h"
+#include "ir/ir.h"
+
+namespace P4::Test {
+
+namespace {
+
+/// Replaces the initializer of the constant called @p name.
+class SetConstant : public Transform {
+    cstring name;
+    int value;
+
+    const IR::Node *postorder(IR::Declaration_Constant *decl) override {
+        if (decl->name == name) decl->initializer = new IR::Constant(decl->type, value);
+        return decl;
+    }
+
+ public:
+    SetConstant(cstring name, int value) : name(name), value(value) { setName("SetConstant"); }
+};
+
+/// Renames the constant called @p from to @p to.
+class RenameConstant : public Transform {
+    cstring from, to;
+
+    const IR::Node *postorder(IR::Declaration_Constant *decl) override {
+        if (decl->name == from) decl->name = IR::ID(to);
+        return decl;
+    }
+
+ public:
+    RenameConstant(cstring from, cstring to) : from(from), to(to) {
+        setName("RenameConstant");
+    }
+};
+
+/// Reverses the order of the top-level declarations.
+class Reverse : public Transform {
+    const IR::Node *preorder(IR::P4Program *program) override {
+        std::reverse(program->objects.begin(), program->objects.end());
+        prune();
+        return program;
+    }
+};
+
+const IR::P4Program *parse() {
+    return parseP4String(P4_SOURCE(R"(
+        const bit<8> a = 8w1;
+        const bit<8> b = a;
+        const bit<16> c = 16w2;
+        control C(inout bit<16> x) { apply { x = x + c; } }
+    )"),
+                         CompilerOptions::FrontendVersion::P4_16);
+}
+
+template <class T>
+const T *find(const IR::P4Program *program, const char *name) {
+    for (const auto *object : program->objects)
+        if (const auto *decl = object->to<T>(); decl && decl->name == name) return decl;
+    return nullptr;
+}
+
+const IR::Expression *assignedValue(const IR::P4Control *control) {
+    return control->body->components.at(0)->to<IR::AssignmentStatement>()->right;
+}
+
+}  // namespace
+
+class IncrementalTypeMap : public P4CTest {};
+
+TEST_F(IncrementalTypeMap, KeepsUnchangedDeclarations) {
+    const auto *program = parse();
+    ASSERT_TRUE(program);
+    TypeMap typeMap;
+    PassManager typeCheck({new ClearTypeMap(&typeMap), new TypeChecking(nullptr, &typeMap)});
+    program = program->apply(typeCheck);
+    ASSERT_EQ(::P4::errorCount(), 0u);
+
+    program = program->apply(SetConstant("a"_cs, 3));
+    program->apply(ClearTypeMap(&typeMap));
+    // C and c are the same nodes and do not refer to a; b refers to a.
+    const auto *c = find<IR::Declaration_Constant>(program, "c");
+    const auto *control = find<IR::P4Control>(program, "C");
+    EXPECT_TRUE(typeMap.contains(c));
+    EXPECT_TRUE(typeMap.contains(control));
+    EXPECT_TRUE(typeMap.contains(assignedValue(control)));
+    EXPECT_TRUE(typeMap.isLeftValue(
+        control->body->components.at(0)->to<IR::AssignmentStatement>()->left));
+    const auto *b = find<IR::Declaration_Constant>(program, "b");
+    EXPECT_FALSE(typeMap.contains(b));
+    EXPECT_FALSE(typeMap.contains(b->initializer));
+    EXPECT_FALSE(typeMap.contains(find<IR::Declaration_Constant>(program, "a")));
+
+    program = program->apply(TypeChecking(nullptr, &typeMap));
+    ASSERT_EQ(::P4::errorCount(), 0u);
+    const auto *type = typeMap.getType(b->initializer, true);
+    ASSERT_TRUE(type->is<IR::Type_Bits>());
+    EXPECT_EQ(type->to<IR::Type_Bits>()->size, 8);
+}
+
+TEST_F(IncrementalTypeMap, RetypesSharedConstants) {
+    const auto *program = parseP4String(P4_SOURCE(R"(
+        const int a = 1;
+        const bit<8> c = 8w2;
+    )"),
+                                        CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program);
+    TypeMap typeMap;
+    PassManager typeCheck({new ClearTypeMap(&typeMap), new TypeChecking(nullptr, &typeMap)});
+    program = program->apply(typeCheck);
+    ASSERT_EQ(::P4::errorCount(), 0u);
+
+    // The constant 1 is shared by both versions of the declaration, so its type
+    // variable is bound again when the declaration is type checked again.
+    program = program->apply(RenameConstant("a"_cs, "b"_cs));
+    program = program->apply(typeCheck);
+    ASSERT_EQ(::P4::errorCount(), 0u);
+    EXPECT_TRUE(typeMap.contains(find<IR::Declaration_Constant>(program, "c")));
+    const auto *b = find<IR::Declaration_Constant>(program, "b");
+    EXPECT_TRUE(typeMap.getType(b->initializer, true)->is<IR::Type_InfInt>());
+}
+
+TEST_F(IncrementalTypeMap, ClearsWhenDeclarationsMove) {
+    const auto *program = parse();
+    ASSERT_TRUE(program);
+    TypeMap typeMap;
+    program = program->apply(TypeChecking(nullptr, &typeMap));
+    ASSERT_EQ(::P4::errorCount(), 0u);
+    EXPECT_NE(typeMap.size(), 0u);
+
+    program = program->apply(Reverse());
+    program->apply(ClearTypeMap(&typeMap));
+    EXPECT_EQ(typeMap.size(), 0u);
+}
+
+TEST_F(IncrementalTypeMap, ForceClears) {
+    const auto *program = parse();
+    ASSERT_TRUE(program);
+    TypeMap typeMap;
+    program = program->apply(TypeChecking(nullptr, &typeMap));
+    program = program->apply(SetConstant("a"_cs, 3));
+    program->apply(ClearTypeMap(&typeMap, true));
+    EXPECT_EQ(typeMap.size(), 0u);
+}
+
+}  // namespace P4::Test
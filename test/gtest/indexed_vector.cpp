@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include <utility>
+
 #include "ir/ir.h"
 
 namespace P4::Test {
@@ -140,4 +142,30 @@ TEST(IndexedVector, erase) {
     vec.validate();
 }
 
+TEST(IndexedVector, copy_on_write) {
+    TestVector vec{testItem("a"_cs), testItem("b"_cs)};
+    const TestVector copy(vec);
+    // The copy shares the elements until one of the vectors is modified.
+    EXPECT_EQ(copy.VectorBase_begin(), std::as_const(vec).VectorBase_begin());
+    EXPECT_TRUE(copy == vec);
+
+    vec.replace(vec.begin(), testItem("c"_cs));
+    EXPECT_NE(copy.VectorBase_begin(), std::as_const(vec).VectorBase_begin());
+    EXPECT_EQ(copy[0]->name.name, "a");
+    EXPECT_EQ(std::as_const(vec)[0]->name.name, "c");
+    EXPECT_TRUE(copy.getDeclaration("a"));
+    EXPECT_FALSE(copy.getDeclaration("c"));
+    EXPECT_FALSE(vec.getDeclaration("a"));
+    EXPECT_TRUE(vec.getDeclaration("c"));
+    vec.validate();
+    copy.validate();
+
+    TestVector erased(copy);
+    erased.erase(erased.begin());
+    EXPECT_EQ(copy.size(), 2u);
+    EXPECT_EQ(erased.size(), 1u);
+    EXPECT_TRUE(copy.getDeclaration("a"));
+    EXPECT_FALSE(erased.getDeclaration("a"));
+}
+
 }  // namespace P4::Test
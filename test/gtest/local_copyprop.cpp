@@ -0,0 +1,137 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "midend/local_copyprop.h"
+
+#include <absl/strings/substitute.h>
+#include <gtest/gtest.h>
+
+#include "frontends/p4/toP4/toP4.h"
+#include "frontends/p4/typeMap.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "lib/sourceCodeBuilder.h"
+
+namespace P4::Test {
+
+namespace {
+
+/// @return the program, after LocalCopyPropagation, with @p ingressSource as the body of
+/// the ingress control.
+std::string copyPropagate(const std::string &ingressSource) {
+    std::string source = P4_SOURCE(P4Headers::V1MODEL, R"(
+header H
+{
+   bit<32> f1;
+   bit<32> f2;
+   bit<32> f3;
+}
+
+struct Headers { H h; }
+struct Metadata { bit<32> m; }
+
+parser parse(packet_in packet, out Headers headers, inout Metadata meta,
+         inout standard_metadata_t sm) {
+    state start {
+        packet.extract(headers.h);
+        transition accept;
+    }
+}
+
+control verifyChecksum(inout Headers headers, inout Metadata meta) { apply { } }
+control increment(inout bit<32> v) { apply { v = v + 1; } }
+control ingress(inout Headers headers, inout Metadata meta,
+                inout standard_metadata_t sm) {
+    increment() inc;
+    apply {
+$0
+    }
+}
+
+control egress(inout Headers headers, inout Metadata meta,
+                inout standard_metadata_t sm) { apply { } }
+
+control computeChecksum(inout Headers headers, inout Metadata meta) { apply { } }
+
+control deparse(packet_out packet, in Headers headers) {
+    apply { packet.emit(headers.h); }
+}
+
+V1Switch(parse(), verifyChecksum(), ingress(), egress(),
+    computeChecksum(), deparse()) main;
+    )");
+
+    auto test = FrontendTestCase::create(absl::Substitute(source, ingressSource));
+    if (!test) return "<frontend failed>";
+    TypeMap typeMap;
+    const auto *program = test->program->apply(LocalCopyPropagation(&typeMap));
+    if (!program || ::P4::errorCount() > 0) return "<failed>";
+
+    Util::SourceCodeBuilder builder;
+    ToP4 top4(builder, false);
+    program->apply(top4);
+    return builder.toString();
+}
+
+bool contains(const std::string &program, const std::string &text) {
+    return program.find(text) != std::string::npos;
+}
+
+}  // namespace
+
+class LocalCopyPropagationTest : public P4CTest {};
+
+TEST_F(LocalCopyPropagationTest, MergeKeepsValuesSetOnAllPaths) {
+    auto program = copyPropagate(P4_SOURCE(R"(
+        bit<32> x = headers.h.f2;
+        bit<32> y = headers.h.f2;
+        if (headers.h.f1 == 1) {
+            x = headers.h.f3;
+        }
+        headers.h.f1 = x;
+        headers.h.f3 = y;
+    )"));
+    // y has the same value after both branches; x does not.
+    EXPECT_TRUE(contains(program, "headers.h.f3 = headers.h.f2;")) << program;
+    EXPECT_TRUE(contains(program, "headers.h.f1 = x")) << program;
+}
+
+TEST_F(LocalCopyPropagationTest, WritesDropValuesOfOverlappingLocations) {
+    auto program = copyPropagate(P4_SOURCE(R"(
+        bit<32> x = headers.h.f1;
+        bit<32> y = headers.h.f2;
+        headers.h.f3 = 1;
+        headers.h.f3 = x;
+        headers.h.setInvalid();
+        headers.h.f2 = y;
+    )"));
+    // Writing a sibling field keeps x, writing the whole header drops y.
+    EXPECT_TRUE(contains(program, "headers.h.f3 = headers.h.f1;")) << program;
+    EXPECT_TRUE(contains(program, "headers.h.f2 = y")) << program;
+}
+
+TEST_F(LocalCopyPropagationTest, UnknownCallsClearNonLocalValues) {
+    auto program = copyPropagate(P4_SOURCE(R"(
+        bit<32> x = headers.h.f1;
+        meta.m = headers.h.f2;
+        inc.apply(headers.h.f3);
+        headers.h.f2 = x;
+        headers.h.f1 = meta.m;
+    )"));
+    // The call may change meta.m, but not the local x.
+    EXPECT_TRUE(contains(program, "headers.h.f2 = headers.h.f1;")) << program;
+    EXPECT_TRUE(contains(program, "headers.h.f1 = meta.m;")) << program;
+}
+
+}  // namespace P4::Test
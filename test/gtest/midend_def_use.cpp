@@ -413,4 +413,52 @@ TEST_F(P4CMidendDefUse, slice_1) {
     EXPECT_TRUE(check_def_use(uses, "inout ParsedHeaders h", 0, {0, 2, 3, 10, 11, 14}));
 }
 
+TEST_F(P4CMidendDefUse, parser_loop) {
+    std::string headers = R"(
+        header hdr_h_t {
+            bit<8> f1;
+        }
+        struct ParsedHeaders {
+            hdr_h_t h1;
+        }
+        struct Metadata {
+            bit<8> cnt;
+        }
+    )";
+    std::string parser_body = R"(
+        state start {
+            m.cnt = 0;
+            transition loop;
+        }
+        state loop {
+            pkt.extract(h.h1);
+            m.cnt = m.cnt + 1;
+            transition select (h.h1.f1) {
+                0 : loop;
+                default : accept;
+            }
+        }
+    )";
+    std::string control_body = R"(
+        apply {
+            h.h1.f1 = m.cnt;
+        }
+    )";
+    std::string deparser_body = R"(
+        apply {
+            b.emit(h);
+        }
+    )";
+
+    auto program = make_program(headers, parser_body, control_body, deparser_body);
+    auto *defuse = computeDefUse(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(defuse);
+
+    auto [defs, uses] = get_defs_uses(defuse);
+
+    // the def in the loop reaches the use in the next iteration
+    EXPECT_TRUE(check_def_use(defs, "m.cnt", 7, {2, 7}));
+    EXPECT_TRUE(check_def_use(uses, "m.cnt", 2, {0, 7}));
+}
+
 }  // namespace P4::Test
@@ -25,12 +25,15 @@ limitations under the License.
 #include "ir/ir.h"
 #include "lib/log.h"
 #include "midend/convertEnums.h"
+#include "midend/interpreter.h"
 #include "midend/replaceSelectRange.h"
 
 using namespace P4;
 
 namespace P4::Test {
 
+using namespace P4::literals;
+
 namespace {
 
 class EnumOn32Bits : public ChooseEnumRepresentation {
@@ -287,4 +290,36 @@ TEST_F(P4CMidend, replaceSelectRangeSigned5) {
         {{0, 15}}, [](CollectRangesAndMasks collect) { ASSERT_EQ(collect.masks.size(), 1u); });
 }
 
+TEST_F(P4CMidend, forkValueMap) {
+    IR::IndexedVector<IR::StructField> fields;
+    fields.push_back(new IR::StructField("f"_cs, IR::Type_Bits::get(8)));
+    fields.push_back(new IR::StructField("g"_cs, IR::Type_Bits::get(8)));
+    auto *type = new IR::Type_Header("h_t"_cs, fields);
+    auto *header = new SymbolicHeader(type);
+    header->set("f"_cs, new SymbolicInteger(new IR::Constant(IR::Type_Bits::get(8), 1)));
+    header->set("g"_cs, new SymbolicInteger(new IR::Constant(IR::Type_Bits::get(8), 2)));
+    header->setValid(true);
+    auto *decl = new IR::Declaration_Variable("h"_cs, type);
+    auto *original = new ValueMap();
+    original->set(decl, header);
+
+    auto *fork = original->fork();
+    EXPECT_TRUE(fork->equals(original));
+    fork->getWritable(decl)->to<SymbolicStruct>()->getWritable(nullptr, "f"_cs)->setAllUnknown();
+    EXPECT_FALSE(fork->equals(original));
+
+    // The original is unchanged, and shares the parts that were not written with the fork.
+    const auto *before = original->get(decl)->to<SymbolicHeader>();
+    const auto *after = fork->get(decl)->to<SymbolicHeader>();
+    EXPECT_EQ(before, header);
+    EXPECT_TRUE(before->get(nullptr, "f"_cs)->to<ScalarValue>()->isKnown());
+    EXPECT_TRUE(after->get(nullptr, "f"_cs)->to<ScalarValue>()->isUnknown());
+    EXPECT_EQ(before->get(nullptr, "g"_cs), after->get(nullptr, "g"_cs));
+    EXPECT_EQ(before->valid, after->valid);
+
+    EXPECT_TRUE(original->merge(fork));
+    EXPECT_TRUE(original->equals(fork));
+    EXPECT_FALSE(original->merge(fork));
+}
+
 }  // namespace P4::Test
@@ -88,6 +88,19 @@ std::pair<const IR::P4Parser *, const IR::P4Parser *> loadExample(
     return rewriteParser(program, options);
 }
 
+/// Parses @p source, which must include v1model.p4, and rewrites its parser.
+std::pair<const IR::P4Parser *, const IR::P4Parser *> loadSource(const std::string &source) {
+    AutoCompileContext autoP4TestContext(new P4TestContext);
+    auto &options = P4TestContext::get().options();
+    const char *argv = "./gtestp4c";
+    options.process(1, (char *const *)&argv);
+    options.loopsUnrolling = true;
+    const IR::P4Program *program =
+        P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    if (!program) return std::make_pair(nullptr, nullptr);
+    return rewriteParser(program, options);
+}
+
 TEST_F(P4CParserUnroll, test1) {
     auto parsers = loadExample("parser-unroll-test1.p4");
     ASSERT_TRUE(parsers.first);
@@ -154,4 +167,91 @@ TEST_F(P4CParserUnroll, stringTypes) {
     ASSERT_EQ(parsers.first->states.size(), parsers.second->states.size());
 }
 
+/// An MPLS label stack as deep as the ones seen in practice.  Each depth of the stack
+/// must be unrolled once, whatever the number of paths that reach it.
+TEST_F(P4CParserUnroll, deepStack) {
+    auto parsers = loadSource(P4_SOURCE(P4Headers::V1MODEL, R"(
+const bit<16> TYPE_MPLS = 0x8847;
+const bit<16> MAX_LABELS = 16;
+
+header ethernet_t {
+    bit<48>   dstAddr;
+    bit<48>   srcAddr;
+    bit<16>   etherType;
+}
+
+header mpls_t {
+    bit<20>   label;
+    bit<3>    tc;
+    bit<1>    bos;
+    bit<8>    ttl;
+}
+
+header ipv4_t {
+    bit<4>    version;
+    bit<4>    ihl;
+    bit<8>    diffserv;
+    bit<16>   totalLen;
+    bit<16>   identification;
+    bit<3>    flags;
+    bit<13>   fragOffset;
+    bit<8>    ttl;
+    bit<8>    protocol;
+    bit<16>   hdrChecksum;
+    bit<32>   srcAddr;
+    bit<32>   dstAddr;
+}
+
+struct metadata {}
+
+struct headers {
+    ethernet_t           ethernet;
+    mpls_t[MAX_LABELS]   mpls;
+    ipv4_t               ipv4;
+}
+
+parser MyParser(packet_in packet, out headers hdr, inout metadata meta,
+                inout standard_metadata_t standard_metadata) {
+    int<32> index;
+
+    state start {
+        transition parse_ethernet;
+    }
+
+    state parse_ethernet {
+        index = 0;
+        packet.extract(hdr.ethernet);
+        transition select(hdr.ethernet.etherType) {
+            TYPE_MPLS: parse_mpls;
+            default: accept;
+        }
+    }
+
+    state parse_mpls {
+        packet.extract(hdr.mpls[index]);
+        index = index + 1;
+        transition select(hdr.mpls[index - 1].bos) {
+            1: parse_ipv4;
+            default: parse_mpls;
+        }
+    }
+
+    state parse_ipv4 {
+        packet.extract(hdr.ipv4);
+        transition accept;
+    }
+}
+
+control mau(inout headers hdr, inout metadata meta, inout standard_metadata_t sm) { apply {} }
+control deparse(packet_out pkt, in headers hdr) { apply {} }
+control verifyChecksum(inout headers hdr, inout metadata meta) { apply {} }
+control computeChecksum(inout headers hdr, inout metadata meta) { apply {} }
+V1Switch(MyParser(), verifyChecksum(), mau(), mau(), computeChecksum(), deparse()) main;
+)"));
+    ASSERT_TRUE(parsers.first);
+    ASSERT_TRUE(parsers.second);
+    // One state per label and the outOfBound state.
+    ASSERT_EQ(parsers.first->states.size(), parsers.second->states.size() - 16 - 1);
+}
+
 }  // namespace P4::Test
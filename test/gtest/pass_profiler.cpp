@@ -0,0 +1,86 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ir/pass_profiler.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "ir/ir.h"
+#include "ir/json_parser.h"
+#include "ir/pass_manager.h"
+
+namespace P4::Test {
+
+using namespace P4::literals;
+
+namespace {
+
+class AddOne : public Transform {
+    const IR::Node *postorder(IR::Constant *c) override {
+        return new IR::Add(c, new IR::Constant(1));
+    }
+
+ public:
+    AddOne() { setName("AddOne"); }
+};
+
+class Nothing : public Inspector {
+ public:
+    Nothing() { setName("Nothing"); }
+};
+
+}  // namespace
+
+TEST(PassProfiler, NestedPasses) {
+    PassProfiler::start({});
+    PassManager inner({new AddOne, new Nothing});
+    inner.setName("Inner");
+    PassManager outer({&inner, new Nothing});
+    outer.setName("Outer");
+    const IR::Node *expr = new IR::Mul(new IR::Constant(2), new IR::Constant(3));
+    expr = expr->apply(outer);
+
+    auto events = PassProfiler::get()->events();
+    // Passes are recorded when they end.
+    std::vector<std::string> names;
+    for (const auto &e : events) names.emplace_back(e.name.string_view());
+    EXPECT_EQ(names, (std::vector<std::string>{"AddOne", "Nothing", "Inner", "Nothing", "Outer"}));
+    EXPECT_GT(events[0].nodesAfter, events[0].nodesBefore);
+    EXPECT_GE(events[0].nodesNew, 5u);  // the two Adds, their new constants and a new Mul
+    EXPECT_EQ(events[1].nodesBefore, events[0].nodesAfter);
+    EXPECT_EQ(events[1].nodesNew, 0u);
+    EXPECT_EQ(events[2].nodesBefore, events[0].nodesBefore);
+    EXPECT_EQ(events[2].nodesNew, events[0].nodesNew);
+    EXPECT_EQ(events[4].nodesAfter, events[0].nodesAfter);
+    // The inner passes run within the inner pass manager, within the outer one.
+    EXPECT_GE(events[0].startUs, events[2].startUs);
+    EXPECT_LE(events[1].startUs + events[1].durationUs, events[2].startUs + events[2].durationUs);
+    EXPECT_LE(events[2].startUs + events[2].durationUs, events[4].startUs + events[4].durationUs);
+
+    std::stringstream trace;
+    PassProfiler::get()->write(trace);
+    std::unique_ptr<JsonData> json;
+    trace >> json;
+    ASSERT_TRUE(json && json->is<JsonObject>());
+    const auto &traceEvents = json->to<JsonObject>()->at("traceEvents"_cs);
+    ASSERT_TRUE(traceEvents->is<JsonVector>());
+    EXPECT_EQ(traceEvents->to<JsonVector>()->size(), events.size());
+
+    PassProfiler::stop();
+    EXPECT_EQ(PassProfiler::get(), nullptr);
+}
+
+}  // namespace P4::Test
@@ -0,0 +1,84 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+
+#include "ir/ir.h"
+#include "ir/pass_manager.h"
+
+namespace P4::Test {
+
+namespace {
+
+/// Decrements positive constants by one per run.
+class Decrement : public Transform {
+    int *visits;
+
+    const IR::Node *preorder(IR::Declaration_Constant *decl) override {
+        ++*visits;
+        return decl;
+    }
+    const IR::Node *postorder(IR::Constant *c) override {
+        if (c->value > 0) c->value -= 1;
+        return c;
+    }
+
+ public:
+    explicit Decrement(int *visits) : visits(visits) { setName("Decrement"); }
+    Decrement *clone() const override { return new Decrement(*this); }
+    bool perDeclarationSafe() const override { return true; }
+};
+
+const IR::P4Program *program(std::initializer_list<int> values) {
+    IR::Vector<IR::Node> objects;
+    int index = 0;
+    for (int value : values)
+        objects.push_back(new IR::Declaration_Constant(
+            IR::ID("c" + std::to_string(index++)), IR::Type_Bits::get(8), new IR::Constant(value)));
+    return new IR::P4Program(objects);
+}
+
+int value(const IR::P4Program *program, size_t index) {
+    const auto *decl = program->objects.at(index)->to<IR::Declaration_Constant>();
+    return decl->initializer->to<IR::Constant>()->asInt();
+}
+
+}  // namespace
+
+TEST(PassRepeated, RevisitsChangedDeclarationsOnly) {
+    int visits = 0;
+    PassRepeated repeated({new Decrement(&visits)});
+    const auto *result = program({3, 0, 1})->apply(repeated);
+
+    for (size_t i = 0; i < 3; ++i) EXPECT_EQ(value(result, i), 0);
+    const auto &stats = repeated.getStats();
+    // 3, 0, 1 -> 2, 0, 0 -> 1, 0, 0 -> 0, 0, 0 -> no change.
+    EXPECT_EQ(stats.iterations, 4u);
+    // The first iteration visits everything; after that only c0 and, once, c2.
+    EXPECT_EQ(stats.declarationsVisited, 3u + 2u + 1u + 1u);
+    EXPECT_EQ(stats.declarationsSkipped, 0u + 1u + 2u + 2u);
+    EXPECT_EQ(visits, 7);
+}
+
+TEST(PassRepeated, NestedPassManager) {
+    int visits = 0;
+    PassRepeated repeated({new PassManager({new Decrement(&visits)})});
+    const auto *result = program({2, 0})->apply(repeated);
+
+    EXPECT_EQ(value(result, 0), 0);
+    EXPECT_EQ(repeated.getStats().iterations, 3u);
+    EXPECT_EQ(visits, 2 + 1 + 1);
+}
+
+}  // namespace P4::Test
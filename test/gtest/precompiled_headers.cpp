@@ -0,0 +1,147 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "frontends/common/precompiledHeaders.h"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+
+#include "config.h"
+#include "frontends/common/parseInput.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "lib/arena.h"
+#include "lib/error.h"
+#include "test/gtest/env.h"
+
+namespace P4::Test {
+
+namespace {
+
+using P4TestContext = P4CContextWithOptions<CompilerOptions>;
+
+class PrecompiledHeadersTest : public P4CTest {
+ protected:
+    std::filesystem::path file;
+
+    void SetUp() override {
+        PrecompiledHeaders::clear();
+        file = std::filesystem::temp_directory_path() /
+               ("p4c-precompiled-" + std::to_string(::getpid()) + ".p4");
+        std::ofstream(file) << "#include <core.p4>\n"
+                               "#include <v1model.p4>\n"
+                               "error { Custom }\n"
+                               "header h_t { bit<8> f; }\n"
+                               "struct headers_t { h_t h; }\n"
+                               "struct meta_t {}\n"
+                               "parser p(packet_in pkt, out headers_t hdr, inout meta_t meta,\n"
+                               "         inout standard_metadata_t sm) {\n"
+                               "    state start { pkt.extract(hdr.h); transition accept; }\n"
+                               "}\n";
+    }
+    void TearDown() override { std::filesystem::remove(file); }
+
+    const IR::P4Program *parse(bool precompiled) {
+        AutoCompileContext context(new P4TestContext);
+        auto &options = P4TestContext::get().options();
+        const char *argv = "./gtestp4c";
+        options.process(1, (char *const *)&argv);
+        options.builtinPreprocessor = true;
+        options.precompiledHeaders = precompiled;
+        options.file = file;
+
+        std::string includeDir = std::string(buildPath) + "p4include";
+        auto originalEnv = getenv("P4C_16_INCLUDE_PATH");
+        setenv("P4C_16_INCLUDE_PATH", includeDir.c_str(), 1);
+        const auto *program = parseP4File(options);
+        if (!originalEnv)
+            unsetenv("P4C_16_INCLUDE_PATH");
+        else
+            setenv("P4C_16_INCLUDE_PATH", originalEnv, 1);
+        return program;
+    }
+};
+
+template <class T>
+const T *find(const IR::P4Program *program, const char *name) {
+    for (const auto *object : program->objects) {
+        const auto *node = object->to<T>();
+        if (node && node->name.name == name) return node;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+TEST_F(PrecompiledHeadersTest, SameProgram) {
+    const auto *expected = parse(false);
+    const auto *first = parse(true);
+    const auto *second = parse(true);
+    ASSERT_TRUE(expected && first && second);
+
+    ASSERT_EQ(first->objects.size(), expected->objects.size());
+    for (size_t i = 0; i < expected->objects.size(); ++i)
+        EXPECT_EQ(first->objects[i]->toString(), expected->objects[i]->toString());
+    ASSERT_EQ(second->objects.size(), expected->objects.size());
+
+    // The declarations of the include files are parsed once and shared.
+    const auto *packetIn = find<IR::Type_Extern>(first, "packet_in");
+    ASSERT_TRUE(packetIn);
+    EXPECT_EQ(find<IR::Type_Extern>(second, "packet_in"), packetIn);
+    EXPECT_NE(find<IR::Type_Extern>(expected, "packet_in"), packetIn);
+    auto position = packetIn->srcInfo.toPosition();
+    EXPECT_EQ(std::filesystem::path(position.fileName.string()).filename(), "core.p4");
+    position = find<IR::P4Parser>(second, "p")->srcInfo.toPosition();
+    EXPECT_EQ(position.fileName, file.string());
+    EXPECT_EQ(position.sourceLine, 7u);
+
+    // Error declarations of the program are merged into a copy of the shared one.
+    const auto *expectedErrors = find<IR::Type_Error>(expected, "error");
+    for (const auto *program : {first, second}) {
+        const auto *errors = find<IR::Type_Error>(program, "error");
+        ASSERT_TRUE(errors);
+        EXPECT_EQ(errors->members.size(), expectedErrors->members.size());
+        EXPECT_TRUE(errors->getDeclByName("Custom"));
+    }
+}
+
+#if HAVE_IR_ARENA
+TEST_F(PrecompiledHeadersTest, OutliveTheArena) {
+    const IR::Type_Extern *packetIn = nullptr;
+    {
+        Util::Arena arena;
+        Util::Arena::Scope scope(arena);
+        const auto *program = parse(true);
+        ASSERT_TRUE(program);
+        EXPECT_TRUE(arena.contains(find<IR::P4Parser>(program, "p")));
+        packetIn = find<IR::Type_Extern>(program, "packet_in");
+        ASSERT_TRUE(packetIn);
+        EXPECT_FALSE(arena.contains(packetIn));
+    }
+
+    // The cached declarations are still usable by the next compilation.
+    Util::Arena arena;
+    Util::Arena::Scope scope(arena);
+    const auto *program = parse(true);
+    ASSERT_TRUE(program);
+    EXPECT_EQ(find<IR::Type_Extern>(program, "packet_in"), packetIn);
+    EXPECT_EQ(packetIn->name.name, "packet_in");
+}
+#endif /* HAVE_IR_ARENA */
+
+}  // namespace P4::Test
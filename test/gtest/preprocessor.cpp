@@ -0,0 +1,183 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "frontends/common/preprocessor.h"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <fstream>
+
+#include "frontends/common/options.h"
+#include "frontends/common/parseInput.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace P4::Test {
+
+namespace {
+
+class PreprocessorTest : public P4CTest {
+ protected:
+    std::filesystem::path dir;
+
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() /
+              ("p4c-preprocessor-" + std::to_string(::getpid()));
+        std::filesystem::create_directories(dir);
+    }
+    void TearDown() override { std::filesystem::remove_all(dir); }
+
+    std::filesystem::path write(const std::string &name, const std::string &text) {
+        auto path = dir / name;
+        std::ofstream(path) << text;
+        return path;
+    }
+};
+
+std::string process(const std::string &source) {
+    Preprocessor preprocessor;
+    auto result = preprocessor.processString(source, "test.p4");
+    return result ? *result : "<failed>";
+}
+
+}  // namespace
+
+TEST_F(PreprocessorTest, Macros) {
+    EXPECT_EQ(process("#define W 8\n"
+                      "#define BITS(n) bit<n>\n"
+                      "#define CAT(a, b) a ## b\n"
+                      "#define STR(x) #x\n"
+                      "#define LOG(f, ...) log(f, __VA_ARGS__)\n"
+                      "header h { BITS(W) CAT(f, 1); }  // W\n"
+                      "LOG(STR(a \"b\"), 1,\n"
+                      "    2) __LINE__\n"
+                      "const bit<8> x = 8w0xF;\n"),
+              "# 1 \"test.p4\"\n"
+              "\n\n\n\n\n"
+              "header h { bit<8> f1; }  // W\n"
+              "log(\"a \\\"b\\\"\", 1, 2) 8\n"
+              "\n"
+              "const bit<8> x = 8w0xF;\n");
+}
+
+TEST_F(PreprocessorTest, RecursiveMacros) {
+    // The examples from the C standard: names are not expanded within their own expansion.
+    EXPECT_EQ(process("#define foo foo + 1\n"
+                      "#define f(x) x * g\n"
+                      "#define g(x) f(x)\n"
+                      "foo f(2)(9)\n"),
+              "# 1 \"test.p4\"\n\n\n\nfoo + 1 2 * 9 * g\n");
+}
+
+TEST_F(PreprocessorTest, Conditionals) {
+    EXPECT_EQ(process("#define A 2\n"
+                      "#if defined(A) && A * 2 == 4 && !defined B && UNDEFINED == 0\n"
+                      "yes\n"
+                      "#if 0\n"
+                      "#if garbage ((\n"
+                      "#endif\n"
+                      "#elif A\n"
+                      "nested\n"
+                      "#endif\n"
+                      "#else\n"
+                      "no\n"
+                      "#endif\n"
+                      "#ifndef A\n"
+                      "no\n"
+                      "#elif (A > 1 ? 0x10 : 0) == 16\n"
+                      "yes\n"
+                      "#endif\n"),
+              "# 1 \"test.p4\"\n\n\nyes\n\n\n\n\nnested\n\n\n\n\n\n\n\nyes\n");
+}
+
+TEST_F(PreprocessorTest, Errors) {
+    EXPECT_EQ(process("#if 1\n"), "<failed>");
+    EXPECT_EQ(process("#if 0\n#else\n#else\n#endif\n"), "<failed>");
+    EXPECT_EQ(process("#endif\n"), "<failed>");
+    EXPECT_EQ(process("#if 1 / 0\n#endif\n"), "<failed>");
+    EXPECT_EQ(process("#error stop\n"), "<failed>");
+    EXPECT_EQ(process("#define f(x) x\nf(1, 2)\n"), "<failed>");
+    EXPECT_EQ(process("#include \"missing.p4\"\n"), "<failed>");
+    EXPECT_EQ(errorCount(), 7u);
+}
+
+TEST_F(PreprocessorTest, Includes) {
+    auto header = write("header.p4",
+                        "#pragma once\n"
+                        "const bit<8> A = 1;\n");
+    auto main = write("main.p4",
+                      "#include \"header.p4\"\n"
+                      "#include <header.p4>\n"
+                      "const bit<8> B = A;\n");
+    Preprocessor preprocessor({dir});
+    auto result = preprocessor.processFile(main);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(*result, "# 1 \"" + main.string() + "\"\n" +
+                           "# 1 \"" + header.string() + "\" 1\n\n"
+                           "const bit<8> A = 1;\n"
+                           "# 2 \"" + main.string() + "\" 2\n\n"
+                           "const bit<8> B = A;\n");
+    EXPECT_EQ(preprocessor.includedFiles(), std::vector<std::filesystem::path>{header});
+
+    // The parser maps positions back to the original files.
+    const auto *program =
+        parseP4String(*result, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program);
+    ASSERT_EQ(program->objects.size(), 2u);
+    auto position = program->objects[0]->srcInfo.toPosition();
+    EXPECT_EQ(position.fileName, header.string());
+    EXPECT_EQ(position.sourceLine, 2u);
+    position = program->objects[1]->srcInfo.toPosition();
+    EXPECT_EQ(position.fileName, main.string());
+    EXPECT_EQ(position.sourceLine, 3u);
+}
+
+TEST_F(PreprocessorTest, TargetOptions) {
+    auto main = write("target.p4",
+                      "#ifdef __TARGET_BMV2__\n"
+                      "bmv2 __TARGET_TOFINO__ NAME\n"
+                      "#endif\n");
+    CompilerOptions options;
+    options.file = main;
+    // Targets add their macros to preprocessor_options, written as for cpp.
+    options.preprocessor_options += " -D__TARGET_BMV2__ -D__TARGET_TOFINO__=2 -D 'NAME=\"a b\"'";
+    Preprocessor preprocessor;
+    auto result = options.preprocessBuiltin(preprocessor);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(*result, "# 1 \"" + main.string() + "\"\n\nbmv2 2 \"a b\"\n");
+
+    options.preprocessor_options += " -include extra.p4";
+    Preprocessor unsupported;
+    EXPECT_FALSE(options.preprocessBuiltin(unsupported));
+    EXPECT_EQ(errorCount(), 1u);
+}
+
+TEST_F(PreprocessorTest, SourceCache) {
+    auto file = write("cached.p4", "one\n");
+    auto first = Preprocessor::readSourceFile(file);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(*first, "one\n");
+    EXPECT_EQ(Preprocessor::readSourceFile(file), first);
+
+    write("cached.p4", "three\n");
+    auto second = Preprocessor::readSourceFile(file);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(*second, "three\n");
+    EXPECT_EQ(Preprocessor::readSourceFile(dir / "missing.p4"), nullptr);
+}
+
+}  // namespace P4::Test
@@ -17,6 +17,11 @@ limitations under the License.
 #include "lib/source_file.h"
 
 #include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 
 #include "lib/compile_context.h"
 #include "lib/cstring.h"
@@ -24,6 +29,8 @@ limitations under the License.
 
 namespace P4::Util {
 
+using namespace P4::literals;
+
 TEST(UtilSourceFile, SourcePosition) {
     SourcePosition invalid;
     EXPECT_FALSE(invalid.isValid());
@@ -78,6 +85,31 @@ TEST(UtilSourceFile, InputSources) {
     EXPECT_EQ(5u, original.sourceLine);
 }
 
+TEST(UtilSourceFile, SourceBuffer) {
+    auto file = std::filesystem::temp_directory_path() /
+                ("p4c-source-buffer-" + std::to_string(::getpid()) + ".p4");
+    std::ofstream(file) << "first\r\nsecond\n";
+    auto buffer = SourceBuffer::open(file);
+    std::filesystem::remove(file);
+    ASSERT_TRUE(buffer);
+    EXPECT_EQ("first\r\nsecond\n", buffer->text());
+    EXPECT_EQ(nullptr, SourceBuffer::open(file));
+
+    // The text is appended token by token, as the lexer does, and not copied.
+    Util::InputSources sources(buffer);
+    for (const char *token : {"first", "\r\n", "sec", "ond"}) sources.appendText(token);
+    {
+        SourcePosition position = sources.getCurrentPosition();
+        EXPECT_EQ(2u, position.getLineNumber());
+        EXPECT_EQ(6u, position.getColumnNumber());
+    }
+    sources.appendText("\n");
+    EXPECT_EQ(2u, sources.lineCount());
+    EXPECT_EQ("first\r\n", sources.getLine(1));
+    EXPECT_EQ(buffer->text().data(), sources.getLine(1).data());
+    EXPECT_EQ("second\n", sources.getLine(2));
+}
+
 TEST(UtilSourceFile, SourceInfo) {
     Util::InputSources sources;
 
@@ -99,4 +131,42 @@ TEST(UtilSourceFile, SourceInfo) {
     EXPECT_FALSE(invalid.isValid());
 }
 
+TEST(UtilSourceFile, SourceInfoHandles) {
+    Util::InputSources sources;
+    EXPECT_EQ(sizeof(SourceInfo), sizeof(uint32_t));
+
+    SourceInfo outer(&sources, SourcePosition(1, 1), SourcePosition(3, 1));
+    SourceInfo inner(&sources, SourcePosition(2, 1), SourcePosition(2, 4));
+    SourceInfo copy = outer;
+    EXPECT_EQ(copy.getStart(), SourcePosition(1, 1));
+    EXPECT_EQ(copy.getEnd(), SourcePosition(3, 1));
+    EXPECT_TRUE(copy == outer);
+    EXPECT_FALSE(inner == outer);
+    EXPECT_TRUE(inner > outer);
+
+    // Spans that one of the operands already covers are not stored again.
+    auto sameHandle = [](const SourceInfo &a, const SourceInfo &b) {
+        return std::memcmp(&a, &b, sizeof(SourceInfo)) == 0;
+    };
+    EXPECT_TRUE(sameHandle(outer + inner, outer));
+    EXPECT_TRUE(sameHandle(inner + outer, outer));
+    EXPECT_TRUE(sameHandle(SourceInfo() + inner, inner));
+    SourceInfo grown = inner;
+    grown += SourceInfo(&sources, SourcePosition(2, 6));
+    EXPECT_FALSE(sameHandle(grown, inner));
+    EXPECT_EQ(grown.toString(), "(2:1)-(2:6)");
+
+    EXPECT_FALSE(SourceInfo(&sources, SourcePosition()).isValid());
+    EXPECT_EQ(outer.line(), -1);
+    EXPECT_EQ(outer.filename(), "");
+
+    SourceInfo dumped("test.p4"_cs, 4, 2, "x = 1;"_cs);
+    EXPECT_FALSE(dumped.isValid());
+    EXPECT_EQ(dumped.filename(), "test.p4");
+    EXPECT_EQ(dumped.line(), 4);
+    EXPECT_EQ(dumped.column(), 2);
+    EXPECT_EQ(dumped.srcBrief(), "x = 1;");
+    EXPECT_FALSE(dumped.getStart().isValid());
+}
+
 }  // namespace P4::Util
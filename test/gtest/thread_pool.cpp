@@ -0,0 +1,72 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "lib/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace P4::Test {
+
+TEST(WorkStealingPool, RunsEveryIndexOnce) {
+    Util::WorkStealingPool pool(4);
+    EXPECT_EQ(pool.concurrency(), 4U);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.parallelFor(hits.size(), [&](size_t i) { hits[i]++; });
+    for (auto &h : hits) EXPECT_EQ(h.load(), 1);
+}
+
+TEST(WorkStealingPool, UnbalancedTasks) {
+    Util::WorkStealingPool pool(3);
+    std::atomic<size_t> sum = 0;
+    pool.parallelFor(64, [&](size_t i) {
+        size_t local = 0;
+        for (size_t j = 0; j < (i == 0 ? 1000000 : 10); ++j) local += j & 1;
+        sum += local;
+    });
+    EXPECT_EQ(sum.load(), 500000U + 63 * 5);
+}
+
+TEST(WorkStealingPool, RethrowsLowestIndex) {
+    Util::WorkStealingPool pool(4);
+    try {
+        pool.parallelFor(100, [](size_t i) {
+            if (i % 10 == 7) throw std::runtime_error(std::to_string(i));
+        });
+        FAIL() << "exception not propagated";
+    } catch (std::runtime_error &e) {
+        EXPECT_STREQ(e.what(), "7");
+    }
+    // The pool must still be usable afterwards.
+    std::atomic<int> count = 0;
+    pool.parallelFor(10, [&](size_t) { count++; });
+    EXPECT_EQ(count.load(), 10);
+}
+
+TEST(WorkStealingPool, NestedCallsRunInline) {
+    Util::WorkStealingPool pool(4);
+    std::atomic<int> count = 0;
+    pool.parallelFor(8, [&](size_t) { pool.parallelFor(8, [&](size_t) { count++; }); });
+    EXPECT_EQ(count.load(), 64);
+}
+
+TEST(WorkStealingPool, SharedPoolDisabledByDefault) {
+    EXPECT_EQ(Util::WorkStealingPool::getJobs(), 1U);
+    EXPECT_EQ(Util::WorkStealingPool::get(), nullptr);
+}
+
+}  // namespace P4::Test
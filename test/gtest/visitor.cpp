@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <set>
+
 #include "frontends/common/parseInput.h"
 #include "frontends/common/resolveReferences/resolveReferences.h"
 #include "gtest/gtest.h"
@@ -23,6 +25,8 @@ limitations under the License.
 
 namespace P4::Test {
 
+using namespace P4::literals;
+
 using P4TestContext = P4CContextWithOptions<CompilerOptions>;
 
 class P4CVisitor : public P4CTest {};
@@ -160,4 +164,56 @@ TEST_F(P4CVisitor, MultiVisitModifierLoop) {
     ASSERT_TRUE(program != nullptr);
 }
 
+struct CountMethodCalls : public Inspector {
+    std::set<const IR::Node *> visited;
+    int calls = 0;
+
+    CountMethodCalls() { visitOnlySubtreesContaining<IR::MethodCallExpression>(); }
+    bool preorder(const IR::Node *n) override {
+        visited.insert(n);
+        return true;
+    }
+    void postorder(const IR::MethodCallExpression *) override { calls++; }
+};
+
+struct ConstantsToCalls : public Transform {
+    const IR::Node *postorder(IR::Constant *) override {
+        return new IR::MethodCallExpression(new IR::PathExpression(IR::ID("f"_cs)));
+    }
+};
+
+TEST_F(P4CVisitor, SkipSubtreesWithoutKinds) {
+    auto *call = new IR::MethodCallExpression(new IR::PathExpression(IR::ID("f"_cs)));
+    auto *constants = new IR::Add(new IR::Constant(1), new IR::Constant(2));
+    auto *expr = new IR::Add(constants, call);
+    auto callBit = IR::Node::kindBit(RTTI::TypeInfo<IR::MethodCallExpression>::id());
+    EXPECT_TRUE(expr->kindSummary() & callBit);
+    EXPECT_TRUE(call->kindSummary() & callBit);
+
+    CountMethodCalls count;
+    expr->apply(count);
+    EXPECT_EQ(count.calls, 1);
+    EXPECT_TRUE(count.visited.count(call));
+    // The summaries are Bloom filters, so the constants are only skipped if their bits
+    // happen not to collide with the bit of MethodCallExpression.
+    EXPECT_EQ(count.visited.count(constants) != 0, (constants->kindSummary() & callBit) != 0);
+
+    // The summaries of the nodes a Transform changes are computed again.
+    const auto *result = expr->apply(ConstantsToCalls());
+    CountMethodCalls after;
+    result->apply(after);
+    EXPECT_EQ(after.calls, 3);
+
+    // Nodes modified in place are summarized again by the next apply.
+    auto *block = new IR::BlockStatement;
+    block->push_back(new IR::EmptyStatement);
+    CountMethodCalls none;
+    block->apply(none);
+    EXPECT_EQ(none.calls, 0);
+    block->push_back(new IR::MethodCallStatement(call));
+    CountMethodCalls pushed;
+    block->apply(pushed);
+    EXPECT_EQ(pushed.calls, 1);
+}
+
 }  // namespace P4::Test
@@ -89,6 +89,9 @@ const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
                   buf << cl->indent << cl->indent
                       << "if (this->typeId() != a_.typeId()) "
                          "return false;\n";
+                  // distinct hash-consed nodes are never equiv
+                  buf << cl->indent << cl->indent
+                      << "if (this->isCanonical() && a_.isCanonical()) return false;\n";
               } else {
                   buf << cl->indent << cl->indent << "if (!"
                       << parent->qualified_name(cl->containedIn) << "::equiv(a_)) return false;\n";